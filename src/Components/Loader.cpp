@@ -26,6 +26,7 @@
 #include "Modules/FastFiles.hpp"
 #include "Modules/Friends.hpp"
 #include "Modules/Gamepad.hpp"
+#include "Modules/HashCache.hpp"
 #include "Modules/IPCPipe.hpp"
 #include "Modules/Lean.hpp"
 #include "Modules/MapRotation.hpp"
@@ -133,6 +134,7 @@ namespace Components
 		Register(new FileSystem());
 		Register(new Friends());
 		Register(new Gamepad());
+		Register(new HashCache());
 		Register(new Lean());
 		Register(new Localization());
 		Register(new MapRotation());
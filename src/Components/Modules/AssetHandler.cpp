@@ -9,7 +9,7 @@ namespace Components
 	std::map<Game::XAssetType, Utils::Slot<AssetHandler::Callback>> AssetHandler::TypeCallbacks;
 	Utils::Signal<AssetHandler::RestrictCallback> AssetHandler::RestrictSignal;
 
-	std::map<void*, void*> AssetHandler::Relocations;
+	AssetHandler::RelocationTable AssetHandler::Relocations;
 
 	std::vector<std::pair<Game::XAssetType, std::string>> AssetHandler::EmptyAssets;
 
@@ -305,24 +305,94 @@ namespace Components
 
 	void AssetHandler::Relocate(void* start, void* to, DWORD size)
 	{
-		for (DWORD i = 0; i < size; i += 4)
-		{
-			AssetHandler::Relocations[reinterpret_cast<char*>(start) + i] = reinterpret_cast<char*>(to) + i;
-		}
+		AssetHandler::Relocations.insert(reinterpret_cast<std::uintptr_t>(start), reinterpret_cast<std::uintptr_t>(to), size);
 	}
 
 	void AssetHandler::OffsetToAlias(Utils::Stream::Offset* offset)
 	{
 		void* pointer = (*Game::g_streamBlocks)[offset->getUnpackedBlock()].data + offset->getUnpackedOffset();
 
-		if (AssetHandler::Relocations.contains(pointer))
+		std::uintptr_t relocated;
+		if (AssetHandler::Relocations.find(reinterpret_cast<std::uintptr_t>(pointer), &relocated))
 		{
-			pointer = AssetHandler::Relocations[pointer];
+			pointer = reinterpret_cast<void*>(relocated);
 		}
 
 		offset->pointer = *static_cast<void**>(pointer);
 	}
 
+	void AssetHandler::RelocationTable::clear()
+	{
+		for (auto& ranges : this->ranges)
+		{
+			ranges.clear();
+		}
+	}
+
+	void AssetHandler::RelocationTable::insert(const std::uintptr_t start, const std::uintptr_t to, const std::size_t size)
+	{
+		if (!size) return;
+
+		// Pointers are relocated in steps of 4 bytes, a trailing partial step still gets an entry
+		const auto end = start + ((size + 3) & ~std::size_t(3));
+		auto& ranges = this->ranges[start & 3];
+
+		// Trim a range that starts before ours and reaches into it
+		auto range = ranges.lower_bound(start);
+		if (range != ranges.begin())
+		{
+			const auto previous = std::prev(range);
+			if (previous->second.end > start)
+			{
+				const auto old = previous->second;
+				previous->second.end = start;
+
+				if (old.end > end)
+				{
+					ranges.emplace(end, Range{ old.end, old.to + (end - previous->first) });
+				}
+			}
+		}
+
+		// Drop ranges we cover, keeping the part that sticks out behind ours
+		while (range != ranges.end() && range->first < end)
+		{
+			if (range->second.end > end)
+			{
+				ranges.emplace(end, Range{ range->second.end, range->second.to + (end - range->first) });
+			}
+
+			range = ranges.erase(range);
+		}
+
+		ranges.emplace(start, Range{ end, to });
+	}
+
+	bool AssetHandler::RelocationTable::find(const std::uintptr_t address, std::uintptr_t* result) const
+	{
+		const auto& ranges = this->ranges[address & 3];
+
+		auto range = ranges.upper_bound(address);
+		if (range == ranges.begin()) return false;
+
+		--range;
+		if (address >= range->second.end) return false;
+
+		*result = range->second.to + (address - range->first);
+		return true;
+	}
+
+	std::size_t AssetHandler::RelocationTable::size() const
+	{
+		std::size_t size = 0;
+		for (const auto& ranges : this->ranges)
+		{
+			size += ranges.size();
+		}
+
+		return size;
+	}
+
 	Game::XAssetHeader AssetHandler::FindOriginalAsset(Game::XAssetType type, const char* filename)
 	{
 		AssetHandler::SetBypassState(true);
@@ -476,6 +546,160 @@ namespace Components
 		Game::ReallocateAssetPool(Game::ASSET_TYPE_IMPACT_FX, 8);
 	}
 
+	bool AssetHandler::unitTest()
+	{
+		// Relocation patterns of the legacy zone converters in Zones.cpp: source stride, destination stride, element count and the copied spans
+		struct Span
+		{
+			std::size_t from;
+			std::size_t to;
+			std::size_t size;
+		};
+
+		struct Pattern
+		{
+			const char* name;
+			std::size_t sourceStride;
+			std::size_t destStride;
+			std::size_t count;
+			std::vector<Span> spans;
+		};
+
+		const std::vector<Pattern> patterns =
+		{
+			{ "FxElemDef", 260, 252, 48, { { 0, 0, 252 } } },
+			{ "snd_alias_t", 108, 100, 96, { { 0, 0, 60 }, { 68, 60, 20 }, { 88, 80, 20 } } },
+			{ "WeaponCompleteDef", 0, 0, 1, { { 400, 408, 388 }, { 172, 168, 232 }, { 1316, 348, 280 } } },
+			{ "XSurface", 64, 48, 32, { { 0, 0, 24 }, { 32, 24, 24 } } },
+			{ "XModel", 156, 140, 24, { { 0, 0, 140 } } },
+			{ "GfxImage", 48, 40, 64, { { 0, 0, 40 } } },
+			{ "MaterialTextureDef", 20, 12, 128, { { 0, 0, 12 } } },
+		};
+
+		constexpr std::size_t assets = 100;
+		constexpr std::size_t assetSize = 0x4000;
+
+		std::vector<char> data(assets * patterns.size() * assetSize);
+
+		const auto replay = [&](const std::function<void(std::uintptr_t, std::uintptr_t, std::size_t)>& relocate)
+		{
+			auto* buffer = data.data();
+			for (std::size_t i = 0; i < assets; ++i)
+			{
+				for (const auto& pattern : patterns)
+				{
+					for (std::size_t j = 0; j < pattern.count; ++j)
+					{
+						for (const auto& span : pattern.spans)
+						{
+							relocate(reinterpret_cast<std::uintptr_t>(buffer + pattern.sourceStride * j + span.from), reinterpret_cast<std::uintptr_t>(buffer + pattern.destStride * j + span.to), span.size);
+						}
+					}
+
+					buffer += assetSize;
+				}
+			}
+		};
+
+		std::map<void*, void*> legacy;
+		RelocationTable table;
+
+		const auto legacyInsert = Utils::Time::Measure([&]
+		{
+			replay([&](const std::uintptr_t start, const std::uintptr_t to, const std::size_t size)
+			{
+				for (std::size_t i = 0; i < size; i += 4)
+				{
+					legacy[reinterpret_cast<char*>(start) + i] = reinterpret_cast<char*>(to) + i;
+				}
+			});
+		});
+
+		const auto tableInsert = Utils::Time::Measure([&]
+		{
+			replay([&](const std::uintptr_t start, const std::uintptr_t to, const std::size_t size)
+			{
+				table.insert(start, to, size);
+			});
+		});
+
+		// Every pointer slot of every asset gets resolved once, like Load_Stream would
+		std::size_t legacyHits = 0, tableHits = 0;
+		std::uintptr_t legacySum = 0, tableSum = 0;
+
+		const auto legacyLookup = Utils::Time::Measure([&]
+		{
+			for (std::size_t i = 0; i < data.size(); i += 4)
+			{
+				const auto entry = legacy.find(data.data() + i);
+				if (entry != legacy.end())
+				{
+					++legacyHits;
+					legacySum += reinterpret_cast<std::uintptr_t>(entry->second);
+				}
+			}
+		});
+
+		const auto tableLookup = Utils::Time::Measure([&]
+		{
+			for (std::size_t i = 0; i < data.size(); i += 4)
+			{
+				std::uintptr_t relocated;
+				if (table.find(reinterpret_cast<std::uintptr_t>(data.data() + i), &relocated))
+				{
+					++tableHits;
+					tableSum += relocated;
+				}
+			}
+		});
+
+		Logger::Print("Relocations: {} map nodes, {} ranges\n", legacy.size(), table.size());
+		Logger::Print("Insert: {} us (map), {} us (ranges)\n", legacyInsert.count(), tableInsert.count());
+		Logger::Print("Lookup: {} us (map), {} us (ranges)\n", legacyLookup.count(), tableLookup.count());
+
+		// Also compare misaligned and overlapping relocations
+		auto success = (legacyHits == tableHits && legacySum == tableSum);
+
+		legacy.clear();
+		table.clear();
+
+		std::mt19937 random(1337);
+		for (auto i = 0; i < 2000 && success; ++i)
+		{
+			const auto start = reinterpret_cast<std::uintptr_t>(data.data()) + random() % 512;
+			const auto to = reinterpret_cast<std::uintptr_t>(data.data()) + 0x1000 + random() % 512;
+			const std::size_t size = random() % 64;
+
+			table.insert(start, to, size);
+			for (std::size_t j = 0; j < size; j += 4)
+			{
+				legacy[reinterpret_cast<char*>(start) + j] = reinterpret_cast<char*>(to) + j;
+			}
+
+			for (std::size_t j = 0; j < 600; ++j)
+			{
+				auto* address = data.data() + j;
+				const auto entry = legacy.find(address);
+
+				std::uintptr_t relocated;
+				const auto found = table.find(reinterpret_cast<std::uintptr_t>(address), &relocated);
+
+				if (found != (entry != legacy.end()) || (found && relocated != reinterpret_cast<std::uintptr_t>(entry->second)))
+				{
+					success = false;
+					break;
+				}
+			}
+		}
+
+		if (!success)
+		{
+			Logger::PrintError(Game::CON_CHANNEL_ERROR, "Relocation table does not match the legacy relocations\n");
+		}
+
+		return success;
+	}
+
 	AssetHandler::~AssetHandler()
 	{
 		AssetHandler::ClearTemporaryAssets();
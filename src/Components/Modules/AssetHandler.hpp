@@ -11,6 +11,8 @@ namespace Components
 		AssetHandler();
 		~AssetHandler();
 
+		bool unitTest() override;
+
 		static void OnFind(Game::XAssetType type, Utils::Slot<Callback> callback);
 		static void OnLoad(Utils::Slot<RestrictCallback> callback);
 
@@ -29,6 +31,26 @@ namespace Components
 		static void OffsetToAlias(Utils::Stream::Offset* offset);
 		
 	private:
+		// Maps every 4th byte of a source range to the same offset in its destination, storing one node per range instead of one per pointer.
+		// Ranges are kept per address alignment, as a later range only overrides the pointers of earlier ones that share its alignment
+		class RelocationTable
+		{
+		public:
+			void clear();
+			void insert(std::uintptr_t start, std::uintptr_t to, std::size_t size);
+			[[nodiscard]] bool find(std::uintptr_t address, std::uintptr_t* result) const;
+			[[nodiscard]] std::size_t size() const;
+
+		private:
+			struct Range
+			{
+				std::uintptr_t end;
+				std::uintptr_t to;
+			};
+
+			std::map<std::uintptr_t, Range> ranges[4];
+		};
+
 		static thread_local int BypassState;
 		static bool ShouldSearchTempAssets;
 
@@ -37,7 +59,7 @@ namespace Components
 		static std::map<Game::XAssetType, Utils::Slot<Callback>> TypeCallbacks;
 		static Utils::Signal<RestrictCallback> RestrictSignal;
 
-		static std::map<void*, void*> Relocations;
+		static RelocationTable Relocations;
 
 		static std::vector<std::pair<Game::XAssetType, std::string>> EmptyAssets;
 
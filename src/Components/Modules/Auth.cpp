@@ -408,37 +408,140 @@ namespace Components
 		}
 	}
 
+	uint32_t Auth::CountZeroBits(const std::uint8_t* hash, std::size_t length)
+	{
+		uint32_t bits = 0;
+
+		// Consume the hash in big-endian 64 bit words and bit-scan the first non-zero one
+		for (std::size_t i = 0; i + sizeof(std::uint64_t) <= length; i += sizeof(std::uint64_t))
+		{
+			std::uint64_t word = 0;
+			for (std::size_t j = 0; j < sizeof(std::uint64_t); ++j)
+			{
+				word = (word << 8) | hash[i + j];
+			}
+
+			if (word)
+			{
+				return bits + static_cast<uint32_t>(std::countl_zero(word));
+			}
+
+			bits += 64;
+		}
+
+		return bits;
+	}
+
 	uint32_t Auth::GetZeroBits(Utils::Cryptography::Token token, const std::string& publicKey)
 	{
-		std::string message = publicKey + token.toString();
-		std::string hash = Utils::Cryptography::SHA512::Compute(message, false);
+		const auto nonce = token.toUnsignedString();
+		std::uint8_t hash[64];
 
-		uint32_t bits = 0;
+		hash_state state;
+		sha512_init(&state);
+		sha512_process(&state, reinterpret_cast<const std::uint8_t*>(publicKey.data()), publicKey.size());
+		sha512_process(&state, nonce.data(), nonce.size());
+		sha512_done(&state, hash);
 
-		for (unsigned int i = 0; i < hash.size(); ++i)
+		return CountZeroBits(hash, sizeof(hash));
+	}
+
+	bool Auth::IncrementNonce(std::uint8_t* nonce, std::size_t& length)
+	{
+		// Mirrors Token::operator++ on a fixed buffer
+		for (auto i = length; i > 0; --i)
 		{
-			if (hash[i] == '\0')
+			if (nonce[i - 1] != 0xFF)
 			{
-				bits += 8;
-				continue;
+				++nonce[i - 1];
+				return true;
 			}
 
-			const auto value = static_cast<std::uint8_t>(hash[i]);
-			for (int j = 7; j >= 0; --j)
+			nonce[i - 1] = 0;
+		}
+
+		if (length >= TokenMining::MaxNonceLength)
+		{
+			return false;
+		}
+
+		// All bytes wrapped to zero, so prepending a zero is the same as appending one
+		nonce[length++] = 0;
+		return true;
+	}
+
+	void Auth::MineTokens(TokenMining* mining)
+	{
+		std::uint8_t nonce[TokenMining::MaxNonceLength];
+		std::uint8_t hash[64];
+
+		while (!mining->finished && !(mining->cancel && *mining->cancel))
+		{
+			std::size_t length;
+
+			// Claim the next batch of tokens
 			{
-				if ((value >> j) & 1)
+				std::lock_guard _(mining->mutex);
+
+				const auto start = mining->nextToken.toUnsignedString();
+				if (start.size() > sizeof(nonce))
 				{
-					return bits;
+					mining->finished = true;
+					return;
 				}
 
-				++bits;
+				std::memcpy(nonce, start.data(), start.size());
+				length = start.size();
+
+				for (std::size_t i = 0; i < TokenMining::BatchSize; ++i)
+				{
+					++mining->nextToken;
+				}
 			}
-		}
 
-		return bits;
+			std::size_t hashes = 0;
+			while (hashes < TokenMining::BatchSize)
+			{
+				if (!IncrementNonce(nonce, length))
+				{
+					mining->finished = true;
+					break;
+				}
+
+				auto state = mining->prefixState;
+				sha512_process(&state, nonce, static_cast<unsigned long>(length));
+				sha512_done(&state, hash);
+				++hashes;
+
+				const auto level = CountZeroBits(hash, sizeof(hash));
+
+				// Store level if higher than the last one
+				if (level > mining->bestLevel || level >= mining->targetLevel)
+				{
+					std::lock_guard _(mining->mutex);
+
+					if (level > mining->bestLevel || level >= mining->targetLevel)
+					{
+						mining->bestLevel = level;
+						*mining->bestToken = std::basic_string<std::uint8_t>(nonce, length);
+					}
+
+					if (level >= mining->targetLevel)
+					{
+						mining->finished = true;
+						break;
+					}
+				}
+
+				// Allow canceling that shit
+				if (mining->cancel && *mining->cancel) break;
+			}
+
+			if (mining->count) *mining->count += hashes;
+		}
 	}
 
-	void Auth::IncrementToken(Utils::Cryptography::Token& token, Utils::Cryptography::Token& computeToken, const std::string& publicKey, uint32_t zeroBits, bool* cancel, uint64_t* count)
+	void Auth::IncrementToken(Utils::Cryptography::Token& token, Utils::Cryptography::Token& computeToken, const std::string& publicKey, uint32_t zeroBits, const std::atomic<bool>* cancel, std::atomic<std::uint64_t>* count, std::size_t threads)
 	{
 		if (zeroBits > 512) return; // Not possible, due to SHA512
 
@@ -448,28 +551,41 @@ namespace Components
 		}
 
 		// Check if we already have the desired security level
-		uint32_t lastLevel = GetZeroBits(token, publicKey);
-		uint32_t level = lastLevel;
+		const auto level = GetZeroBits(token, publicKey);
 		if (level >= zeroBits) return;
 
-		do
+		TokenMining mining;
+		sha512_init(&mining.prefixState);
+		sha512_process(&mining.prefixState, reinterpret_cast<const std::uint8_t*>(publicKey.data()), publicKey.size());
+		mining.targetLevel = zeroBits;
+		mining.nextToken = computeToken;
+		mining.bestToken = &token;
+		mining.bestLevel = level;
+		mining.finished = false;
+		mining.cancel = cancel;
+		mining.count = count;
+
+		if (!threads)
 		{
-			++computeToken;
-			if (count) ++(*count);
-			level = GetZeroBits(computeToken, publicKey);
+			threads = std::max(std::thread::hardware_concurrency(), 1u);
+		}
 
-			// Store level if higher than the last one
-			if (level >= lastLevel)
-			{
-				token = computeToken;
-				lastLevel = level;
-			}
+		// The nonce space is handed out in batches, so every thread hashes a disjoint range
+		std::vector<std::thread> workers;
+		for (std::size_t i = 1; i < threads; ++i)
+		{
+			workers.emplace_back(MineTokens, &mining);
+		}
 
-			// Allow canceling that shit
-			if (cancel && *cancel) return;
-		} while (level < zeroBits);
+		MineTokens(&mining);
 
-		token = computeToken;
+		for (auto& worker : workers)
+		{
+			worker.join();
+		}
+
+		// Resume from the first unclaimed batch next time
+		computeToken = mining.nextToken;
 	}
 
 	Auth::Auth()
@@ -613,6 +729,66 @@ namespace Components
 			success = false;
 		}
 
+		const auto publicKey = Utils::Cryptography::ECC::GenerateKey(512).getPublicKey();
+
+		printf("Token mining : ");
+		{
+			Utils::Cryptography::Token token;
+			Utils::Cryptography::Token computeToken;
+			IncrementToken(token, computeToken, publicKey, 12);
+
+			// Verify against the legacy per-bit scan
+			const auto hash = Utils::Cryptography::SHA512::Compute(publicKey + token.toString());
+
+			uint32_t bits = 0;
+			for (std::size_t i = 0; i < hash.size() * 8 && !((static_cast<std::uint8_t>(hash[i / 8]) >> (7 - i % 8)) & 1); ++i)
+			{
+				++bits;
+			}
+
+			if (bits >= 12 && GetZeroBits(token, publicKey) == bits && computeToken >= token) printf("Success\n");
+			else
+			{
+				printf("Error\n");
+				success = false;
+			}
+		}
+
+		printf("Benchmarking token mining:\n");
+		{
+			Utils::Cryptography::Token token;
+			std::uint64_t hashes = 0;
+
+			const auto start = std::chrono::high_resolution_clock::now();
+			while (std::chrono::high_resolution_clock::now() - start < 1s)
+			{
+				const auto hash = Utils::Cryptography::SHA512::Compute(publicKey + (++token).toString());
+				++hashes;
+			}
+
+			printf("Legacy    : %llu H/s\n", hashes);
+		}
+
+		const auto threads = std::max(std::thread::hardware_concurrency(), 1u);
+		for (std::size_t i = 1; i <= threads; ++i)
+		{
+			Utils::Cryptography::Token token;
+			Utils::Cryptography::Token computeToken;
+			std::atomic<bool> cancel = false;
+			std::atomic<std::uint64_t> hashes = 0;
+
+			std::thread timer([&cancel]
+			{
+				std::this_thread::sleep_for(1s);
+				cancel = true;
+			});
+
+			IncrementToken(token, computeToken, publicKey, 512, &cancel, &hashes, i);
+			timer.join();
+
+			printf("%2zu threads: %llu H/s\n", i, hashes.load());
+		}
+
 		return success;
 	}
 }
@@ -22,18 +22,37 @@ namespace Components
 		static void IncreaseSecurityLevel(uint32_t level, const std::string& command = {});
 
 		static uint32_t GetZeroBits(Utils::Cryptography::Token token, const std::string& publicKey);
-		static void IncrementToken(Utils::Cryptography::Token& token, Utils::Cryptography::Token& computeToken, const std::string& publicKey, uint32_t zeroBits, bool* cancel = nullptr, uint64_t* count = nullptr);
+		static void IncrementToken(Utils::Cryptography::Token& token, Utils::Cryptography::Token& computeToken, const std::string& publicKey, uint32_t zeroBits, const std::atomic<bool>* cancel = nullptr, std::atomic<std::uint64_t>* count = nullptr, std::size_t threads = 0);
 
 	private:
 		struct TokenIncrementing
 		{
-			bool cancel;
+			std::atomic<bool> cancel;
 			bool generating;
 			std::thread thread;
 			uint32_t targetLevel;
 			int startTime;
 			std::string command;
-			uint64_t hashes;
+			std::atomic<std::uint64_t> hashes;
+		};
+
+		// Shared state of the worker threads spawned by IncrementToken
+		struct TokenMining
+		{
+			static constexpr std::size_t BatchSize = 0x1000;
+			static constexpr std::size_t MaxNonceLength = 32;
+
+			hash_state prefixState; // SHA512 state after absorbing the public key
+			uint32_t targetLevel;
+
+			std::mutex mutex;
+			Utils::Cryptography::Token nextToken; // First token of the next unclaimed batch
+			Utils::Cryptography::Token* bestToken;
+			std::atomic<uint32_t> bestLevel;
+			std::atomic<bool> finished;
+
+			const std::atomic<bool>* cancel;
+			std::atomic<std::uint64_t>* count;
 		};
 
 		static Dvar::Var SVSecurityLevel;
@@ -54,5 +73,9 @@ namespace Components
 		static void DirectConnectPrivateClientStub();
 
 		static void Frame();
+
+		static uint32_t CountZeroBits(const std::uint8_t* hash, std::size_t length);
+		static bool IncrementNonce(std::uint8_t* nonce, std::size_t& length);
+		static void MineTokens(TokenMining* mining);
 	};
 }
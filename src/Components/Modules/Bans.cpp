@@ -6,6 +6,61 @@ namespace Components
 {
 	const char* Bans::BanListFile = "userraw/bans.json";
 
+	Utils::Concurrency::Container<Bans::BanList> Bans::BanIndex;
+
+	void Bans::IPRangeTree::insert(const std::uint32_t network, const std::uint32_t prefix)
+	{
+		if (this->nodes_.empty())
+		{
+			this->nodes_.emplace_back();
+		}
+
+		std::uint32_t node = 0;
+		for (std::uint32_t i = 0; i < prefix; ++i)
+		{
+			const auto bit = (network >> (31 - i)) & 1;
+			if (!this->nodes_[node].children[bit])
+			{
+				this->nodes_[node].children[bit] = static_cast<std::uint32_t>(this->nodes_.size());
+				this->nodes_.emplace_back();
+			}
+
+			node = this->nodes_[node].children[bit];
+		}
+
+		this->nodes_[node].terminal = true;
+	}
+
+	bool Bans::IPRangeTree::contains(const std::uint32_t ip) const
+	{
+		if (this->nodes_.empty())
+		{
+			return false;
+		}
+
+		std::uint32_t node = 0;
+		for (auto i = 0; i < 32; ++i)
+		{
+			if (this->nodes_[node].terminal)
+			{
+				return true;
+			}
+
+			node = this->nodes_[node].children[(ip >> (31 - i)) & 1];
+			if (!node)
+			{
+				return false;
+			}
+		}
+
+		return this->nodes_[node].terminal;
+	}
+
+	void Bans::IPRangeTree::clear()
+	{
+		this->nodes_.clear();
+	}
+
 	// Have only one instance of IW4x read/write the file
 	std::unique_lock<Utils::NamedMutex> Bans::Lock()
 	{
@@ -14,103 +69,132 @@ namespace Components
 		return lock;
 	}
 
-	bool Bans::IsBanned(const banEntry& entry)
+	std::uint32_t Bans::GetHostIP(const Game::netIP_t& ip)
+	{
+		return (static_cast<std::uint32_t>(ip.bytes[0]) << 24) | (static_cast<std::uint32_t>(ip.bytes[1]) << 16) | (static_cast<std::uint32_t>(ip.bytes[2]) << 8) | ip.bytes[3];
+	}
+
+	bool Bans::ParseRange(const std::string& entry, std::uint32_t* network, std::uint32_t* prefix)
 	{
-		BanList list;
-		LoadBans(&list);
+		const auto pos = entry.find('/');
+		if (pos == std::string::npos)
+		{
+			return false;
+		}
 
-		if (entry.first.bits)
+		char* end;
+		const auto bits = std::strtoul(entry.data() + pos + 1, &end, 10);
+		if (end == entry.data() + pos + 1 || *end != '\0' || bits > 32)
 		{
-			for (const auto& idEntry : list.idList)
+			return false;
+		}
+
+		Network::Address addr(entry.substr(0, pos));
+		if (!addr.isValid())
+		{
+			return false;
+		}
+
+		const auto mask = bits ? ~0u << (32 - bits) : 0u;
+		*network = GetHostIP(addr.getIP()) & mask;
+		*prefix = bits;
+		return true;
+	}
+
+	bool Bans::IsBanned(const banEntry& entry)
+	{
+		return BanIndex.access<bool>([&](BanList& list)
+		{
+			RefreshBans(list);
+
+			if (entry.first.bits && list.idList.contains(entry.first.bits))
 			{
-				if (idEntry.bits == entry.first.bits)
+				return true;
+			}
+
+			if (entry.second.full)
+			{
+				if (list.ipList.contains(entry.second.full))
 				{
 					return true;
 				}
-			}
-		}
 
-		if (entry.second.full)
-		{
-			for (const auto& ipEntry : list.ipList)
-			{
-				if (ipEntry.full == entry.second.full)
+				if (list.ipRanges.contains(GetHostIP(entry.second)))
 				{
 					return true;
 				}
 			}
-		}
 
-		return false;
+			return false;
+		});
 	}
 
 	void Bans::InsertBan(const banEntry& entry)
 	{
-		BanList list;
-		LoadBans(&list);
-
-		if (entry.first.bits)
+		BanIndex.access([&](BanList& list)
 		{
-			bool found = false;
-			for (const auto& idEntry : list.idList)
-			{
-				if (idEntry.bits == entry.first.bits)
-				{
-					found = true;
-					break;
-				}
-			}
+			RefreshBans(list);
 
-			if (!found)
+			auto changed = false;
+
+			if (entry.first.bits)
 			{
-				list.idList.push_back(entry.first);
+				changed |= list.idList.emplace(entry.first.bits).second;
 			}
-		}
 
-		if (entry.second.full)
-		{
-			bool found = false;
-			for (const auto& ipEntry : list.ipList)
+			if (entry.second.full)
 			{
-				if (ipEntry.full == entry.second.full)
-				{
-					found = true;
-					break;
-				}
+				changed |= list.ipList.emplace(entry.second.full).second;
 			}
 
-			if (!found)
+			if (changed)
 			{
-				list.ipList.push_back(entry.second);
+				QueueSave(list);
 			}
-		}
-
-		SaveBans(&list);
+		});
 	}
 
-	void Bans::SaveBans(const BanList* list)
+	void Bans::QueueSave(BanList& list)
 	{
-		assert(list);
+		if (list.savePending) return;
+		list.savePending = true;
 
-		const auto _ = Lock();
+		Scheduler::Once(SaveBans, Scheduler::Pipeline::ASYNC);
+	}
 
+	void Bans::SaveBans()
+	{
 		std::vector<std::string> idVector;
 		std::vector<std::string> ipVector;
 
-		for (const auto& idEntry : list->idList)
+		BanIndex.access([&](BanList& list)
 		{
-			idVector.emplace_back(Utils::String::VA("%llX", idEntry.bits));
-		}
+			// Changes made after this snapshot queue another save
+			list.savePending = false;
 
-		for (const auto& ipEntry : list->ipList)
-		{
-			ipVector.emplace_back(Utils::String::VA("%u.%u.%u.%u",
-				ipEntry.bytes[0] & 0xFF,
-				ipEntry.bytes[1] & 0xFF,
-				ipEntry.bytes[2] & 0xFF,
-				ipEntry.bytes[3] & 0xFF)
-			);
-		}
+			idVector.reserve(list.idList.size());
+			ipVector.reserve(list.ipList.size() + list.rangeList.size());
+
+			for (const auto& idEntry : list.idList)
+			{
+				idVector.emplace_back(Utils::String::VA("%llX", idEntry));
+			}
+
+			for (const auto& ipEntry : list.ipList)
+			{
+				Game::netIP_t ip;
+				ip.full = ipEntry;
+
+				ipVector.emplace_back(Utils::String::VA("%u.%u.%u.%u",
+					ip.bytes[0] & 0xFF,
+					ip.bytes[1] & 0xFF,
+					ip.bytes[2] & 0xFF,
+					ip.bytes[3] & 0xFF)
+				);
+			}
+
+			ipVector.insert(ipVector.end(), list.rangeList.begin(), list.rangeList.end());
+		});
 
 		const nlohmann::json bans = nlohmann::json
 		{
@@ -118,16 +202,72 @@ namespace Components
 			{ "id", idVector },
 		};
 
-		Utils::IO::WriteFile(BanListFile, bans.dump());
+		const auto data = bans.dump();
+
+		std::error_code ec;
+		std::filesystem::file_time_type lastWrite;
+
+		{
+			const auto _ = Lock();
+			Utils::IO::WriteFile(BanListFile, data);
+			lastWrite = std::filesystem::last_write_time(BanListFile, ec);
+		}
+
+		BanIndex.access([&](BanList& list)
+		{
+			// Don't reload the file we just wrote
+			if (!ec) list.lastWrite = lastWrite;
+		});
 	}
 
-	void Bans::LoadBans(BanList* list)
+	void Bans::RefreshBans(BanList& list)
 	{
-		assert(list);
+		// Unsaved changes take precedence until the writer has flushed them
+		if (list.savePending) return;
 
-		const auto _ = Lock();
+		std::error_code ec;
+		const auto lastWrite = std::filesystem::last_write_time(BanListFile, ec);
+		if (ec)
+		{
+			// A deleted file lifts every ban it held
+			if (!list.loaded || list.lastWrite != std::filesystem::file_time_type{})
+			{
+				Logger::Debug("bans.json does not exist");
+
+				list.idList.clear();
+				list.ipList.clear();
+				list.rangeList.clear();
+				list.ipRanges.clear();
+
+				list.lastWrite = {};
+				list.loaded = true;
+			}
+
+			return;
+		}
+
+		if (list.loaded && lastWrite == list.lastWrite) return;
+
+		list.lastWrite = lastWrite;
+		list.loaded = true;
+
+		LoadBans(list);
+	}
+
+	void Bans::LoadBans(BanList& list)
+	{
+		std::string bans;
+
+		{
+			const auto _ = Lock();
+			bans = Utils::IO::ReadFile(BanListFile);
+		}
+
+		list.idList.clear();
+		list.ipList.clear();
+		list.rangeList.clear();
+		list.ipRanges.clear();
 
-		const auto bans = Utils::IO::ReadFile(BanListFile);
 		if (bans.empty())
 		{
 			Logger::Debug("bans.json does not exist");
@@ -157,16 +297,14 @@ namespace Components
 		if (idList.is_array())
 		{
 			const nlohmann::json::array_t arr = idList;
+			list.idList.reserve(arr.size());
 
 			for (auto &idEntry : arr)
 			{
 				if (idEntry.is_string())
 				{
-					SteamID id;
 					auto guid = idEntry.get<std::string>();
-					id.bits = std::strtoull(guid.data(), nullptr, 16);
-
-					list->idList.push_back(id);
+					list.idList.emplace(std::strtoull(guid.data(), nullptr, 16));
 				}
 			}
 		}
@@ -174,14 +312,24 @@ namespace Components
 		if (ipList.is_array())
 		{
 			const nlohmann::json::array_t arr = ipList;
+			list.ipList.reserve(arr.size());
 
 			for (auto &ipEntry : arr)
 			{
 				if (ipEntry.is_string())
 				{
-					Network::Address addr(ipEntry.get<std::string>());
-
-					list->ipList.push_back(addr.getIP());
+					auto ip = ipEntry.get<std::string>();
+
+					std::uint32_t network, prefix;
+					if (ParseRange(ip, &network, &prefix))
+					{
+						list.ipRanges.insert(network, prefix);
+						list.rangeList.emplace_back(std::move(ip));
+						continue;
+					}
+
+					Network::Address addr(ip);
+					list.ipList.emplace(addr.getIP().full);
 				}
 			}
 		}
@@ -199,38 +347,28 @@ namespace Components
 
 	void Bans::UnbanClient(SteamID id)
 	{
-		BanList list;
-		LoadBans(&list);
-
-		const auto entry = std::find_if(list.idList.begin(), list.idList.end(), [&id](const SteamID& entry)
-		{
-			return id.bits == entry.bits;
-		});
-
-		if (entry != list.idList.end())
+		BanIndex.access([&](BanList& list)
 		{
-			list.idList.erase(entry);
-		}
+			RefreshBans(list);
 
-		SaveBans(&list);
+			if (list.idList.erase(id.bits))
+			{
+				QueueSave(list);
+			}
+		});
 	}
 
 	void Bans::UnbanClient(Game::netIP_t ip)
 	{
-		BanList list;
-		LoadBans(&list);
-
-		const auto entry = std::find_if(list.ipList.begin(), list.ipList.end(), [&ip](const Game::netIP_t& entry)
-		{
-			return ip.full == entry.full;
-		});
-
-		if (entry != list.ipList.end())
+		BanIndex.access([&](BanList& list)
 		{
-			list.ipList.erase(entry);
-		}
+			RefreshBans(list);
 
-		SaveBans(&list);
+			if (list.ipList.erase(ip.full))
+			{
+				QueueSave(list);
+			}
+		});
 	}
 
 	void Bans::AddServerCommands()
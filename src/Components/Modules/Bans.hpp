@@ -17,18 +17,49 @@ namespace Components
 		static void InsertBan(const banEntry& entry);
 
 	private:
+		// Binary trie over the host-order IPv4 address, one level per bit of the CIDR prefix
+		class IPRangeTree
+		{
+		public:
+			void insert(std::uint32_t network, std::uint32_t prefix);
+			[[nodiscard]] bool contains(std::uint32_t ip) const;
+			void clear();
+
+		private:
+			struct Node
+			{
+				std::uint32_t children[2]{};
+				bool terminal{};
+			};
+
+			std::vector<Node> nodes_;
+		};
+
 		struct BanList
 		{
-			std::vector<SteamID> idList;
-			std::vector<Game::netIP_t> ipList;
+			std::unordered_set<std::uint64_t> idList;
+			std::unordered_set<std::uint32_t> ipList;
+			std::vector<std::string> rangeList; // Raw CIDR entries, written back as they were read
+			IPRangeTree ipRanges;
+
+			bool loaded{};
+			bool savePending{};
+			std::filesystem::file_time_type lastWrite{};
 		};
 
 		static const char* BanListFile;
 
+		static Utils::Concurrency::Container<BanList> BanIndex;
+
 		static std::unique_lock<Utils::NamedMutex> Lock();
 
-		static void LoadBans(BanList* list);
-		static void SaveBans(const BanList* list);
+		static std::uint32_t GetHostIP(const Game::netIP_t& ip);
+		static bool ParseRange(const std::string& entry, std::uint32_t* network, std::uint32_t* prefix);
+
+		static void RefreshBans(BanList& list);
+		static void LoadBans(BanList& list);
+		static void SaveBans();
+		static void QueueSave(BanList& list);
 
 		static void AddServerCommands();
 	};
@@ -4,6 +4,8 @@
 
 #include "Download.hpp"
 #include "Events.hpp"
+#include "FastFiles.hpp"
+#include "HashCache.hpp"
 #include "MapRotation.hpp"
 #include "Node.hpp"
 #include "Party.hpp"
@@ -17,8 +19,27 @@ namespace Components
 {
 	static mg_mgr Mgr;
 
+	// State of a file that is streamed to a connection, only touched by the Mongoose thread
+	struct FileTransfer
+	{
+		std::ifstream stream;
+		std::uint64_t remaining;
+		std::int64_t allowance;
+		std::uint64_t lastRefill;
+	};
+
+	static std::unordered_map<unsigned long, FileTransfer> Transfers;
+	static std::int64_t TotalAllowance;
+	static std::uint64_t TotalLastRefill;
+
+	// Don't queue more than this per connection, the rest is read once the socket drained
+	static constexpr std::size_t TransferWatermark = 256 * 1024;
+	static constexpr std::size_t TransferChunkSize = 64 * 1024;
+
 	Dvar::Var Download::SV_wwwDownload;
 	Dvar::Var Download::SV_wwwBaseUrl;
+	Dvar::Var Download::SV_DownloadRate;
+	Dvar::Var Download::SV_DownloadTotalRate;
 
 	Dvar::Var Download::UIDlTimeLeft;
 	Dvar::Var Download::UIDlProgress;
@@ -133,43 +154,9 @@ namespace Components
 		return true;
 	}
 
-	bool Download::DownloadFile(ClientDownload* download, unsigned int index)
+	std::string Download::GetFileUrl(const ClientDownload* download, const ClientDownload::File& file, const std::string& path)
 	{
-		if (!download || download->files_.size() <= index) return false;
-
-		auto file = download->files_[index];
-
-		auto path = download->mod_ + "/" + file.name;
-		if (download->isMap_)
-		{
-			path = "usermaps/" + path;
-		}
-
-		if (Utils::IO::FileExists(path))
-		{
-			auto data = Utils::IO::ReadFile(path);
-			if (data.size() == file.size && Utils::String::DumpHex(Utils::Cryptography::SHA256::Compute(data), "") == file.hash)
-			{
-				download->totalBytes_ += file.size;
-				return true;
-			}
-		}
-
-		auto host = "http://" + download->target_.getString();
-		auto fastHost = SV_wwwBaseUrl.get<std::string>();
-		if (Utils::String::StartsWith(fastHost, "https://"))
-		{
-			download->thread_.detach();
-			download->clear();
-
-			Scheduler::Once([]
-			{
-				Command::Execute("closemenu mod_download_popmenu");
-				Party::ConnectError("HTTPS not supported for downloading!");
-			}, Scheduler::Pipeline::CLIENT);
-
-			return false;
-		}
+		auto fastHost = download->wwwBaseUrl_;
 
 		if (!Utils::String::StartsWith(fastHost, "http://"))
 		{
@@ -191,19 +178,90 @@ namespace Components
 		//    -mod.ff
 		//  /-mod2
 		//     ...
-		if (SV_wwwDownload.get<bool>())
+		if (download->wwwDownload_)
 		{
 			if (!Utils::String::EndsWith(fastHost, "/")) fastHost.append("/");
 			url = fastHost + path;
 		}
 		else
 		{
-			url = host + "/file/" + (download->isMap_ ? "map/" : "") + file.name
+			url = "http://" + download->target_.getString() + "/file/" + (download->isMap_ ? "map/" : "") + file.name
 				+ (download->isPrivate_ ? ("?password=" + download->hashedPassword_) : "");
 		}
 
+		Utils::String::Replace(url, " ", "%20");
+		return url;
+	}
+
+	bool Download::DownloadFile(ClientDownload* download, unsigned int index)
+	{
+		if (!download || download->files_.size() <= index) return false;
+
+		auto file = download->files_[index];
+
+		auto path = download->mod_ + "/" + file.name;
+		if (download->isMap_)
+		{
+			path = "usermaps/" + path;
+		}
+
+		if (Utils::IO::FileExists(path))
+		{
+			if (Utils::IO::FileSize(path) == file.size && HashCache::GetSHA256(path, true) == file.hash)
+			{
+				download->totalBytes_ += file.size;
+				return true;
+			}
+		}
+
+		if (Utils::String::StartsWith(download->wwwBaseUrl_, "https://"))
+		{
+			std::lock_guard _(download->mutex_);
+			download->failedReason_ = "HTTPS not supported for downloading!";
+			return false;
+		}
+
+		const auto url = GetFileUrl(download, file, path);
 		Logger::Print("Downloading from url {}\n", url);
 
+		if (download->isMap_) Utils::IO::CreateDir("usermaps/" + download->mod_);
+
+		// Data is written to a part file as it arrives, so an interrupted download can be resumed
+		const auto partPath = path + ".part";
+
+		hash_state state;
+		sha256_init(&state);
+
+		std::uint64_t offset = 0;
+		if (Utils::IO::FileExists(partPath))
+		{
+			offset = Utils::IO::FileSize(partPath);
+
+			std::ifstream part(partPath, std::ios::binary);
+			if (offset > file.size || !part.is_open())
+			{
+				offset = 0;
+			}
+			else
+			{
+				// Restore the hash state of the data we already have
+				const auto chunk = std::make_unique<char[]>(PartChunkSize);
+				std::uint64_t hashed = 0;
+
+				while (hashed < offset && part.read(chunk.get(), static_cast<std::streamsize>(std::min<std::uint64_t>(PartChunkSize, offset - hashed))))
+				{
+					sha256_process(&state, reinterpret_cast<const std::uint8_t*>(chunk.get()), static_cast<unsigned long>(part.gcount()));
+					hashed += part.gcount();
+				}
+
+				if (hashed != offset)
+				{
+					sha256_init(&state);
+					offset = 0;
+				}
+			}
+		}
+
 		FileDownload fDownload;
 		fDownload.file = file;
 		fDownload.index = index;
@@ -211,41 +269,120 @@ namespace Components
 		fDownload.downloading = true;
 		fDownload.receivedBytes = 0;
 
-		Utils::String::Replace(url, " ", "%20");
-
 		download->valid_ = true;
 
-		fDownload.downloading = true;
+		if (offset)
+		{
+			Logger::Print("Resuming {} at {} bytes\n", file.name, offset);
+			DownloadProgress(&fDownload, offset);
+		}
+
+		std::ofstream output(partPath, std::ios::binary | (offset ? std::ios::app : std::ios::trunc));
 
-		Utils::WebIO webIO;
-		webIO.setProgressCallback([&fDownload, &webIO](std::size_t bytes, std::size_t)
+		for (auto attempt = 0; output.is_open() && offset < file.size && attempt < MaxDownloadAttempts; ++attempt)
 		{
-			if(!fDownload.downloading || fDownload.download->terminateThread_)
+			if (download->terminateThread_ || download->failed_) break;
+
+			const auto requested = offset;
+			auto resumed = false;
+
+			Utils::WebIO webIO;
+			webIO.getStream(url, offset, [&](const char* data, const std::size_t size)
 			{
-				webIO.cancelDownload();
-				return;
-			}
+				if (download->terminateThread_ || download->failed_) return false;
 
-			DownloadProgress(&fDownload, bytes - fDownload.receivedBytes);
-		});
+				if (requested && !resumed && offset == requested)
+				{
+					// The server ignored the range, start over
+					output.close();
+					output.open(partPath, std::ios::binary | std::ios::trunc);
+					sha256_init(&state);
 
-		auto result = false;
-		fDownload.buffer = webIO.get(url, &result);
-		if (!result) fDownload.buffer.clear();
+					DownloadProgress(&fDownload, 0 - static_cast<std::size_t>(offset));
+					offset = 0;
+				}
 
-		fDownload.downloading = false;
+				if (offset + size > file.size) return false;
 
+				output.write(data, static_cast<std::streamsize>(size));
+				sha256_process(&state, reinterpret_cast<const std::uint8_t*>(data), static_cast<unsigned long>(size));
+				offset += size;
+
+				DownloadProgress(&fDownload, size);
+				return output.good();
+			}, &resumed);
+
+			output.flush();
+		}
+
+		output.close();
+
+		fDownload.downloading = false;
 		download->valid_ = false;
 
-		if (fDownload.buffer.size() != file.size || Utils::Cryptography::SHA256::Compute(fDownload.buffer, true) != file.hash)
+		if (offset != file.size)
 		{
+			// Keep the part file so the next attempt can resume
 			return false;
 		}
 
-		if (download->isMap_) Utils::IO::CreateDir("usermaps/" + download->mod_);
-		Utils::IO::WriteFile(path, fDownload.buffer);
+		std::uint8_t digest[32];
+		sha256_done(&state, digest);
 
-		return true;
+		if (Utils::String::DumpHex(std::string(reinterpret_cast<char*>(digest), sizeof(digest)), "") != file.hash)
+		{
+			Utils::IO::RemoveFile(partPath);
+			return false;
+		}
+
+		std::error_code ec;
+		std::filesystem::remove(path, ec);
+		std::filesystem::rename(partPath, path, ec);
+
+		return !ec;
+	}
+
+	void Download::FileDownloader(ClientDownload* download)
+	{
+		while (!download->terminateThread_ && !download->failed_)
+		{
+			const auto index = download->nextFile_++;
+			if (index >= download->files_.size()) return;
+
+			if (!DownloadFile(download, index))
+			{
+				std::lock_guard _(download->mutex_);
+
+				if (!download->failed_)
+				{
+					download->failed_ = true;
+					download->failedFile_ = download->files_[index].name;
+				}
+			}
+		}
+	}
+
+	bool Download::DownloadFiles(ClientDownload* download)
+	{
+		// Several files are fetched at once, each worker picks the next file that is not taken yet
+		download->nextFile_ = 0;
+		download->failed_ = false;
+		download->failedFile_.clear();
+		download->failedReason_.clear();
+
+		std::vector<std::thread> workers;
+		const auto workerCount = std::min<std::size_t>(download->files_.size(), MaxConcurrentDownloads);
+		for (std::size_t i = 0; i < workerCount; ++i)
+		{
+			workers.emplace_back(FileDownloader, download);
+		}
+
+		for (auto& worker : workers)
+		{
+			worker.join();
+		}
+
+		return !download->failed_;
 	}
 
 	void Download::ModDownloader(ClientDownload* download)
@@ -293,36 +430,54 @@ namespace Components
 
 		if (download->terminateThread_) return;
 
+		download->wwwDownload_ = SV_wwwDownload.get<bool>();
+		download->wwwBaseUrl_ = SV_wwwBaseUrl.get<std::string>();
+
 		static std::string mod;
 		mod = download->mod_;
 
-		for (std::size_t i = 0; i < download->files_.size(); ++i)
+		DownloadFiles(download);
+
+		if (download->terminateThread_) return;
+
+		if (download->failed_ && !download->failedReason_.empty())
 		{
-			if (download->terminateThread_) return;
+			mod = download->failedReason_;
+			download->thread_.detach();
+			download->clear();
 
-			if (!DownloadFile(download, i))
+			Scheduler::Once([]
 			{
-				if (download->terminateThread_) return;
+				Command::Execute("closemenu mod_download_popmenu");
+				Party::ConnectError(mod);
+				mod.clear();
+			}, Scheduler::Pipeline::CLIENT);
 
-				mod = std::format("Failed to download file: {}!", download->files_[i].name);
-				download->thread_.detach();
-				download->clear();
+			return;
+		}
 
-				Scheduler::Once([]
-				{
-					Dvar::Var("partyend_reason").set(mod);
-					mod.clear();
+		if (download->failed_)
+		{
+			mod = std::format("Failed to download file: {}!", download->failedFile_);
+			download->thread_.detach();
+			download->clear();
 
-					Command::Execute("closemenu mod_download_popmenu");
-					Command::Execute("openmenu menu_xboxlive_partyended");
-				}, Scheduler::Pipeline::CLIENT);
+			Scheduler::Once([]
+			{
+				Dvar::Var("partyend_reason").set(mod);
+				mod.clear();
 
-				return;
-			}
+				Command::Execute("closemenu mod_download_popmenu");
+				Command::Execute("openmenu menu_xboxlive_partyended");
+			}, Scheduler::Pipeline::CLIENT);
+
+			return;
 		}
 
 		if (download->terminateThread_) return;
 
+		FastFiles::RefreshZoneIndex();
+
 		download->thread_.detach();
 		download->clear();
 
@@ -357,6 +512,9 @@ namespace Components
 
 	void Download::DownloadProgress(FileDownload* fDownload, std::size_t bytes)
 	{
+		// Called from all download workers
+		std::lock_guard _(fDownload->download->mutex_);
+
 		fDownload->receivedBytes += bytes;
 		fDownload->download->downBytes_ += bytes;
 		fDownload->download->timeStampBytes_ += bytes;
@@ -503,25 +661,40 @@ namespace Components
 			auto list = FileSystem::GetSysFileList(path.generic_string(), "iwd", false);
 			list.emplace_back("mod.ff");
 
+			std::vector<std::string> names;
+			std::vector<std::string> filenames;
+
 			for (const auto& file : list)
 			{
-				auto filename = path / file;
+				auto filename = (path / file).generic_string();
 
 				if (file.find("_svr_") != std::string::npos) // Files that are 'server only' are skipped
 				{
 					continue;
 				}
 
-				auto fileBuffer = Utils::IO::ReadFile(filename.generic_string());
-				if (fileBuffer.empty())
+				if (!Utils::IO::FileSize(filename))
+				{
+					continue;
+				}
+
+				names.emplace_back(file);
+				filenames.emplace_back(std::move(filename));
+			}
+
+			const auto hashes = HashCache::GetSHA256(filenames, true);
+
+			for (std::size_t i = 0; i < filenames.size(); ++i)
+			{
+				if (hashes[i].empty())
 				{
 					continue;
 				}
 
 				std::unordered_map<std::string, nlohmann::json> jsonFileList;
-				jsonFileList["name"] = file;
-				jsonFileList["size"] = fileBuffer.size();
-				jsonFileList["hash"] = Utils::Cryptography::SHA256::Compute(fileBuffer, true);
+				jsonFileList["name"] = names[i];
+				jsonFileList["size"] = Utils::IO::FileSize(filenames[i]);
+				jsonFileList["hash"] = hashes[i];
 
 				fileList.emplace_back(jsonFileList);
 			}
@@ -554,20 +727,34 @@ namespace Components
 			const std::filesystem::path basePath = (*Game::fs_basepath)->current.string;
 			const auto path = basePath / "usermaps" / mapName;
 
+			std::vector<std::string> names;
+			std::vector<std::string> filenames;
+
 			for (std::size_t i = 0; i < ARRAYSIZE(Maps::UserMapFiles); ++i)
 			{
-				const auto filename = std::format("{}\\{}{}", path.generic_string(), mapName, Maps::UserMapFiles[i]);
+				auto filename = std::format("{}\\{}{}", path.generic_string(), mapName, Maps::UserMapFiles[i]);
+				if (!Utils::IO::FileSize(filename))
+				{
+					continue;
+				}
 
-				std::unordered_map<std::string, nlohmann::json> file;
-				auto fileBuffer = Utils::IO::ReadFile(filename);
-				if (fileBuffer.empty())
+				names.emplace_back(mapName + Maps::UserMapFiles[i]);
+				filenames.emplace_back(std::move(filename));
+			}
+
+			const auto hashes = HashCache::GetSHA256(filenames, true);
+
+			for (std::size_t i = 0; i < filenames.size(); ++i)
+			{
+				if (hashes[i].empty())
 				{
 					continue;
 				}
 
-				file["name"] = mapName + Maps::UserMapFiles[i];
-				file["size"] = fileBuffer.size();
-				file["hash"] = Utils::Cryptography::SHA256::Compute(fileBuffer, true);
+				std::unordered_map<std::string, nlohmann::json> file;
+				file["name"] = names[i];
+				file["size"] = Utils::IO::FileSize(filenames[i]);
+				file["hash"] = hashes[i];
 
 				fileList.emplace_back(file);
 			}
@@ -580,6 +767,104 @@ namespace Components
 		return { out };
 	}
 
+	enum class RangeResult
+	{
+		Ignored,
+		Satisfiable,
+		Unsatisfiable,
+	};
+
+	// Only single ranges are supported, anything else is answered with the full file
+	static RangeResult ParseRange(const std::string& header, const std::uint64_t size, std::uint64_t* start, std::uint64_t* end)
+	{
+		if (!header.starts_with("bytes=") || header.find(',') != std::string::npos)
+		{
+			return RangeResult::Ignored;
+		}
+
+		const auto spec = header.substr(6);
+		const auto dash = spec.find('-');
+		if (dash == std::string::npos)
+		{
+			return RangeResult::Ignored;
+		}
+
+		const auto first = spec.substr(0, dash);
+		const auto last = spec.substr(dash + 1);
+
+		if (first.empty())
+		{
+			// Suffix range, the last N bytes
+			const auto suffix = std::strtoull(last.data(), nullptr, 10);
+			if (!suffix || !size) return RangeResult::Unsatisfiable;
+
+			*start = size - std::min<std::uint64_t>(suffix, size);
+			*end = size - 1;
+			return RangeResult::Satisfiable;
+		}
+
+		*start = std::strtoull(first.data(), nullptr, 10);
+		*end = last.empty() ? size - 1 : std::min<std::uint64_t>(std::strtoull(last.data(), nullptr, 10), size - 1);
+
+		if (*start >= size || *start > *end)
+		{
+			return RangeResult::Unsatisfiable;
+		}
+
+		return RangeResult::Satisfiable;
+	}
+
+	static void RefillAllowance(std::int64_t* allowance, std::uint64_t* lastRefill, const std::int64_t rate, const std::uint64_t now)
+	{
+		const auto added = rate * static_cast<std::int64_t>(now - *lastRefill) / 1000;
+		if (added > 0)
+		{
+			// Allow bursts of up to one second worth of data
+			*allowance = std::min(*allowance + added, rate);
+			*lastRefill = now;
+		}
+	}
+
+	static void PumpTransfer(mg_connection* c, FileTransfer& transfer)
+	{
+		static char chunk[TransferChunkSize];
+
+		const auto now = mg_millis();
+		const std::int64_t rate = Download::SV_DownloadRate.get<int>() * 1024ll;
+		const std::int64_t totalRate = Download::SV_DownloadTotalRate.get<int>() * 1024ll;
+
+		if (rate) RefillAllowance(&transfer.allowance, &transfer.lastRefill, rate, now);
+		if (totalRate) RefillAllowance(&TotalAllowance, &TotalLastRefill, totalRate, now);
+
+		while (transfer.remaining && c->send.len < TransferWatermark)
+		{
+			auto size = std::min<std::int64_t>(sizeof(chunk), static_cast<std::int64_t>(std::min<std::uint64_t>(transfer.remaining, sizeof(chunk))));
+			if (rate) size = std::min(size, transfer.allowance);
+			if (totalRate) size = std::min(size, TotalAllowance);
+			if (size <= 0) break;
+
+			transfer.stream.read(chunk, size);
+			const auto count = transfer.stream.gcount();
+			if (count <= 0)
+			{
+				// The file was truncated while we were sending it
+				c->is_closing = TRUE;
+				return;
+			}
+
+			mg_send(c, chunk, static_cast<std::size_t>(count));
+
+			transfer.remaining -= count;
+			if (rate) transfer.allowance -= count;
+			if (totalRate) TotalAllowance -= count;
+		}
+
+		if (!transfer.remaining)
+		{
+			c->is_draining = TRUE;
+		}
+	}
+
 	static std::optional<std::string> FileHandler(mg_connection* c, const mg_http_message* hm)
 	{
 		std::string url(hm->uri.ptr, hm->uri.len);
@@ -626,21 +911,80 @@ namespace Components
 		const std::string fsGame = (*Game::fs_gameDirVar)->current.string;
 		const auto path = std::format("{}\\{}{}", (*Game::fs_basepath)->current.string, isMap ? ""s : (fsGame + "\\"s), url);
 
-		std::string file;
-		if ((!isMap && fsGame.empty()) || !Utils::IO::ReadFile(path, &file))
+		std::error_code ec;
+		const auto size = std::filesystem::file_size(path, ec);
+
+		FileTransfer transfer;
+		if (!ec && (isMap || !fsGame.empty()))
+		{
+			transfer.stream.open(path, std::ios::binary);
+		}
+
+		if (!transfer.stream.is_open())
 		{
 			mg_http_reply(c, 404, "Content-Type: text/html\r\n", "404 - Not Found %s", path.data());
+			return {};
 		}
-		else
+
+		// Hashing a large file would stall every other transfer, so until the background hash is cached the file goes out without an ETag
+		const auto hash = HashCache::PeekSHA256(path, true);
+		const auto etag = hash.empty() ? std::string() : std::format("\"{}\"", hash);
+
+		const auto* ifNoneMatch = mg_http_get_header(const_cast<mg_http_message*>(hm), "If-None-Match");
+		if (ifNoneMatch && !etag.empty())
 		{
-			mg_printf(c, "%s", "HTTP/1.1 200 OK\r\n");
-			mg_printf(c, "%s", "Content-Type: application/octet-stream\r\n");
-			mg_printf(c, "Content-Length: %d\r\n", static_cast<int>(file.size()));
-			mg_printf(c, "%s", "Connection: close\r\n");
-			mg_printf(c, "%s", "\r\n");
-			mg_send(c, file.data(), file.size());
+			const std::string value(ifNoneMatch->ptr, ifNoneMatch->len);
+			if (value == "*" || value.find(etag) != std::string::npos)
+			{
+				mg_printf(c, "HTTP/1.1 304 Not Modified\r\nETag: %s\r\nConnection: close\r\n\r\n", etag.data());
+				return {};
+			}
 		}
 
+		std::uint64_t start = 0;
+		std::uint64_t end = size ? size - 1 : 0;
+		auto partial = false;
+
+		if (const auto* range = mg_http_get_header(const_cast<mg_http_message*>(hm), "Range"))
+		{
+			switch (ParseRange(std::string(range->ptr, range->len), size, &start, &end))
+			{
+			case RangeResult::Satisfiable:
+				partial = true;
+				break;
+			case RangeResult::Unsatisfiable:
+				mg_printf(c, "HTTP/1.1 416 Range Not Satisfiable\r\nContent-Range: bytes */%s\r\nConnection: close\r\n\r\n", std::to_string(size).data());
+				return {};
+			case RangeResult::Ignored:
+				break;
+			}
+		}
+
+		const auto length = size ? end - start + 1 : 0;
+
+		std::string header = partial ? "HTTP/1.1 206 Partial Content\r\n" : "HTTP/1.1 200 OK\r\n";
+		header.append("Content-Type: application/octet-stream\r\n");
+		header.append(std::format("Content-Length: {}\r\n", length));
+		if (partial) header.append(std::format("Content-Range: bytes {}-{}/{}\r\n", start, end, size));
+		header.append("Accept-Ranges: bytes\r\n");
+		if (!etag.empty()) header.append(std::format("ETag: {}\r\n", etag));
+		header.append("Connection: close\r\n");
+		header.append("\r\n");
+		mg_send(c, header.data(), header.size());
+
+		if (!length)
+		{
+			return {};
+		}
+
+		transfer.stream.seekg(static_cast<std::streamoff>(start));
+		transfer.remaining = length;
+		transfer.allowance = 0;
+		transfer.lastRefill = mg_millis();
+
+		auto& entry = Transfers[c->id] = std::move(transfer);
+		PumpTransfer(c, entry);
+
 		return {};
 	}
 
@@ -678,6 +1022,23 @@ namespace Components
 			return f;
 		}();
 
+		if (ev == MG_EV_POLL || ev == MG_EV_WRITE)
+		{
+			if (const auto transfer = Transfers.find(c->id); transfer != Transfers.end())
+			{
+				PumpTransfer(c, transfer->second);
+				if (!transfer->second.remaining) Transfers.erase(transfer);
+			}
+
+			return;
+		}
+
+		if (ev == MG_EV_CLOSE)
+		{
+			Transfers.erase(c->id);
+			return;
+		}
+
 		if (ev != MG_EV_HTTP_MSG)
 		{
 			return;
@@ -710,7 +1071,16 @@ namespace Components
 		}
 
 		c->is_resp = FALSE; // This is important, the lack of this line of code will make the server die (in-game)
-		c->is_draining = TRUE;
+
+		// Streamed files close the connection once the last chunk is queued
+		if (const auto transfer = Transfers.find(c->id); transfer == Transfers.end())
+		{
+			c->is_draining = TRUE;
+		}
+		else if (!transfer->second.remaining)
+		{
+			Transfers.erase(transfer);
+		}
 	}
 
 #pragma endregion
@@ -755,7 +1125,8 @@ namespace Components
 
 					while (!Terminate)
 					{
-						mg_mgr_poll(&Mgr, 1000);
+						// Poll more often while files are streamed so throttled transfers keep flowing
+						mg_mgr_poll(&Mgr, Transfers.empty() ? 1000 : 50);
 					}
 				});
 			}
@@ -779,6 +1150,8 @@ namespace Components
 		{
 			SV_wwwDownload = Dvar::Register<bool>("sv_wwwDownload", false, Game::DVAR_NONE, "Set to true to enable downloading maps/mods from an external server.");
 			SV_wwwBaseUrl = Dvar::Register<const char*>("sv_wwwBaseUrl", "", Game::DVAR_NONE, "Set to the base url for the external map download.");
+			SV_DownloadRate = Dvar::Register<int>("sv_downloadRate", 0, 0, std::numeric_limits<int>::max() / 1024, Game::DVAR_NONE, "Maximum download speed per client in KB/s (0 = unlimited).");
+			SV_DownloadTotalRate = Dvar::Register<int>("sv_downloadTotalRate", 0, 0, std::numeric_limits<int>::max() / 1024, Game::DVAR_NONE, "Maximum download speed of all clients together in KB/s (0 = unlimited).");
 		});
 	}
 
@@ -803,4 +1176,170 @@ namespace Components
 			CLDownload.clear();
 		}
 	}
+
+	bool Download::unitTest()
+	{
+		using ServedFiles = std::unordered_map<std::string, std::string>;
+
+		ClientDownload download;
+		download.mod_ = "players/download_test";
+		download.wwwDownload_ = true;
+
+		Utils::IO::CreateDir(download.mod_);
+
+		ServedFiles served;
+		for (std::size_t i = 0; i < MaxConcurrentDownloads * 2; ++i)
+		{
+			ClientDownload::File file;
+			file.name = std::format("file{}.iwd", i);
+
+			std::string data(256 * 1024 * (i + 1) + i, '\0');
+			for (std::size_t j = 0; j < data.size(); ++j)
+			{
+				data[j] = static_cast<char>(j * 131 + (j >> 9) + i);
+			}
+
+			file.size = data.size();
+			file.hash = Utils::String::DumpHex(Utils::Cryptography::SHA256::Compute(data), "");
+
+			const auto path = download.mod_ + "/" + file.name;
+			Utils::IO::RemoveFile(path);
+			Utils::IO::RemoveFile(path + ".part");
+
+			served["/" + path] = std::move(data);
+			download.files_.emplace_back(std::move(file));
+		}
+
+		// Serves the files from memory and answers single ranges like the real file handler
+		const auto handler = [](mg_connection* c, const int ev, void* ev_data, void* fn_data)
+		{
+			if (ev != MG_EV_HTTP_MSG) return;
+
+			const auto* hm = static_cast<mg_http_message*>(ev_data);
+			const auto& files = *static_cast<ServedFiles*>(fn_data);
+
+			const auto file = files.find(std::string(hm->uri.ptr, hm->uri.len));
+			if (file == files.end())
+			{
+				mg_http_reply(c, 404, "Content-Type: text/html\r\n", "%s", "404 - Not Found");
+				return;
+			}
+
+			const auto& data = file->second;
+
+			std::uint64_t start = 0;
+			std::uint64_t end = data.size() - 1;
+			auto partial = false;
+
+			if (const auto* range = mg_http_get_header(const_cast<mg_http_message*>(hm), "Range"))
+			{
+				partial = ParseRange(std::string(range->ptr, range->len), data.size(), &start, &end) == RangeResult::Satisfiable;
+			}
+
+			const auto length = end - start + 1;
+			const auto header = std::format("HTTP/1.1 {}\r\nContent-Length: {}\r\nConnection: close\r\n\r\n", partial ? "206 Partial Content" : "200 OK", length);
+
+			mg_send(c, header.data(), header.size());
+			mg_send(c, data.data() + start, static_cast<std::size_t>(length));
+
+			c->is_resp = FALSE;
+			c->is_draining = TRUE;
+		};
+
+		mg_mgr mgr;
+		mg_mgr_init(&mgr);
+
+		std::uint16_t port = 0;
+		for (std::uint16_t candidate = 38960; candidate < 38976 && !port; ++candidate)
+		{
+			if (mg_http_listen(&mgr, Utils::String::VA("http://127.0.0.1:%hu", candidate), handler, &served))
+			{
+				port = candidate;
+			}
+		}
+
+		if (!port)
+		{
+			mg_mgr_free(&mgr);
+			Logger::PrintError(Game::CON_CHANNEL_ERROR, "Failed to bind a TCP socket for the download test\n");
+			return false;
+		}
+
+		std::atomic<bool> stop = false;
+		std::thread server([&]
+		{
+			while (!stop)
+			{
+				mg_mgr_poll(&mgr, 50);
+			}
+		});
+
+		const auto verify = [&]
+		{
+			for (const auto& file : download.files_)
+			{
+				const auto path = download.mod_ + "/" + file.name;
+				if (Utils::IO::ReadFile(path) != served.at("/" + path) || Utils::IO::FileExists(path + ".part")) return false;
+			}
+
+			return true;
+		};
+
+		auto result = true;
+		download.wwwBaseUrl_ = std::format("http://127.0.0.1:{}/", port);
+
+		auto downloaded = false;
+		const auto elapsed = Utils::Time::Measure<std::chrono::milliseconds>([&]
+		{
+			downloaded = DownloadFiles(&download) && verify();
+		});
+
+		if (!downloaded)
+		{
+			Logger::PrintError(Game::CON_CHANNEL_ERROR, "Parallel download failed at {}\n", download.failedFile_);
+			result = false;
+		}
+
+		Logger::Debug("Downloaded {} files with {} workers in {}ms", download.files_.size(), MaxConcurrentDownloads, elapsed.count());
+
+		// A part file left by an interrupted download is resumed with a range request
+		const auto& resumed = download.files_.back();
+		const auto resumedPath = download.mod_ + "/" + resumed.name;
+		Utils::IO::RemoveFile(resumedPath);
+		Utils::IO::WriteFile(resumedPath + ".part", served.at("/" + resumedPath).substr(0, resumed.size / 2));
+
+		if (result && (!DownloadFiles(&download) || !verify()))
+		{
+			Logger::PrintError(Game::CON_CHANNEL_ERROR, "Resuming {} failed\n", resumed.name);
+			result = false;
+		}
+
+		// HTTPS is only refused once a file actually has to be fetched
+		download.wwwBaseUrl_ = "https://127.0.0.1/";
+		if (result && !DownloadFiles(&download))
+		{
+			Logger::PrintError(Game::CON_CHANNEL_ERROR, "Download over HTTPS was refused although every file is present\n");
+			result = false;
+		}
+
+		Utils::IO::RemoveFile(resumedPath);
+		if (result && (DownloadFiles(&download) || download.failedReason_.empty()))
+		{
+			Logger::PrintError(Game::CON_CHANNEL_ERROR, "Download over HTTPS was not refused for a missing file\n");
+			result = false;
+		}
+
+		stop = true;
+		server.join();
+		mg_mgr_free(&mgr);
+
+		for (const auto& file : download.files_)
+		{
+			const auto path = download.mod_ + "/" + file.name;
+			Utils::IO::RemoveFile(path);
+			Utils::IO::RemoveFile(path + ".part");
+		}
+
+		return result;
+	}
 }
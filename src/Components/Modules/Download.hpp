@@ -9,12 +9,15 @@ namespace Components
 		~Download();
 
 		void preDestroy() override;
+		bool unitTest() override;
 
 		static void InitiateClientDownload(const std::string& mod, bool needPassword, bool map = false);
 		static void InitiateMapDownload(const std::string& map, bool needPassword);
 
 		static Dvar::Var SV_wwwDownload;
 		static Dvar::Var SV_wwwBaseUrl;
+		static Dvar::Var SV_DownloadRate;
+		static Dvar::Var SV_DownloadTotalRate;
 
 		static Dvar::Var UIDlTimeLeft;
 		static Dvar::Var UIDlProgress;
@@ -24,12 +27,13 @@ namespace Components
 		class ClientDownload
 		{
 		public:
-			ClientDownload(bool isMap = false) : running_(false), valid_(false), terminateThread_(false), isMap_(isMap), totalBytes_(0), downBytes_(0), lastTimeStamp_(0), timeStampBytes_(0) {}
+			ClientDownload(bool isMap = false) : running_(false), valid_(false), terminateThread_(false), failed_(false), isMap_(isMap), totalBytes_(0), downBytes_(0), lastTimeStamp_(0), timeStampBytes_(0), nextFile_(0), wwwDownload_(false) {}
 			~ClientDownload() { this->clear(); }
 
 			bool running_;
 			bool valid_;
-			bool terminateThread_;
+			std::atomic<bool> terminateThread_;
+			std::atomic<bool> failed_;
 			bool isMap_;
 			bool isPrivate_;
 			Network::Address target_;
@@ -37,11 +41,21 @@ namespace Components
 			std::string mod_;
 			std::thread thread_;
 
-			std::size_t totalBytes_;
-			std::size_t downBytes_;
+			std::atomic<std::size_t> totalBytes_;
+			std::atomic<std::size_t> downBytes_;
 
 			int lastTimeStamp_;
-			std::size_t timeStampBytes_;
+			std::atomic<std::size_t> timeStampBytes_;
+
+			// Shared between the file download workers
+			std::mutex mutex_;
+			std::atomic<std::size_t> nextFile_;
+			std::string failedFile_;
+			std::string failedReason_;
+
+			// Read from the dvars before the workers start
+			bool wwwDownload_;
+			std::string wwwBaseUrl_;
 
 			class File
 			{
@@ -82,10 +96,13 @@ namespace Components
 			int timestamp;
 			bool downloading;
 			unsigned int index;
-			std::string buffer;
 			std::size_t receivedBytes;
 		};
 
+		static constexpr std::size_t MaxConcurrentDownloads = 4;
+		static constexpr int MaxDownloadAttempts = 3;
+		static constexpr std::size_t PartChunkSize = 1024 * 1024;
+
 		static ClientDownload CLDownload;
 		static std::thread ServerThread;
 		static volatile bool Terminate;
@@ -97,7 +114,10 @@ namespace Components
 
 		static void ModDownloader(ClientDownload* download);
 		static bool ParseModList(ClientDownload* download, const std::string& list);
+		static std::string GetFileUrl(const ClientDownload* download, const ClientDownload::File& file, const std::string& path);
 		static bool DownloadFile(ClientDownload* download, unsigned int index);
+		static void FileDownloader(ClientDownload* download);
+		static bool DownloadFiles(ClientDownload* download);
 
 		static void LogFn(char c, void* param);
 	};
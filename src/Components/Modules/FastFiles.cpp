@@ -2,6 +2,9 @@
 
 #include <zlib.h>
 
+#include <Utils/Compression.hpp>
+#include <Utils/ZoneStream.hpp>
+
 #include "FastFiles.hpp"
 
 namespace Components
@@ -10,12 +13,16 @@ namespace Components
 	symmetric_CTR FastFiles::CurrentCTR;
 	std::vector<std::string> FastFiles::ZonePaths;
 
+	Utils::Concurrency::Container<FastFiles::ZoneIndex> FastFiles::ZoneFiles;
+	HANDLE FastFiles::ZoneWatcher = INVALID_HANDLE_VALUE;
+
 	Dvar::Var FastFiles::g_loadingInitialZones;
 
 	bool FastFiles::IsIW4xZone = false;
 	bool FastFiles::StreamRead = false;
 
-	char FastFiles::LastByteRead = 0;
+	Utils::ZoneStream::Deobfuscator FastFiles::Deobfuscator;
+	Utils::ZoneStream::KeystreamCache FastFiles::Keystream;
 
 	unsigned int FastFiles::CurrentZone;
 	unsigned int FastFiles::MaxZones;
@@ -227,15 +234,92 @@ namespace Components
 	// Name is a bit weird, due to FasFileS and ExistS :P
 	bool FastFiles::Exists(const std::string& file)
 	{
-		std::string path = FastFiles::GetZoneLocation(file.data());
-		path.append(file);
+		std::string zone = file;
+		if (!Utils::String::EndsWith(zone, ".ff"))
+		{
+			zone.append(".ff");
+		}
 
-		if (!Utils::String::EndsWith(path, ".ff"))
+		return FastFiles::ZoneFileExists(FastFiles::GetZoneLocation(file.data()), zone);
+	}
+
+	std::string FastFiles::NormalizeZonePath(const std::string& path)
+	{
+		auto normalized = Utils::String::ToLower(path);
+		std::replace(normalized.begin(), normalized.end(), '/', '\\');
+		return normalized;
+	}
+
+	std::unordered_set<std::string> FastFiles::ScanZoneDirectory(const std::string& directory)
+	{
+		std::unordered_set<std::string> files;
+
+		std::error_code ec;
+		for (std::filesystem::directory_iterator i(directory, ec), end; !ec && i != end; i.increment(ec))
 		{
-			path.append(".ff");
+			if (i->is_regular_file(ec))
+			{
+				files.emplace(Utils::String::ToLower(i->path().filename().string()));
+			}
 		}
 
-		return Utils::IO::FileExists(path);
+		return files;
+	}
+
+	bool FastFiles::ZoneFileExists(const std::string& directory, const std::string& file)
+	{
+		auto path = NormalizeZonePath(directory);
+		if (!path.empty() && !Utils::String::EndsWith(path, "\\"))
+		{
+			path.push_back('\\');
+		}
+
+		auto name = NormalizeZonePath(file);
+
+		// Keep any subdirectory of the file name with the directory
+		const auto separator = name.find_last_of('\\');
+		if (separator != std::string::npos)
+		{
+			path.append(name, 0, separator + 1);
+			name.erase(0, separator + 1);
+		}
+
+		return ZoneFiles.access<bool>([&](ZoneIndex& index)
+		{
+			auto entry = index.directories.find(path);
+			if (entry == index.directories.end())
+			{
+				// Directories are listed once and then answered from memory until the index is refreshed
+				entry = index.directories.emplace(path, ScanZoneDirectory(path.empty() ? "." : path)).first;
+			}
+
+			return entry->second.contains(name);
+		});
+	}
+
+	void FastFiles::RefreshZoneIndex()
+	{
+		ZoneFiles.access([](ZoneIndex& index)
+		{
+			index.directories.clear();
+		});
+	}
+
+	void FastFiles::WatchZoneDirectories()
+	{
+		if (ZoneWatcher == INVALID_HANDLE_VALUE)
+		{
+			if (!*Game::fs_basepath) return;
+
+			ZoneWatcher = FindFirstChangeNotificationA((*Game::fs_basepath)->current.string, TRUE, FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME);
+			if (ZoneWatcher == INVALID_HANDLE_VALUE) return;
+		}
+
+		if (WaitForSingleObject(ZoneWatcher, 0) == WAIT_OBJECT_0)
+		{
+			RefreshZoneIndex();
+			FindNextChangeNotification(ZoneWatcher);
+		}
 	}
 
 	bool FastFiles::Ready()
@@ -270,7 +354,7 @@ namespace Components
 				Utils::String::Replace(zone, "_load", "");
 			}
 
-			if (Utils::IO::FileExists(std::format("usermaps\\{}\\{}.ff", zone, filename)))
+			if (FastFiles::ZoneFileExists(std::format("usermaps\\{}\\", zone), filename + ".ff"))
 			{
 				return Utils::String::Format("usermaps\\{}\\", zone);
 			}
@@ -280,16 +364,16 @@ namespace Components
 
 		for (auto& path : paths)
 		{
-			auto absoluteFile = std::format("{}\\{}{}", dir, path, file);
+			std::string zone = file;
 
 			// No ".ff" appended, append it manually
-			if (!Utils::String::EndsWith(absoluteFile, ".ff"))
+			if (!Utils::String::EndsWith(zone, ".ff"))
 			{
-				absoluteFile.append(".ff");
+				zone.append(".ff");
 			}
 
 			// Check if FastFile exists
-			if (Utils::IO::FileExists(absoluteFile))
+			if (FastFiles::ZoneFileExists(std::format("{}\\{}", dir, path), zone))
 			{
 				return Utils::String::Format("{}", path);
 			}
@@ -348,7 +432,7 @@ namespace Components
 	void FastFiles::ReadHeaderStub(unsigned int* header, int size)
 	{
 		FastFiles::IsIW4xZone = false;
-		FastFiles::LastByteRead = 0;
+		FastFiles::Deobfuscator.reset();
 		Game::DB_ReadXFileUncompressed(header, size);
 
 		if (header[0] == XFILE_HEADER_IW4X)
@@ -387,6 +471,7 @@ namespace Components
 			rsa_free(&key);
 
 			ctr_start(aes, FastFiles::CurrentKey.iv, FastFiles::CurrentKey.key, sizeof(FastFiles::CurrentKey.key), 0, 0, &FastFiles::CurrentCTR);
+			FastFiles::Keystream.reset();
 		}
 
 		Utils::Hook::Call<void()>(0x46FAE0)();
@@ -417,8 +502,7 @@ namespace Components
 	{
 		if (Zones::Version() >= 319)
 		{
-			ctr_setiv(FastFiles::CurrentKey.iv, sizeof(FastFiles::CurrentKey.iv), &FastFiles::CurrentCTR);
-			ctr_decrypt(buffer, buffer, 8192, &FastFiles::CurrentCTR);
+			FastFiles::Keystream.decrypt(buffer, FastFiles::CurrentKey.iv, sizeof(FastFiles::CurrentKey.iv), &FastFiles::CurrentCTR);
 		}
 	}
 
@@ -471,15 +555,7 @@ namespace Components
 
 		if (FastFiles::IsIW4xZone)
 		{
-			for (int i = 0; i < size; ++i)
-			{
-				buffer[i] ^= FastFiles::LastByteRead;
-				Utils::RotLeft(buffer[i], 4);
-				buffer[i] ^= -1;
-				Utils::RotRight(buffer[i], 6);
-
-				FastFiles::LastByteRead = buffer[i];
-			}
+			FastFiles::Deobfuscator.process(buffer, size);
 		}
 	}
 
@@ -606,6 +682,14 @@ namespace Components
 			}, Scheduler::Pipeline::RENDERER);
 		}
 
+		// Zone lookups are answered from a directory index, drop it whenever files are added or removed
+		Scheduler::Loop(FastFiles::WatchZoneDirectories, Scheduler::Pipeline::ASYNC, 1s);
+
+		Command::Add("refreshZoneIndex", []
+		{
+			FastFiles::RefreshZoneIndex();
+		});
+
 		Command::Add("loadzone", [](const Command::Params* params)
 		{
 			if (params->size() < 2) return;
@@ -636,4 +720,148 @@ namespace Components
 		}, HOOK_CALL).install()/*->quick()*/;
 #endif
 	}
+
+	FastFiles::~FastFiles()
+	{
+		if (ZoneWatcher != INVALID_HANDLE_VALUE)
+		{
+			FindCloseChangeNotification(ZoneWatcher);
+			ZoneWatcher = INVALID_HANDLE_VALUE;
+		}
+	}
+
+	bool FastFiles::unitTest()
+	{
+		// A synthetic IW4x zone: obfuscated, compressed and encrypted in blocks that all restart at the IV, like the loader reads them
+		constexpr std::size_t zoneSize = 16 * 1024 * 1024;
+		constexpr auto blockSize = Utils::ZoneStream::KeystreamCache::BlockSize;
+
+		std::mt19937 random(1337);
+
+		std::string plain(zoneSize, '\0');
+		for (std::size_t i = 0; i < plain.size(); ++i)
+		{
+			plain[i] = static_cast<char>(random() % 4 ? i % 251 : random());
+		}
+
+		// Inverse of the deobfuscation, input = rotl2(output ^ 0xFF) ^ previous output
+		std::string obfuscated(plain);
+		std::uint8_t previous = 0;
+		for (auto& c : obfuscated)
+		{
+			const auto value = static_cast<std::uint8_t>(c) ^ 0xFF;
+			const auto output = static_cast<std::uint8_t>(c);
+
+			c = static_cast<char>(static_cast<std::uint8_t>((value << 2) | (value >> 6)) ^ previous);
+			previous = output;
+		}
+
+		auto compressed = Utils::Compression::ZLib::Compress(obfuscated);
+		const auto compressedSize = compressed.size();
+		compressed.resize((compressed.size() + blockSize - 1) / blockSize * blockSize);
+
+		register_cipher(&aes_desc);
+
+		Key key{};
+		std::generate(std::begin(key.key), std::end(key.key), [&random] { return static_cast<unsigned char>(random()); });
+		std::generate(std::begin(key.iv), std::end(key.iv), [&random] { return static_cast<unsigned char>(random()); });
+
+		symmetric_CTR ctr;
+		ctr_start(find_cipher("aes"), key.iv, key.key, sizeof(key.key), 0, 0, &ctr);
+
+		auto encrypted = compressed;
+		for (std::size_t i = 0; i < encrypted.size(); i += blockSize)
+		{
+			auto* block = reinterpret_cast<unsigned char*>(encrypted.data() + i);
+			ctr_setiv(key.iv, sizeof(key.iv), &ctr);
+			ctr_encrypt(block, block, blockSize, &ctr);
+		}
+
+		const auto initialCtr = ctr;
+
+		using Seconds = std::chrono::duration<double>;
+		const auto throughput = [](std::size_t size, Seconds elapsed)
+		{
+			return static_cast<double>(size) / (1024 * 1024) / std::max(elapsed.count(), 1e-9);
+		};
+
+		// Decrypt stage, the cipher state has to match after every block too
+		auto legacyDecrypted = encrypted;
+		auto decrypted = encrypted;
+		auto legacyCtr = initialCtr;
+		auto cachedCtr = initialCtr;
+		Utils::ZoneStream::KeystreamCache keystream;
+
+		const auto legacyDecrypt = Utils::Time::Measure<Seconds>([&]
+		{
+			for (std::size_t i = 0; i < legacyDecrypted.size(); i += blockSize)
+			{
+				auto* block = reinterpret_cast<unsigned char*>(legacyDecrypted.data() + i);
+				ctr_setiv(key.iv, sizeof(key.iv), &legacyCtr);
+				ctr_decrypt(block, block, blockSize, &legacyCtr);
+			}
+		});
+
+		const auto cachedDecrypt = Utils::Time::Measure<Seconds>([&]
+		{
+			for (std::size_t i = 0; i < decrypted.size(); i += blockSize)
+			{
+				keystream.decrypt(reinterpret_cast<std::uint8_t*>(decrypted.data() + i), key.iv, sizeof(key.iv), &cachedCtr);
+			}
+		});
+
+		if (decrypted != compressed || legacyDecrypted != compressed || std::memcmp(&legacyCtr, &cachedCtr, sizeof(symmetric_CTR)) != 0)
+		{
+			Logger::PrintError(Game::CON_CHANNEL_ERROR, "Zone decryption is not byte exact\n");
+			return false;
+		}
+
+		decrypted.resize(compressedSize);
+
+		std::string inflated;
+		const auto inflate = Utils::Time::Measure<Seconds>([&]
+		{
+			inflated = Utils::Compression::ZLib::Decompress(decrypted);
+		});
+
+		if (inflated != obfuscated)
+		{
+			Logger::PrintError(Game::CON_CHANNEL_ERROR, "Synthetic zone did not inflate\n");
+			return false;
+		}
+
+		// Deobfuscate stage, fed in uneven reads like the asset loaders do
+		auto legacyPlain = inflated;
+		Utils::ZoneStream::Deobfuscator legacyDeobfuscator, deobfuscator;
+
+		const auto readSize = [](std::size_t offset) { return 1 + (offset * 2654435761u) % 173; };
+
+		const auto legacyDeobfuscate = Utils::Time::Measure<Seconds>([&]
+		{
+			for (std::size_t i = 0; i < legacyPlain.size(); i += readSize(i))
+			{
+				legacyDeobfuscator.processBytes(legacyPlain.data() + i, std::min(readSize(i), legacyPlain.size() - i));
+			}
+		});
+
+		const auto wordDeobfuscate = Utils::Time::Measure<Seconds>([&]
+		{
+			for (std::size_t i = 0; i < inflated.size(); i += readSize(i))
+			{
+				deobfuscator.process(inflated.data() + i, std::min(readSize(i), inflated.size() - i));
+			}
+		});
+
+		if (inflated != plain || legacyPlain != plain)
+		{
+			Logger::PrintError(Game::CON_CHANNEL_ERROR, "Zone deobfuscation is not byte exact\n");
+			return false;
+		}
+
+		Logger::Print("Zone decrypt: {:.1f} MB/s per block AES, {:.1f} MB/s cached keystream\n", throughput(encrypted.size(), legacyDecrypt), throughput(encrypted.size(), cachedDecrypt));
+		Logger::Print("Zone inflate: {:.1f} MB/s\n", throughput(plain.size(), inflate));
+		Logger::Print("Zone deobfuscate: {:.1f} MB/s bytewise, {:.1f} MB/s wordwise\n", throughput(plain.size(), legacyDeobfuscate), throughput(plain.size(), wordDeobfuscate));
+
+		return true;
+	}
 }
@@ -6,12 +6,18 @@ namespace Components
 	{
 	public:
 		FastFiles();
+		~FastFiles();
+
+		bool unitTest() override;
 
 		static void AddZonePath(const std::string& path);
 		static std::string Current();
 		static bool Ready();
 		static bool Exists(const std::string& file);
 
+		// Drops the cached directory listings, call this after zone files were added or removed
+		static void RefreshZoneIndex();
+
 		static void LoadLocalizeZones(Game::XZoneInfo *zoneInfo, unsigned int zoneCount, int sync);
 
 		static float GetFullLoadedFraction();
@@ -38,13 +44,27 @@ namespace Components
 		static bool IsIW4xZone;
 		static bool StreamRead;
 
-		static char LastByteRead;
+		static Utils::ZoneStream::Deobfuscator Deobfuscator;
+		static Utils::ZoneStream::KeystreamCache Keystream;
 
 		static Dvar::Var g_loadingInitialZones;
 
+		struct ZoneIndex
+		{
+			std::unordered_map<std::string, std::unordered_set<std::string>> directories;
+		};
+
+		static Utils::Concurrency::Container<ZoneIndex> ZoneFiles;
+		static HANDLE ZoneWatcher;
+
 		static Key CurrentKey;
 		static std::vector<std::string> ZonePaths;
 		static const char* GetZoneLocation(const char* file);
+
+		static std::string NormalizeZonePath(const std::string& path);
+		static std::unordered_set<std::string> ScanZoneDirectory(const std::string& directory);
+		static bool ZoneFileExists(const std::string& directory, const std::string& file);
+		static void WatchZoneDirectories();
 		static void LoadInitialZones(Game::XZoneInfo *zoneInfo, unsigned int zoneCount, int sync);
 		static void LoadDLCUIZones(Game::XZoneInfo *zoneInfo, unsigned int zoneCount, int sync);
 		static void LoadGfxZones(Game::XZoneInfo *zoneInfo, unsigned int zoneCount, int sync);
@@ -9,10 +9,359 @@ namespace Components::GSC
 {
 	const char* IO::ForbiddenStrings[] = { R"(..)", R"(../)", R"(..\)" };
 
-	FILE* IO::openScriptIOFileHandle;
+	IO::FileTable IO::Files;
+	int IO::LastHandle;
 
 	std::filesystem::path IO::DefaultDestPath;
 
+	int IO::FileTable::open(const std::filesystem::path& path, const Mode mode)
+	{
+		const auto slot = std::ranges::find(this->handles_, nullptr);
+		if (slot == std::end(this->handles_))
+		{
+			return 0;
+		}
+
+		auto file = std::make_shared<File>();
+		file->path = path;
+		file->mode = mode;
+		*slot = file;
+
+		this->push(file, { OperationType::Open });
+
+		if (mode == Mode::Read)
+		{
+			this->push(file, { OperationType::Prefetch });
+		}
+
+		return static_cast<int>(slot - std::begin(this->handles_)) + 1;
+	}
+
+	bool IO::FileTable::write(const int handle, const std::string_view& text)
+	{
+		auto file = this->get(handle);
+		if (!file || file->mode == Mode::Read)
+		{
+			return false;
+		}
+
+		this->push(file, { OperationType::Write, std::string(text) });
+		return true;
+	}
+
+	bool IO::FileTable::flush(const int handle)
+	{
+		auto file = this->get(handle);
+		if (!file || file->mode == Mode::Read)
+		{
+			return false;
+		}
+
+		this->push(file, { OperationType::Flush });
+		return true;
+	}
+
+	bool IO::FileTable::close(const int handle, int* result)
+	{
+		const auto file = this->get(handle);
+		if (!file)
+		{
+			return false;
+		}
+
+		// The handle can be reused right away, the file stays alive until the worker closed it
+		this->handles_[handle - 1] = nullptr;
+		this->push(file, { OperationType::Close });
+
+		if (result)
+		{
+			this->waitFile(file);
+			*result = file->closeResult;
+		}
+
+		return true;
+	}
+
+	void IO::FileTable::closeAll()
+	{
+		for (std::size_t i = 0; i < MaxHandles; ++i)
+		{
+			this->close(static_cast<int>(i) + 1);
+		}
+	}
+
+	std::optional<std::string> IO::FileTable::readLine(const int handle)
+	{
+		const auto file = this->get(handle);
+		if (!file || file->mode != Mode::Read)
+		{
+			return {};
+		}
+
+		while (true)
+		{
+			const auto available = file->chunk.size() - file->offset;
+			const auto end = file->chunk.find('\n', file->offset);
+
+			if (end == std::string::npos && available < MaxLineLength && this->takeNext(file))
+			{
+				continue;
+			}
+
+			if (!available)
+			{
+				return {};
+			}
+
+			const auto length = std::min(end == std::string::npos ? available : end - file->offset + 1, MaxLineLength);
+			auto line = file->chunk.substr(file->offset, length);
+			file->offset += length;
+
+			return line;
+		}
+	}
+
+	bool IO::FileTable::atEnd(const int handle) const
+	{
+		const auto file = this->get(handle);
+		if (!file || file->mode != Mode::Read)
+		{
+			return false;
+		}
+
+		std::lock_guard _(file->mutex);
+		return file->eof && !file->failed && file->offset == file->chunk.size();
+	}
+
+	void IO::FileTable::writeFile(const std::filesystem::path& path, const std::string_view& text, const bool append)
+	{
+		const auto file = std::make_shared<File>();
+		file->path = path;
+		file->mode = append ? Mode::Append : Mode::Write;
+
+		this->push(file, { OperationType::Open });
+		this->push(file, { OperationType::Write, std::string(text) });
+		this->push(file, { OperationType::Close });
+	}
+
+	void IO::FileTable::wait(const std::filesystem::path& path)
+	{
+		for (const auto& file : this->getPending())
+		{
+			if (file->path == path)
+			{
+				this->run(file);
+			}
+		}
+	}
+
+	void IO::FileTable::drain()
+	{
+		this->drainQueued_ = false;
+
+		for (const auto& file : this->getPending())
+		{
+			this->run(file);
+		}
+	}
+
+	std::shared_ptr<IO::FileTable::File> IO::FileTable::get(const int handle) const
+	{
+		if (handle < 1 || handle > static_cast<int>(MaxHandles))
+		{
+			return nullptr;
+		}
+
+		return this->handles_[handle - 1];
+	}
+
+	std::vector<std::shared_ptr<IO::FileTable::File>> IO::FileTable::getPending()
+	{
+		return this->pending_.access<std::vector<std::shared_ptr<File>>>([](const std::vector<std::shared_ptr<File>>& pending)
+		{
+			return pending;
+		});
+	}
+
+	bool IO::FileTable::takeNext(const std::shared_ptr<File>& file)
+	{
+		std::unique_lock lock(file->mutex);
+
+		if (!file->nextReady)
+		{
+			if (file->eof)
+			{
+				return false;
+			}
+
+			// The script outran the worker, finish the prefetch on this thread
+			lock.unlock();
+			this->waitFile(file);
+			lock.lock();
+
+			assert(file->nextReady);
+		}
+
+		file->nextReady = false;
+
+		if (file->next.empty())
+		{
+			file->eof = true;
+			return false;
+		}
+
+		// Only the unread tail of a line is left, it is short
+		file->chunk.erase(0, file->offset);
+		file->chunk.append(file->next);
+		file->offset = 0;
+		file->next.clear();
+
+		const auto eof = file->eof;
+		lock.unlock();
+
+		if (!eof)
+		{
+			this->push(file, { OperationType::Prefetch });
+		}
+
+		return true;
+	}
+
+	void IO::FileTable::push(const std::shared_ptr<File>& file, Operation&& operation)
+	{
+		{
+			std::lock_guard _(file->mutex);
+			auto& operations = file->operations;
+
+			// Consecutive writes to a file go out in a single fwrite
+			if (operation.type == OperationType::Write && !operations.empty() && operations.back().type == OperationType::Write)
+			{
+				operations.back().data.append(operation.data);
+			}
+			else
+			{
+				operations.emplace_back(std::move(operation));
+			}
+
+			if (!file->pending)
+			{
+				file->pending = true;
+				this->pending_.access([&file](std::vector<std::shared_ptr<File>>& pending)
+				{
+					pending.push_back(file);
+				});
+			}
+		}
+
+		if (!this->drainQueued_.exchange(true))
+		{
+			Scheduler::Once([this]
+			{
+				this->drain();
+			}, Scheduler::Pipeline::ASYNC);
+		}
+	}
+
+	void IO::FileTable::waitFile(const std::shared_ptr<File>& file)
+	{
+		// A file is read after an earlier handle wrote it, no matter which one is waited for
+		for (const auto& other : this->getPending())
+		{
+			if (other == file) break;
+
+			if (other->path == file->path)
+			{
+				this->run(other);
+			}
+		}
+
+		this->run(file);
+	}
+
+	void IO::FileTable::run(const std::shared_ptr<File>& file)
+	{
+		// Whoever got here first carries out what is queued, the other one then finds less or nothing left
+		std::lock_guard _(file->ioMutex);
+
+		{
+			// Swap buffers so neither side allocates once both have grown
+			std::lock_guard lock(file->mutex);
+			file->running.swap(file->operations);
+		}
+
+		for (auto& operation : file->running)
+		{
+			Execute(*file, operation);
+		}
+
+		file->running.clear();
+
+		std::lock_guard lock(file->mutex);
+		if (file->pending && file->operations.empty())
+		{
+			file->pending = false;
+			this->pending_.access([&file](std::vector<std::shared_ptr<File>>& pending)
+			{
+				std::erase(pending, file);
+			});
+		}
+	}
+
+	void IO::FileTable::Execute(File& file, Operation& operation)
+	{
+		switch (operation.type)
+		{
+		case OperationType::Open:
+		{
+			std::error_code ec;
+			if (file.mode != Mode::Read && file.path.has_parent_path())
+			{
+				std::filesystem::create_directories(file.path.parent_path(), ec);
+			}
+
+			// Text mode for reading, scripts always got their lines without the carriage return
+			const auto* mode = file.mode == Mode::Read ? "r" : (file.mode == Mode::Append ? "ab" : "wb");
+			if (fopen_s(&file.handle, file.path.string().data(), mode) || !file.handle)
+			{
+				file.handle = nullptr;
+				Logger::PrintError(Game::CON_CHANNEL_PARSERSCRIPT, "Failed to open '{}'\n", file.path.string());
+			}
+			break;
+		}
+		case OperationType::Write:
+			if (file.handle)
+			{
+				std::fwrite(operation.data.data(), 1, operation.data.size(), file.handle);
+			}
+			break;
+		case OperationType::Flush:
+			if (file.handle)
+			{
+				std::fflush(file.handle);
+			}
+			break;
+		case OperationType::Close:
+			if (file.handle)
+			{
+				file.closeResult = std::fclose(file.handle);
+				file.handle = nullptr;
+			}
+			break;
+		case OperationType::Prefetch:
+		{
+			std::string data(ChunkSize, '\0');
+			data.resize(file.handle ? std::fread(data.data(), 1, data.size(), file.handle) : 0);
+
+			std::lock_guard _(file.mutex);
+			file.next = std::move(data);
+			file.nextReady = true;
+			file.eof = !file.handle || std::feof(file.handle) || std::ferror(file.handle);
+			file.failed = !file.handle || std::ferror(file.handle);
+			break;
+		}
+		}
+	}
+
 	bool IO::ValidatePath(const char* function, const char* path)
 	{
 		for (std::size_t i = 0; i < std::extent_v<decltype(ForbiddenStrings)>; ++i)
@@ -38,6 +387,17 @@ namespace Components::GSC
 		return DefaultDestPath / "scriptdata"s / path;
 	}
 
+	int IO::GetHandle()
+	{
+		// Scripts written when there was only one file handle don't pass it
+		if (!Game::Scr_GetNumParam())
+		{
+			return LastHandle;
+		}
+
+		return Game::Scr_GetInt(0);
+	}
+
 	void IO::GScr_OpenFile()
 	{
 		const auto* filepath = Game::Scr_GetString(0);
@@ -49,68 +409,122 @@ namespace Components::GSC
 			return;
 		}
 
-		if (mode != "read"s)
+		FileTable::Mode fileMode;
+		if (mode == "read"s)
 		{
-			Logger::PrintError(Game::CON_CHANNEL_PARSERSCRIPT, "Valid openfile modes are 'read'\n");
-			Game::Scr_AddInt(-1);
-			return;
+			fileMode = FileTable::Mode::Read;
 		}
-
-		if (openScriptIOFileHandle)
+		else if (mode == "write"s)
+		{
+			fileMode = FileTable::Mode::Write;
+		}
+		else if (mode == "append"s)
+		{
+			fileMode = FileTable::Mode::Append;
+		}
+		else
 		{
-			Logger::PrintError(Game::CON_CHANNEL_PARSERSCRIPT, "OpenFile failed. {} files already open\n", 1);
+			Logger::PrintError(Game::CON_CHANNEL_PARSERSCRIPT, "Valid openfile modes are 'read', 'write' and 'append'\n");
 			Game::Scr_AddInt(-1);
 			return;
 		}
 
 		const auto dest = BuildPath(filepath);
 
-		_set_errno(0);
-		const auto result = fopen_s(&openScriptIOFileHandle, dest.string().data(), "r");
-		if (result || !openScriptIOFileHandle)
+		if (fileMode == FileTable::Mode::Read && !Utils::IO::FileExists(dest.string()))
+		{
+			// It may only be missing because a queued write did not create it yet
+			Files.wait(dest);
+
+			if (!Utils::IO::FileExists(dest.string()))
+			{
+				Logger::PrintError(Game::CON_CHANNEL_PARSERSCRIPT, "OpenFile failed. '{}' does not exist\n", filepath);
+				Game::Scr_AddInt(-1);
+				return;
+			}
+		}
+
+		const auto handle = Files.open(dest, fileMode);
+		if (!handle)
 		{
-			Logger::PrintError(Game::CON_CHANNEL_PARSERSCRIPT, "OpenFile failed. '{}'", result);
+			Logger::PrintError(Game::CON_CHANNEL_PARSERSCRIPT, "OpenFile failed. {} files already open\n", FileTable::MaxHandles);
 			Game::Scr_AddInt(-1);
 			return;
 		}
 
-		Game::Scr_AddInt(1);
+		LastHandle = handle;
+		Game::Scr_AddInt(handle);
 	}
 
 	void IO::GScr_ReadStream()
 	{
-		if (!openScriptIOFileHandle)
+		const auto handle = GetHandle();
+		if (!Files.isOpen(handle))
 		{
 			Logger::PrintError(Game::CON_CHANNEL_PARSERSCRIPT, "ReadStream failed. File stream was not opened\n");
 			return;
 		}
 
-		char line[1024]{};
-		if (std::fgets(line, sizeof(line), openScriptIOFileHandle) != nullptr)
+		if (const auto line = Files.readLine(handle))
 		{
-			Game::Scr_AddString(line);
+			Game::Scr_AddString(line->data());
 			return;
 		}
 
 		Logger::Warning(Game::CON_CHANNEL_PARSERSCRIPT, "ReadStream failed.\n");
-		
-		if (std::feof(openScriptIOFileHandle))
+
+		if (Files.atEnd(handle))
 		{
 			Logger::Print(Game::CON_CHANNEL_PARSERSCRIPT, "ReadStream: EOF reached\n");
 		}
 	}
 
+	void IO::GScr_WriteStream()
+	{
+		const auto handle = Game::Scr_GetInt(0);
+		const auto* text = Game::Scr_GetString(1);
+
+		if (!Files.write(handle, text))
+		{
+			Logger::PrintError(Game::CON_CHANNEL_PARSERSCRIPT, "WriteStream failed. File stream was not opened for writing\n");
+			Game::Scr_AddInt(-1);
+			return;
+		}
+
+		Game::Scr_AddInt(1);
+	}
+
+	void IO::GScr_FlushFile()
+	{
+		if (!Files.flush(GetHandle()))
+		{
+			Logger::PrintError(Game::CON_CHANNEL_PARSERSCRIPT, "FlushFile failed. File stream was not opened for writing\n");
+			Game::Scr_AddInt(-1);
+			return;
+		}
+
+		Game::Scr_AddInt(1);
+	}
+
 	void IO::GScr_CloseFile()
 	{
-		if (!openScriptIOFileHandle)
+		const auto handle = GetHandle();
+
+		// Waits for this file's writes, scripts get what fclose returned like they used to
+		int result;
+		if (!Files.close(handle, &result))
 		{
 			Logger::PrintError(Game::CON_CHANNEL_PARSERSCRIPT, "CloseFile failed. File stream was not opened\n");
 			Game::Scr_AddInt(-1);
 			return;
 		}
 
-		Game::Scr_AddInt(std::fclose(openScriptIOFileHandle));
-		openScriptIOFileHandle = nullptr;
+		if (handle == LastHandle)
+		{
+			LastHandle = 0;
+		}
+
+		Game::Scr_AddInt(result);
 	}
 
 	void IO::AddScriptFunctions()
@@ -133,8 +547,7 @@ namespace Components::GSC
 			}
 
 			const auto append = mode == "append"s;
-			const auto dest = BuildPath(filepath);
-			Utils::IO::WriteFile(dest.string(), text, append);
+			Files.writeFile(BuildPath(filepath), text, append);
 		});
 
 		Script::AddFunction("FileRead", [] // gsc: FileRead(<filepath>)
@@ -146,6 +559,7 @@ namespace Components::GSC
 			}
 
 			const auto dest = BuildPath(filepath);
+			Files.wait(dest);
 
 			std::string file;
 			if (!Utils::IO::ReadFile(dest.string(), &file))
@@ -167,6 +581,8 @@ namespace Components::GSC
 			}
 
 			const auto dest = BuildPath(filepath);
+			Files.wait(dest);
+
 			Game::Scr_AddBool(Utils::IO::FileExists(dest.string()));
 		});
 
@@ -179,6 +595,8 @@ namespace Components::GSC
 			}
 
 			const auto dest = BuildPath(filepath);
+			Files.wait(dest);
+
 			Game::Scr_AddBool(Utils::IO::RemoveFile(dest.string()));
 		});
 
@@ -193,6 +611,8 @@ namespace Components::GSC
 
 			const auto from = BuildPath(filepath);
 			const auto to = BuildPath(destpath);
+			Files.wait(from);
+			Files.wait(to);
 
 			std::error_code err;
 			std::filesystem::rename(from, to, err);
@@ -217,6 +637,8 @@ namespace Components::GSC
 
 			const auto from = BuildPath(filepath);
 			const auto to = BuildPath(destpath);
+			Files.wait(from);
+			Files.wait(to);
 
 			std::error_code err;
 			std::filesystem::copy(from, to, err);
@@ -230,12 +652,205 @@ namespace Components::GSC
 			Game::Scr_AddInt(1);
 		});
 
-		Script::AddFunction("ReadStream", GScr_ReadStream);
+		Script::AddFunction("ReadStream", GScr_ReadStream); // gsc: ReadStream(<handle>)
+		Script::AddFunction("WriteStream", GScr_WriteStream); // gsc: WriteStream(<handle>, <string>)
+		Script::AddFunction("FlushFile", GScr_FlushFile); // gsc: FlushFile(<handle>)
+	}
+
+	bool IO::unitTest()
+	{
+		// Static, so a drain that is still queued can't touch a dead stack frame
+		static FileTable files;
+
+		const std::filesystem::path folder = "players/scriptio_test";
+		std::error_code ec;
+		std::filesystem::remove_all(folder, ec);
+
+		std::mt19937 random(1337);
+		const auto makeLine = [&random](std::size_t index)
+		{
+			// Mostly short stat lines, now and then one longer than a script string can hold
+			const std::size_t length = index % 97 == 0 ? 1500 + random() % 3000 : random() % 120;
+
+			auto line = std::format("{}:", index);
+			while (line.size() < length)
+			{
+				line.push_back(static_cast<char>('a' + random() % 26));
+			}
+
+			line.push_back('\n');
+			return line;
+		};
+
+		std::string source;
+		for (std::size_t i = 0; source.size() < 4 * 1024 * 1024; ++i)
+		{
+			source.append(makeLine(i));
+		}
+
+		const auto sourcePath = folder / "source.txt";
+		Utils::IO::WriteFile(sourcePath.string(), source);
+
+		// A gametype logging stats for every player and replaying a match file, one batch per server frame
+		constexpr auto frameInterval = 10ms;
+		constexpr std::size_t frames = 100;
+		constexpr std::size_t writers = 8;
+		constexpr std::size_t linesPerFrame = 10;
+		constexpr std::size_t readsPerFrame = 500;
+
+		std::vector<std::vector<std::string>> lines(frames * writers);
+		for (auto& batch : lines)
+		{
+			for (std::size_t i = 0; i < linesPerFrame; ++i)
+			{
+				batch.push_back(makeLine(i + 1));
+			}
+		}
+
+		std::vector<std::string> legacyPaths;
+		std::vector<std::filesystem::path> queuedPaths;
+		for (std::size_t writer = 0; writer < writers; ++writer)
+		{
+			legacyPaths.push_back((folder / std::format("legacy_{}.txt", writer)).string());
+			queuedPaths.push_back(folder / std::format("queued_{}.txt", writer));
+		}
+
+		using frameTimes = std::pair<std::chrono::microseconds, std::chrono::microseconds>;
+		const auto runFrames = [&](const std::function<void(std::size_t)>& frame)
+		{
+			frameTimes times{};
+			for (std::size_t i = 0; i < frames; ++i)
+			{
+				const auto nextFrame = std::chrono::high_resolution_clock::now() + frameInterval;
+				const auto duration = Utils::Time::Measure([&] { frame(i); });
+
+				times.first = std::max(times.first, duration);
+				times.second += duration;
+
+				// The server idles until its next frame, that's when the worker catches up
+				std::this_thread::sleep_until(nextFrame);
+			}
+
+			return times;
+		};
+
+		// What scripts had to do before, reopen a file for every line and read with a single handle
+		std::FILE* legacyStream{};
+		fopen_s(&legacyStream, sourcePath.string().data(), "r");
+		if (!legacyStream)
+		{
+			Logger::PrintError(Game::CON_CHANNEL_ERROR, "Failed to open the script IO test file\n");
+			return false;
+		}
+
+		const auto legacy = runFrames([&](std::size_t frame)
+		{
+			for (std::size_t writer = 0; writer < writers; ++writer)
+			{
+				for (const auto& line : lines[frame * writers + writer])
+				{
+					Utils::IO::WriteFile(legacyPaths[writer], line, true);
+				}
+			}
+
+			char line[1024]{};
+			for (std::size_t i = 0; i < readsPerFrame; ++i)
+			{
+				if (!std::fgets(line, sizeof(line), legacyStream)) break;
+			}
+		});
+
+		std::fclose(legacyStream);
+
+		int handles[writers];
+		for (std::size_t writer = 0; writer < writers; ++writer)
+		{
+			handles[writer] = files.open(queuedPaths[writer], FileTable::Mode::Write);
+		}
+
+		const auto reader = files.open(sourcePath, FileTable::Mode::Read);
+		std::string read;
+		read.reserve(source.size());
+
+		const auto queued = runFrames([&](std::size_t frame)
+		{
+			for (std::size_t writer = 0; writer < writers; ++writer)
+			{
+				for (const auto& line : lines[frame * writers + writer])
+				{
+					files.write(handles[writer], line);
+				}
+
+				if (frame % 25 == 24)
+				{
+					files.flush(handles[writer]);
+				}
+			}
+
+			for (std::size_t i = 0; i < readsPerFrame; ++i)
+			{
+				const auto line = files.readLine(reader);
+				if (!line) break;
+
+				read.append(*line);
+			}
+		});
+
+		// Whatever the frames didn't get to has to come out the same way
+		while (const auto line = files.readLine(reader))
+		{
+			if (line->size() > FileTable::MaxLineLength)
+			{
+				Logger::PrintError(Game::CON_CHANNEL_ERROR, "Read a line of {} characters from a script file\n", line->size());
+				return false;
+			}
+
+			read.append(*line);
+		}
+
+		files.closeAll();
+
+		// A file written and then read has to be read after the write made it to disk
+		files.writeFile(folder / "roundtrip.txt", "written\n", false);
+		const auto roundtrip = files.open(folder / "roundtrip.txt", FileTable::Mode::Read);
+		const auto roundtripLine = files.readLine(roundtrip);
+		const auto roundtripEnd = !files.readLine(roundtrip) && files.atEnd(roundtrip);
+		files.close(roundtrip);
+
+		// Waiting on a path or closing with a result only carries out that file's operations, they have to be done after
+		files.writeFile(folder / "waited.txt", "waited\n", false);
+		files.wait(folder / "waited.txt");
+		const auto waited = Utils::IO::ReadFile((folder / "waited.txt").string()) == "waited\n"s;
+
+		auto closeResult = -1;
+		const auto closed = files.open(folder / "closed.txt", FileTable::Mode::Write);
+		files.write(closed, "closed\n");
+		files.close(closed, &closeResult);
+		const auto closedWritten = closeResult == 0 && Utils::IO::ReadFile((folder / "closed.txt").string()) == "closed\n"s;
+
+		files.drain();
+
+		auto result = read == source && roundtripLine == "written\n"s && roundtripEnd && waited && closedWritten;
+		for (std::size_t writer = 0; writer < writers && result; ++writer)
+		{
+			result = Utils::IO::ReadFile(queuedPaths[writer].string()) == Utils::IO::ReadFile(legacyPaths[writer]);
+		}
+
+		std::filesystem::remove_all(folder, ec);
+
+		if (!result)
+		{
+			Logger::PrintError(Game::CON_CHANNEL_ERROR, "Queued script IO did not produce the same files as synchronous IO\n");
+			return false;
+		}
+
+		Logger::Print("Script IO over {} frames: worst frame {}us, total {}ms queued / worst frame {}us, total {}ms synchronous\n",
+			frames, queued.first.count(), queued.second.count() / 1000, legacy.first.count(), legacy.second.count() / 1000);
+		return true;
 	}
 
 	IO::IO()
 	{
-		openScriptIOFileHandle = nullptr;
 		DefaultDestPath = "userraw"s;
 
 		AddScriptFunctions();
@@ -248,11 +863,14 @@ namespace Components::GSC
 
 		Events::OnVMShutdown([]
 		{
-			if (openScriptIOFileHandle)
-			{
-				std::fclose(openScriptIOFileHandle);
-				openScriptIOFileHandle = nullptr;
-			}
+			Files.closeAll();
+			LastHandle = 0;
 		});
 	}
+
+	void IO::preDestroy()
+	{
+		Files.closeAll();
+		Files.drain();
+	}
 }
@@ -7,18 +7,131 @@ namespace Components::GSC
 	public:
 		IO();
 
+		void preDestroy() override;
+		bool unitTest() override;
+
 	private:
+		// Files opened by scripts. Every operation is queued in order per file and carried out by an ASYNC worker,
+		// so a frame never waits on the disk unless it needs the result of a file's operations right away.
+		// Waiting only carries out what was queued for that file, not what is pending for any other
+		class FileTable
+		{
+		public:
+			static constexpr std::size_t MaxHandles = 32;
+			static constexpr std::size_t ChunkSize = 64 * 1024;
+			static constexpr std::size_t MaxLineLength = 1024 - 1; // 1024 is the max string size for the SL system
+
+			enum class Mode
+			{
+				Read,
+				Write,
+				Append,
+			};
+
+			// Returns a handle from 1 to MaxHandles, 0 if they are all in use
+			int open(const std::filesystem::path& path, Mode mode);
+			bool write(int handle, const std::string_view& text);
+			bool flush(int handle);
+
+			// With result, waits for the file's operations and returns what fclose returned
+			bool close(int handle, int* result = nullptr);
+			void closeAll();
+
+			// Next line including its line break, lines longer than MaxLineLength are split. Nothing once the file is exhausted
+			std::optional<std::string> readLine(int handle);
+
+			// Whether readLine came up empty because the file was read to its end, rather than because reading failed
+			[[nodiscard]] bool atEnd(int handle) const;
+
+			// Writes a whole file in order with everything else that is queued for its path
+			void writeFile(const std::filesystem::path& path, const std::string_view& text, bool append);
+
+			// Carries out everything that was queued for files at the path so far on the calling thread
+			void wait(const std::filesystem::path& path);
+
+			// Carries out everything that was queued so far on the calling thread
+			void drain();
+
+			[[nodiscard]] bool isOpen(int handle) const
+			{
+				return this->get(handle) != nullptr;
+			}
+
+		private:
+			enum class OperationType
+			{
+				Open,
+				Write,
+				Flush,
+				Close,
+				Prefetch,
+			};
+
+			struct Operation
+			{
+				OperationType type;
+				std::string data;
+			};
+
+			struct File
+			{
+				std::filesystem::path path;
+				Mode mode;
+
+				// Held while the file's operations are carried out, nothing else touches these
+				std::mutex ioMutex;
+				std::vector<Operation> running;
+				std::FILE* handle{};
+				int closeResult = -1;
+
+				// Only touched by the reader
+				std::string chunk;
+				std::size_t offset{};
+
+				// Shared by the script side and whoever carries out the operations
+				std::mutex mutex;
+				std::vector<Operation> operations;
+				bool pending{};
+				std::string next;
+				bool nextReady{};
+				bool eof{};
+				bool failed{};
+			};
+
+			std::shared_ptr<File> handles_[MaxHandles];
+
+			// Files that have operations queued, in the order they got them
+			Utils::Concurrency::Container<std::vector<std::shared_ptr<File>>> pending_;
+			std::atomic<bool> drainQueued_;
+
+			[[nodiscard]] std::shared_ptr<File> get(int handle) const;
+			[[nodiscard]] std::vector<std::shared_ptr<File>> getPending();
+			bool takeNext(const std::shared_ptr<File>& file);
+
+			void push(const std::shared_ptr<File>& file, Operation&& operation);
+
+			// Carries out the file's operations, after those of files at the same path that were queued earlier
+			void waitFile(const std::shared_ptr<File>& file);
+			void run(const std::shared_ptr<File>& file);
+
+			static void Execute(File& file, Operation& operation);
+		};
+
 		static const char* ForbiddenStrings[];
 
-		static FILE* openScriptIOFileHandle;
+		static FileTable Files;
+		static int LastHandle;
 
 		static std::filesystem::path DefaultDestPath;
 
 		static bool ValidatePath(const char* function, const char* path);
 		static std::filesystem::path BuildPath(const char* path);
+		static int GetHandle();
 
 		static void GScr_OpenFile();
 		static void GScr_ReadStream();
+		static void GScr_WriteStream();
+		static void GScr_FlushFile();
 		static void GScr_CloseFile();
 
 		static void AddScriptFunctions();
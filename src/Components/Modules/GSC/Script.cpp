@@ -6,6 +6,9 @@ namespace Components::GSC
 	std::vector<Script::ScriptFunction> Script::CustomScrFunctions;
 	std::vector<Script::ScriptMethod> Script::CustomScrMethods;
 
+	Script::NameIndex Script::CustomScrFunctionIndex;
+	Script::NameIndex Script::CustomScrMethodIndex;
+
 	std::unordered_map<std::string, int> Script::ScriptMainHandles;
 	std::unordered_map<std::string, int> Script::ScriptInitHandles;
 
@@ -125,6 +128,7 @@ namespace Components::GSC
 		toAdd.aliases.push_back({Utils::String::ToLower(name)});
 
 		CustomScrFunctions.emplace_back(toAdd);
+		CustomScrFunctionIndex.invalidate();
 	}
 
 	void Script::AddMethod(const std::string& name, const Game::BuiltinMethod func, const bool type)
@@ -135,6 +139,7 @@ namespace Components::GSC
 		toAdd.aliases.push_back({Utils::String::ToLower(name)});
 
 		CustomScrMethods.emplace_back(toAdd);
+		CustomScrMethodIndex.invalidate();
 	}
 
 	void Script::AddFuncMultiple(Game::BuiltinFunction func, bool type, scriptNames aliases)
@@ -147,6 +152,7 @@ namespace Components::GSC
 		toAdd.aliases = std::move(aliasesToAdd);
 
 		CustomScrFunctions.emplace_back(toAdd);
+		CustomScrFunctionIndex.invalidate();
 	}
 
 	void Script::AddMethMultiple(Game::BuiltinMethod func, bool type, scriptNames aliases)
@@ -159,20 +165,41 @@ namespace Components::GSC
 		toAdd.aliases = std::move(aliasesToAdd);
 
 		CustomScrMethods.emplace_back(toAdd);
+		CustomScrMethodIndex.invalidate();
+	}
+
+	std::uint32_t Script::NameIndex::Hash(const char* name)
+	{
+		// FNV-1a over the lower case name
+		std::uint32_t hash = 0x811C9DC5;
+		for (; *name; ++name)
+		{
+			hash ^= static_cast<std::uint8_t>(std::tolower(static_cast<unsigned char>(*name)));
+			hash *= 0x01000193;
+		}
+
+		return hash;
+	}
+
+	bool Script::NameIndex::Equals(const std::string& alias, const char* name)
+	{
+		for (const auto c : alias)
+		{
+			if (!*name || c != static_cast<char>(std::tolower(static_cast<unsigned char>(*name)))) return false;
+			++name;
+		}
+
+		return !*name;
 	}
 
 	Game::BuiltinFunction Script::BuiltIn_GetFunctionStub(const char** pName, int* type)
 	{
 		if (pName != nullptr)
 		{
-			const auto name = Utils::String::ToLower(*pName);
-			for (const auto& funcs : CustomScrFunctions)
+			if (const auto* func = CustomScrFunctionIndex.find(CustomScrFunctions, *pName))
 			{
-				if (std::ranges::find(funcs.aliases, name) != funcs.aliases.end())
-				{
-					*type = funcs.type;
-					return funcs.actionFunc;
-				}
+				*type = func->type;
+				return func->actionFunc;
 			}
 		}
 		else
@@ -192,14 +219,10 @@ namespace Components::GSC
 	{
 		if (pName != nullptr)
 		{
-			const auto name = Utils::String::ToLower(*pName);
-			for (const auto& meths : CustomScrMethods)
+			if (const auto* meth = CustomScrMethodIndex.find(CustomScrMethods, *pName))
 			{
-				if (std::ranges::find(meths.aliases, name) != meths.aliases.end())
-				{
-					*type = meths.type;
-					return meths.actionFunc;
-				}
+				*type = meth->type;
+				return meth->actionFunc;
 			}
 		}
 		else
@@ -269,6 +292,116 @@ namespace Components::GSC
 		return ent;
 	}
 
+	bool Script::unitTest()
+	{
+		// What BuiltIn_GetFunctionStub did before the index
+		const auto linearFind = []<typename T>(const std::vector<T>& entries, const char* name) -> const T*
+		{
+			const auto lowerName = Utils::String::ToLower(name);
+			for (const auto& entry : entries)
+			{
+				if (std::ranges::find(entry.aliases, lowerName) != entry.aliases.end())
+				{
+					return &entry;
+				}
+			}
+
+			return nullptr;
+		};
+
+		std::mt19937 random(1337);
+		const auto randomCase = [&random](std::string name)
+		{
+			for (auto& c : name)
+			{
+				if (random() % 2) c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+			}
+
+			return name;
+		};
+
+		// A registry of the size mods end up with, names shadowed by a later registration have to resolve to the first one
+		std::vector<ScriptFunction> functions;
+		for (auto i = 0; i < 600; ++i)
+		{
+			ScriptFunction function{};
+			function.type = (i % 3) == 0;
+			function.aliases.push_back(std::format("modfunction{}", i));
+
+			if (i % 4 == 0) function.aliases.push_back(std::format("modfunction{}_alias", i));
+			if (i % 50 == 49) function.aliases.push_back(std::format("modfunction{}", i - 10));
+
+			functions.push_back(std::move(function));
+		}
+
+		for (const auto& function : CustomScrFunctions)
+		{
+			functions.push_back(function);
+		}
+
+		std::vector<std::string> names;
+		for (const auto& function : functions)
+		{
+			for (const auto& alias : function.aliases)
+			{
+				names.push_back(randomCase(alias));
+				names.push_back(randomCase(alias + "x"));
+				names.push_back(alias.substr(0, alias.size() - 1));
+			}
+		}
+
+		names.push_back({});
+		std::ranges::shuffle(names, random);
+
+		NameIndex index;
+		for (const auto& name : names)
+		{
+			if (index.find(functions, name.data()) != linearFind(functions, name.data()))
+			{
+				Logger::PrintError(Game::CON_CHANNEL_ERROR, "Builtin index resolved '{}' differently than the linear scan\n", name);
+				return false;
+			}
+		}
+
+		// Adding a function after the index was built has to be picked up
+		functions.push_back({ nullptr, false, { "latefunction" } });
+		index.invalidate();
+
+		if (index.find(functions, "LateFunction") != &functions.back())
+		{
+			Logger::PrintError(Game::CON_CHANNEL_ERROR, "Builtin index missed a late registration\n");
+			return false;
+		}
+
+		// Resolves every name ten times and returns how many were found
+		const auto resolveAll = [&](const std::function<const ScriptFunction*(const char*)>& find)
+		{
+			std::size_t found = 0;
+			for (auto round = 0; round < 10; ++round)
+			{
+				for (const auto& name : names)
+				{
+					if (find(name.data())) ++found;
+				}
+			}
+
+			return found;
+		};
+
+		std::size_t linearFound = 0, indexedFound = 0;
+		const auto linear = Utils::Time::Measure([&] { linearFound = resolveAll([&](const char* name) { return linearFind(functions, name); }); });
+		const auto indexed = Utils::Time::Measure([&] { indexedFound = resolveAll([&](const char* name) { return index.find(functions, name); }); });
+
+		if (linearFound != indexedFound)
+		{
+			Logger::PrintError(Game::CON_CHANNEL_ERROR, "Builtin index found {} names, the linear scan {}\n", indexedFound, linearFound);
+			return false;
+		}
+
+		Logger::Print("Resolving {} builtin names against {} functions: {}us linear, {}us indexed\n", names.size() * 10, functions.size(), linear.count(), indexed.count());
+		return true;
+	}
+
 	Script::Script()
 	{
 		// Skip check in GScr_CheckAllowedToSetPersistentData to prevent log spam in RuntimeError.
@@ -7,6 +7,8 @@ namespace Components::GSC
 	public:
 		Script();
 
+		bool unitTest() override;
+
 		using scriptNames = std::vector<std::string>;
 		static void AddFunction(const std::string& name, Game::BuiltinFunction func, bool type = false);
 		static void AddMethod(const std::string& name, Game::BuiltinMethod func, bool type = false);
@@ -33,9 +35,99 @@ namespace Components::GSC
 			scriptNames aliases;
 		};
 
+		// Case insensitive open addressing index over every alias, rebuilt on the first lookup after something was registered
+		class NameIndex
+		{
+		public:
+			void invalidate()
+			{
+				this->built_ = false;
+			}
+
+			template <typename T>
+			const T* find(const std::vector<T>& entries, const char* name)
+			{
+				if (!this->built_)
+				{
+					this->build(entries);
+				}
+
+				const auto hash = Hash(name);
+				for (auto i = hash & this->mask_;; i = (i + 1) & this->mask_)
+				{
+					const auto& slot = this->slots_[i];
+					if (slot.entry == EmptySlot) return nullptr;
+
+					if (slot.hash == hash && Equals(entries[slot.entry].aliases[slot.alias], name))
+					{
+						return &entries[slot.entry];
+					}
+				}
+			}
+
+			static std::uint32_t Hash(const char* name);
+
+		private:
+			static constexpr std::uint32_t EmptySlot = 0xFFFFFFFF;
+
+			struct Slot
+			{
+				std::uint32_t hash;
+				std::uint32_t entry;
+				std::uint32_t alias;
+			};
+
+			std::vector<Slot> slots_;
+			std::uint32_t mask_{};
+			bool built_{};
+
+			// Aliases are stored lower case already
+			static bool Equals(const std::string& alias, const char* name);
+
+			template <typename T>
+			void build(const std::vector<T>& entries)
+			{
+				std::size_t count = 0;
+				for (const auto& entry : entries)
+				{
+					count += entry.aliases.size();
+				}
+
+				// At most half full, so probe chains stay short
+				this->slots_.assign(std::max<std::size_t>(std::bit_ceil(count * 2), 16), { 0, EmptySlot, 0 });
+				this->mask_ = static_cast<std::uint32_t>(this->slots_.size() - 1);
+
+				for (std::uint32_t i = 0; i < entries.size(); ++i)
+				{
+					for (std::uint32_t j = 0; j < entries[i].aliases.size(); ++j)
+					{
+						const auto& alias = entries[i].aliases[j];
+						const auto hash = Hash(alias.data());
+
+						// The first registration of a name wins, like the linear scan did
+						auto k = hash & this->mask_;
+						while (this->slots_[k].entry != EmptySlot && !(this->slots_[k].hash == hash && entries[this->slots_[k].entry].aliases[this->slots_[k].alias] == alias))
+						{
+							k = (k + 1) & this->mask_;
+						}
+
+						if (this->slots_[k].entry == EmptySlot)
+						{
+							this->slots_[k] = { hash, i, j };
+						}
+					}
+				}
+
+				this->built_ = true;
+			}
+		};
+
 		static std::vector<ScriptFunction> CustomScrFunctions;
 		static std::vector<ScriptMethod> CustomScrMethods;
 
+		static NameIndex CustomScrFunctionIndex;
+		static NameIndex CustomScrMethodIndex;
+
 		static std::unordered_map<std::string, int> ScriptMainHandles;
 		static std::unordered_map<std::string, int> ScriptInitHandles;
 
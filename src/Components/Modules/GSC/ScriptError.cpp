@@ -14,6 +14,15 @@ namespace Components::GSC
 	Game::scrParserGlob_t ScriptError::ScrParserGlob;
 	Game::scrParserPub_t ScriptError::ScrParserPub;
 
+	std::unordered_map<const char*, std::vector<unsigned int>> ScriptError::LineStarts;
+
+	std::vector<ScriptError::CodePosRange> ScriptError::CodePosIndex;
+	unsigned int ScriptError::CodePosIndexLen;
+
+	std::atomic<bool> ScriptError::Profiling;
+	std::atomic<unsigned int> ScriptError::ProfileSession;
+	Utils::Concurrency::Container<std::unordered_map<const char*, unsigned int>> ScriptError::ProfileSamples;
+
 	int ScriptError::Scr_IsInOpcodeMemory(const char* pos)
 	{
 		assert(Game::scrVarPub->programBuffer);
@@ -253,10 +262,79 @@ namespace Components::GSC
 		line[len] = '\0';
 	}
 
+	std::vector<unsigned int> ScriptError::BuildLineStarts(const char* buf, std::size_t len)
+	{
+		std::vector<unsigned int> lineStarts{ 0 };
+
+		// Lines are terminated by the null bytes the EOL fixup left behind
+		const auto* end = buf + len;
+		for (const auto* pos = buf; (pos = static_cast<const char*>(std::memchr(pos, '\0', end - pos))) != nullptr;)
+		{
+			++pos;
+			lineStarts.emplace_back(static_cast<unsigned int>(pos - buf));
+		}
+
+		return lineStarts;
+	}
+
+	int ScriptError::FindLine(const std::vector<unsigned int>& lineStarts, unsigned int sourcePos, unsigned int* lineStart)
+	{
+		assert(!lineStarts.empty() && !lineStarts.front());
+
+		const auto next = std::upper_bound(lineStarts.begin(), lineStarts.end(), sourcePos);
+		*lineStart = *(next - 1);
+		return static_cast<int>(next - lineStarts.begin() - 1);
+	}
+
+	void ScriptError::BuildCodePosIndex(const Game::SourceBufferInfo* lookup, unsigned int len, std::vector<CodePosRange>& index)
+	{
+		index.clear();
+
+		// Buffer 0 is what the lookup falls back to, it never has to be matched
+		for (unsigned int i = 1; i < len; ++i)
+		{
+			if (lookup[i].codePos)
+			{
+				index.push_back({ lookup[i].codePos, i });
+			}
+		}
+
+		std::stable_sort(index.begin(), index.end(), [](const CodePosRange& a, const CodePosRange& b)
+		{
+			return a.codePos < b.codePos;
+		});
+
+		// Includes are loaded while their parent compiles, so buffers are not ordered by code position
+		for (std::size_t i = 1; i < index.size(); ++i)
+		{
+			index[i].bufferIndex = std::max(index[i].bufferIndex, index[i - 1].bufferIndex);
+		}
+	}
+
+	unsigned int ScriptError::FindSourceBuffer(const std::vector<CodePosRange>& index, const char* codePos)
+	{
+		const auto next = std::upper_bound(index.begin(), index.end(), codePos, [](const char* pos, const CodePosRange& range)
+		{
+			return pos < range.codePos;
+		});
+
+		return next == index.begin() ? 0 : (next - 1)->bufferIndex;
+	}
+
 	int ScriptError::Scr_GetLineNumInternal(const char* buf, unsigned int sourcePos, const char** startLine, int* col, [[maybe_unused]] Game::SourceBufferInfo* binfo)
 	{
 		assert(buf);
 
+		if (const auto lineStarts = LineStarts.find(buf); lineStarts != LineStarts.end())
+		{
+			unsigned int lineStart;
+			const auto lineNum = FindLine(lineStarts->second, sourcePos, &lineStart);
+
+			*startLine = buf + lineStart;
+			*col = static_cast<int>(sourcePos - lineStart);
+			return lineNum;
+		}
+
 		*startLine = buf;
 		unsigned int lineNum = 0;
 		while (sourcePos)
@@ -276,27 +354,16 @@ namespace Components::GSC
 
 	unsigned int ScriptError::Scr_GetSourceBuffer(const char* codePos)
 	{
-		unsigned int bufferIndex;
-
 		assert(Scr_IsInOpcodeMemory(codePos));
 		assert(ScrParserPub.sourceBufferLookupLen > 0);
 
-		for (bufferIndex = ScrParserPub.sourceBufferLookupLen - 1; bufferIndex; --bufferIndex)
+		if (CodePosIndexLen != ScrParserPub.sourceBufferLookupLen)
 		{
-			if (!ScrParserPub.sourceBufferLookup[bufferIndex].codePos)
-			{
-				continue;
-			}
-
-			if (ScrParserPub.sourceBufferLookup[bufferIndex].codePos > codePos)
-			{
-				continue;
-			}
-
-			break;
+			BuildCodePosIndex(ScrParserPub.sourceBufferLookup, ScrParserPub.sourceBufferLookupLen, CodePosIndex);
+			CodePosIndexLen = ScrParserPub.sourceBufferLookupLen;
 		}
 
-		return bufferIndex;
+		return FindSourceBuffer(CodePosIndex, codePos);
 	}
 
 	void ScriptError::Scr_PrintPrevCodePos(int channel, const char* codePos, unsigned int index)
@@ -524,6 +591,86 @@ namespace Components::GSC
 		}
 	}
 
+	void ScriptError::SampleProfile()
+	{
+		// The VM runs on the main thread, a torn read only costs us a sample
+		const auto* vmPub = Game::scrVmPub;
+		if (!vmPub->function_count)
+		{
+			return;
+		}
+
+		const auto* codePos = vmPub->function_frame->fs.pos;
+		if (!codePos || codePos == Game::g_EndPos)
+		{
+			return;
+		}
+
+		ProfileSamples.access([codePos](std::unordered_map<const char*, unsigned int>& samples)
+		{
+			++samples[codePos];
+		});
+	}
+
+	void ScriptError::PrintProfile(std::size_t count)
+	{
+		if (!Developer_ || !ScrParserPub.sourceBufferLookup || !Game::scrVarPub->programBuffer || !ScrParserGlob.opcodeLookupLen)
+		{
+			Logger::Print("Script profiling requires developer mode and loaded scripts\n");
+			return;
+		}
+
+		const auto samples = ProfileSamples.access<std::unordered_map<const char*, unsigned int>>([](const std::unordered_map<const char*, unsigned int>& collected)
+		{
+			return collected;
+		});
+
+		std::unordered_map<std::uint64_t, ProfileLine> lines;
+		unsigned int total = 0;
+
+		for (const auto& [codePos, hits] : samples)
+		{
+			total += hits;
+
+			if (codePos <= ScrParserGlob.opcodeLookup[0].codePos || !Scr_IsInOpcodeMemory(codePos))
+			{
+				continue;
+			}
+
+			const auto bufferIndex = Scr_GetSourceBuffer(codePos - 1);
+			if (!ScrParserPub.sourceBufferLookup[bufferIndex].sourceBuf)
+			{
+				continue;
+			}
+
+			const auto lineNum = Scr_GetLineNum(bufferIndex, Scr_GetPrevSourcePos(codePos - 1, 0));
+			auto& line = lines[(static_cast<std::uint64_t>(bufferIndex) << 32) | static_cast<unsigned int>(lineNum)];
+			line.bufferIndex = bufferIndex;
+			line.lineNum = lineNum;
+			line.samples += hits;
+		}
+
+		std::vector<ProfileLine> sorted;
+		sorted.reserve(lines.size());
+		for (const auto& line : lines | std::views::values)
+		{
+			sorted.push_back(line);
+		}
+
+		count = std::min(count, sorted.size());
+		std::partial_sort(sorted.begin(), sorted.begin() + static_cast<std::ptrdiff_t>(count), sorted.end(), [](const ProfileLine& a, const ProfileLine& b)
+		{
+			return a.samples > b.samples;
+		});
+
+		Logger::Print("Script profile, {} samples:\n", total);
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			const auto& line = sorted[i];
+			Logger::Print("{:6.2f}% {:8} {}:{}\n", 100.0 * line.samples / total, line.samples, ScrParserPub.sourceBufferLookup[line.bufferIndex].buf, line.lineNum + 1);
+		}
+	}
+
 	void ScriptError::Scr_InitOpcodeLookup()
 	{
 		assert(!ScrParserGlob.opcodeLookup);
@@ -553,6 +700,16 @@ namespace Components::GSC
 
 	void ScriptError::Scr_ShutdownOpcodeLookup()
 	{
+		LineStarts.clear();
+		CodePosIndex.clear();
+		CodePosIndexLen = 0;
+
+		// Sampled positions point into the program buffer that is about to go away
+		ProfileSamples.access([](std::unordered_map<const char*, unsigned int>& samples)
+		{
+			samples.clear();
+		});
+
 		if (ScrParserGlob.opcodeLookup)
 		{
 			Z_VirtualFree(ScrParserGlob.opcodeLookup);
@@ -689,6 +846,7 @@ namespace Components::GSC
 
 		if (sourceBuf2)
 		{
+			LineStarts[sourceBuf2] = BuildLineStarts(sourceBuf2, static_cast<std::size_t>(len) + 1);
 			ScrParserPub.sourceBuf = sourceBuf2;
 		}
 	}
@@ -869,6 +1027,175 @@ namespace Components::GSC
 		Game::Engine::Hunk_ShutdownDebugMemory();
 	}
 
+	bool ScriptError::unitTest()
+	{
+		std::mt19937 random(1337);
+
+		// What Scr_GetLineNumInternal did before the index
+		const auto walkLine = [](const char* buf, unsigned int sourcePos, unsigned int* lineStart)
+		{
+			const auto* pos = buf;
+			const auto* startLine = buf;
+			auto lineNum = 0;
+
+			while (sourcePos)
+			{
+				if (!*pos)
+				{
+					startLine = pos + 1;
+					++lineNum;
+				}
+				++pos;
+				--sourcePos;
+			}
+
+			*lineStart = static_cast<unsigned int>(startLine - buf);
+			return lineNum;
+		};
+
+		// What Scr_GetSourceBuffer did before the index
+		const auto walkSourceBuffer = [](const std::vector<Game::SourceBufferInfo>& lookup, const char* codePos)
+		{
+			unsigned int bufferIndex;
+			for (bufferIndex = static_cast<unsigned int>(lookup.size()) - 1; bufferIndex; --bufferIndex)
+			{
+				if (lookup[bufferIndex].codePos && lookup[bufferIndex].codePos <= codePos)
+				{
+					break;
+				}
+			}
+
+			return bufferIndex;
+		};
+
+		// Script buffers the way the EOL fixup leaves them, every line ends in a null byte
+		std::vector<std::string> buffers;
+		std::vector<std::vector<unsigned int>> lineStarts;
+		std::size_t totalSize = 0;
+
+		for (auto i = 0; i < 6; ++i)
+		{
+			std::string buffer;
+			const auto size = (1 + i % 3) * 1024 * 1024 + random() % 4096;
+			while (buffer.size() < size)
+			{
+				const auto lineLength = random() % 10 ? random() % 120 : 0;
+				for (std::size_t j = 0; j < lineLength; ++j)
+				{
+					buffer.push_back(static_cast<char>(' ' + random() % 95));
+				}
+
+				buffer.push_back('\0');
+			}
+
+			lineStarts.push_back(BuildLineStarts(buffer.data(), buffer.size() + 1));
+			totalSize += buffer.size();
+			buffers.push_back(std::move(buffer));
+		}
+
+		for (std::size_t i = 0; i < buffers.size(); ++i)
+		{
+			const auto& buffer = buffers[i];
+
+			unsigned int expectedStart = 0;
+			auto expectedLine = 0;
+
+			for (unsigned int pos = 0; pos <= buffer.size(); ++pos)
+			{
+				if (pos && !buffer[pos - 1])
+				{
+					expectedStart = pos;
+					++expectedLine;
+				}
+
+				unsigned int lineStart;
+				if (FindLine(lineStarts[i], pos, &lineStart) != expectedLine || lineStart != expectedStart)
+				{
+					Logger::PrintError(Game::CON_CHANNEL_ERROR, "Line index resolved position {} of buffer {} to the wrong line\n", pos, i);
+					return false;
+				}
+			}
+		}
+
+		// Includes get loaded while their parent compiles and some buffers have no code at all
+		std::vector<char> program(4 * 1024 * 1024);
+		std::vector<Game::SourceBufferInfo> lookup(500);
+		std::size_t offset = 0;
+
+		for (auto& info : lookup)
+		{
+			offset += random() % 8192;
+
+			const auto kind = random() % 10;
+			if (kind == 0) continue;
+
+			info.codePos = program.data() + (kind == 1 ? random() % program.size() : offset % program.size());
+		}
+
+		std::vector<CodePosRange> codePosIndex;
+		BuildCodePosIndex(lookup.data(), static_cast<unsigned int>(lookup.size()), codePosIndex);
+
+		for (auto i = 0; i < 200000; ++i)
+		{
+			const auto* codePos = program.data() + random() % program.size();
+			if (FindSourceBuffer(codePosIndex, codePos) != walkSourceBuffer(lookup, codePos))
+			{
+				Logger::PrintError(Game::CON_CHANNEL_ERROR, "Code position index resolved offset {} to the wrong source buffer\n", codePos - program.data());
+				return false;
+			}
+		}
+
+		std::vector<std::pair<const char*, unsigned int>> positions(1000000);
+		for (auto& [codePos, sourcePos] : positions)
+		{
+			codePos = program.data() + random() % program.size();
+			sourcePos = static_cast<unsigned int>(random() % (1024 * 1024));
+		}
+
+		// Resolves the first count positions and sums up the results, so the two ways can be compared
+		const auto resolveAll = [&](std::size_t count, const std::function<int(const char*, unsigned int, unsigned int*)>& resolve)
+		{
+			std::uint64_t checksum = 0;
+			for (std::size_t i = 0; i < count; ++i)
+			{
+				unsigned int lineStart;
+				checksum += resolve(positions[i].first, positions[i].second, &lineStart);
+				checksum += lineStart;
+			}
+
+			return checksum;
+		};
+
+		const auto walked = [&](const char* codePos, unsigned int sourcePos, unsigned int* lineStart)
+		{
+			const auto bufferIndex = walkSourceBuffer(lookup, codePos) % buffers.size();
+			return walkLine(buffers[bufferIndex].data(), sourcePos, lineStart);
+		};
+
+		const auto indexed = [&](const char* codePos, unsigned int sourcePos, unsigned int* lineStart)
+		{
+			const auto bufferIndex = FindSourceBuffer(codePosIndex, codePos) % buffers.size();
+			return FindLine(lineStarts[bufferIndex], sourcePos, lineStart);
+		};
+
+		// The walk takes too long to do a million of, it's measured on a sample and scaled up
+		constexpr std::size_t walkCount = 2000;
+		std::uint64_t walkChecksum = 0;
+
+		const auto walkSample = Utils::Time::Measure([&] { walkChecksum = resolveAll(walkCount, walked); });
+		const auto indexedFull = Utils::Time::Measure([&] { resolveAll(positions.size(), indexed); });
+
+		if (walkChecksum != resolveAll(walkCount, indexed))
+		{
+			Logger::PrintError(Game::CON_CHANNEL_ERROR, "Indexed position lookup disagrees with the linear walk\n");
+			return false;
+		}
+
+		Logger::Print("Resolving {} positions over {} MB of script: {}ms indexed, ~{}ms with the linear walk\n",
+			positions.size(), totalSize / (1024 * 1024), indexedFull.count() / 1000, walkSample.count() * (positions.size() / walkCount) / 1000);
+		return true;
+	}
+
 	ScriptError::ScriptError()
 	{
 #ifdef SCRIPT_ERROR_PATCH
@@ -1118,6 +1445,50 @@ namespace Components::GSC
 		}
 
 		Utils::Hook(0x434260, CompileError, HOOK_JUMP).install()->quick();
+
+		// Sampling profiler, samples are resolved to source lines when they are printed.
+		// The sampler only runs while profiling, so the timer thread can sleep otherwise
+		Command::Add("gscProfileStart", []
+		{
+			if (Profiling)
+			{
+				Logger::Print("Script profiling is already running\n");
+				return;
+			}
+
+			ProfileSamples.access([](std::unordered_map<const char*, unsigned int>& samples)
+			{
+				samples.clear();
+			});
+
+			Profiling = true;
+			const auto session = ++ProfileSession;
+
+			Scheduler::Schedule([session]
+			{
+				// A sampler from an earlier session that hadn't noticed the stop yet ends as well
+				if (!Profiling || ProfileSession != session)
+				{
+					return true;
+				}
+
+				SampleProfile();
+				return false;
+			}, Scheduler::Pipeline::ASYNC, 1ms);
+
+			Logger::Print("Script profiling started\n");
+		});
+
+		Command::Add("gscProfileStop", []
+		{
+			Profiling = false;
+			Logger::Print("Script profiling stopped\n");
+		});
+
+		Command::Add("gscProfileDump", [](const Command::Params* params)
+		{
+			PrintProfile(params->size() < 2 ? 20 : std::strtoul(params->get(1), nullptr, 10));
+		});
 #endif
 	}
 }
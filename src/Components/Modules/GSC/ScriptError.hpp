@@ -7,18 +7,53 @@ namespace Components::GSC
 	public:
 		ScriptError();
 
+		bool unitTest() override;
+
 		static int Scr_IsInOpcodeMemory(const char* pos);
 		static int Scr_GetLineNum(unsigned int bufferIndex, unsigned int sourcePos);
 
 		static void RuntimeError(const char* codePos, unsigned int index, const char* msg, const char* dialogMessage);
 
 	private:
+		// Sorted by codePos, bufferIndex is the highest source buffer index starting at or before codePos
+		struct CodePosRange
+		{
+			const char* codePos;
+			unsigned int bufferIndex;
+		};
+
+		struct ProfileLine
+		{
+			unsigned int bufferIndex;
+			int lineNum;
+			unsigned int samples;
+		};
+
 		// Replacement for variables not present in currently available structs
 		static int Developer_;
 
 		static Game::scrParserGlob_t ScrParserGlob;
 		static Game::scrParserPub_t ScrParserPub;
 
+		// Offsets of every line in a source buffer, keyed by the buffer
+		static std::unordered_map<const char*, std::vector<unsigned int>> LineStarts;
+
+		static std::vector<CodePosRange> CodePosIndex;
+		static unsigned int CodePosIndexLen;
+
+		static std::atomic<bool> Profiling;
+		static std::atomic<unsigned int> ProfileSession;
+		static Utils::Concurrency::Container<std::unordered_map<const char*, unsigned int>> ProfileSamples;
+
+		static std::vector<unsigned int> BuildLineStarts(const char* buf, std::size_t len);
+		static int FindLine(const std::vector<unsigned int>& lineStarts, unsigned int sourcePos, unsigned int* lineStart);
+
+		static void BuildCodePosIndex(const Game::SourceBufferInfo* lookup, unsigned int len, std::vector<CodePosRange>& index);
+		static unsigned int FindSourceBuffer(const std::vector<CodePosRange>& index, const char* codePos);
+
+		static void SampleProfile();
+		static void PrintProfile(std::size_t count);
+
 		static void AddOpcodePos(unsigned int sourcePos, int type);
 		static void RemoveOpcodePos();
 		static void AddThreadStartOpcodePos(unsigned int sourcePos);
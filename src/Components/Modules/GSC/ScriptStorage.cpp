@@ -1,11 +1,438 @@
 #include <STDInclude.hpp>
+#include <zlib.h>
 
 #include "ScriptStorage.hpp"
 #include "Script.hpp"
 
 namespace Components::GSC
 {
-	std::unordered_map<std::string, std::string> ScriptStorage::Data;
+	ScriptStorage::StorageMap ScriptStorage::Data;
+	ScriptStorage::ChangeLog ScriptStorage::Log;
+	bool ScriptStorage::Loaded;
+	std::atomic<bool> ScriptStorage::CompactionQueued;
+
+	std::mutex ScriptStorage::ChangeLog::CompactMutex;
+
+	ScriptStorage::ChangeLog::~ChangeLog()
+	{
+		this->close();
+	}
+
+	bool ScriptStorage::ChangeLog::open(const std::filesystem::path& folder, StorageMap& data)
+	{
+		this->close();
+		this->folder_ = folder;
+
+		std::error_code ec;
+		std::filesystem::create_directories(folder, ec);
+
+		data.clear();
+
+		bool exists;
+		const auto snapshotGeneration = LoadSnapshot(folder, data, &exists);
+
+		this->generation_ = snapshotGeneration;
+		this->logSize_ = 0;
+
+		std::size_t fileSize = 0;
+		for (const auto generation : FindLogs(folder))
+		{
+			exists = true;
+
+			// Left behind by a compaction that stopped before it could remove them
+			if (generation < snapshotGeneration)
+			{
+				std::filesystem::remove(LogPath(folder, generation), ec);
+				continue;
+			}
+
+			const auto buffer = Utils::IO::ReadFile(LogPath(folder, generation).string());
+
+			std::uint32_t header;
+			const auto valid = ReadHeader(buffer, LogMagic, &header) && header == generation;
+
+			this->generation_ = generation;
+			this->logSize_ = valid ? Replay(buffer, HeaderSize, data) : 0;
+			fileSize = buffer.size();
+		}
+
+		if (this->logSize_ < HeaderSize)
+		{
+			this->createLog();
+			return exists;
+		}
+
+		const auto path = LogPath(folder, this->generation_);
+		if (this->logSize_ < fileSize)
+		{
+			Logger::Warning(Game::CON_CHANNEL_SCRIPT, "Script storage: dropping {} bytes of an interrupted write\n", fileSize - this->logSize_);
+			std::filesystem::resize_file(path, this->logSize_, ec);
+		}
+
+		fopen_s(&this->log_, path.string().data(), "ab");
+		return exists;
+	}
+
+	void ScriptStorage::ChangeLog::close()
+	{
+		if (this->log_)
+		{
+			std::fclose(this->log_);
+			this->log_ = nullptr;
+		}
+	}
+
+	void ScriptStorage::ChangeLog::set(const std::string_view& key, const std::string_view& value)
+	{
+		this->append(RecordType::Set, key, value);
+	}
+
+	void ScriptStorage::ChangeLog::remove(const std::string_view& key)
+	{
+		this->append(RecordType::Remove, key, {});
+	}
+
+	void ScriptStorage::ChangeLog::clear()
+	{
+		this->append(RecordType::Clear, {}, {});
+	}
+
+	bool ScriptStorage::ChangeLog::shouldCompact() const
+	{
+		return this->logSize_ >= CompactSize;
+	}
+
+	std::uint32_t ScriptStorage::ChangeLog::rotate()
+	{
+		this->close();
+		++this->generation_;
+		this->createLog();
+
+		return this->generation_;
+	}
+
+	bool ScriptStorage::ChangeLog::Compact(const std::filesystem::path& folder, const std::uint32_t generation, StorageMap* result)
+	{
+		std::lock_guard _(CompactMutex);
+
+		StorageMap data;
+		const auto snapshotGeneration = LoadSnapshot(folder, data);
+		const auto logs = FindLogs(folder);
+
+		for (const auto log : logs)
+		{
+			if (log < snapshotGeneration || log >= generation) continue;
+
+			const auto buffer = Utils::IO::ReadFile(LogPath(folder, log).string());
+
+			std::uint32_t header;
+			if (ReadHeader(buffer, LogMagic, &header) && header == log)
+			{
+				Replay(buffer, HeaderSize, data);
+			}
+		}
+
+		// A later compaction may have gotten here first
+		if (snapshotGeneration < generation)
+		{
+			std::string snapshot;
+			WriteHeader(snapshot, SnapshotMagic, generation);
+
+			for (const auto& [key, value] : data)
+			{
+				WriteRecord(snapshot, RecordType::Set, key, value);
+			}
+
+			// Replace the snapshot in one step, a crash leaves either the old one and its logs or the new one.
+			// Both the data and the rename have to be on the disk before the logs go, they are the only other copy
+			const auto path = SnapshotPath(folder);
+			auto temp = path;
+			temp += ".tmp";
+
+			if (!WriteDurably(temp, snapshot))
+			{
+				return false;
+			}
+
+			if (!MoveFileExA(temp.string().data(), path.string().data(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+			{
+				return false;
+			}
+
+			std::error_code ec;
+			for (const auto log : logs)
+			{
+				if (log < generation)
+				{
+					std::filesystem::remove(LogPath(folder, log), ec);
+				}
+			}
+		}
+
+		if (result)
+		{
+			*result = std::move(data);
+		}
+
+		return true;
+	}
+
+	void ScriptStorage::ChangeLog::append(const RecordType type, const std::string_view& key, const std::string_view& value)
+	{
+		if (!this->log_)
+		{
+			return;
+		}
+
+		this->record_.clear();
+		WriteRecord(this->record_, type, key, value);
+
+		// Flushed right away, a record is either complete on disk or cut off when replayed
+		std::fwrite(this->record_.data(), 1, this->record_.size(), this->log_);
+		std::fflush(this->log_);
+
+		this->logSize_ += this->record_.size();
+	}
+
+	bool ScriptStorage::ChangeLog::createLog()
+	{
+		std::string header;
+		WriteHeader(header, LogMagic, this->generation_);
+
+		const auto path = LogPath(this->folder_, this->generation_);
+		if (fopen_s(&this->log_, path.string().data(), "wb") || !this->log_)
+		{
+			this->log_ = nullptr;
+			Logger::PrintError(Game::CON_CHANNEL_ERROR, "Script storage: failed to create '{}'\n", path.string());
+			return false;
+		}
+
+		std::fwrite(header.data(), 1, header.size(), this->log_);
+		std::fflush(this->log_);
+
+		this->logSize_ = header.size();
+		return true;
+	}
+
+	bool ScriptStorage::ChangeLog::WriteDurably(const std::filesystem::path& path, const std::string& data)
+	{
+		HANDLE file = CreateFileA(path.string().data(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+
+		DWORD written = 0;
+		const auto result = ::WriteFile(file, data.data(), static_cast<DWORD>(data.size()), &written, nullptr) && written == data.size() && FlushFileBuffers(file);
+
+		CloseHandle(file);
+		return result;
+	}
+
+	std::filesystem::path ScriptStorage::ChangeLog::SnapshotPath(const std::filesystem::path& folder)
+	{
+		return folder / "scriptstorage.snapshot";
+	}
+
+	std::filesystem::path ScriptStorage::ChangeLog::LogPath(const std::filesystem::path& folder, const std::uint32_t generation)
+	{
+		return folder / std::format("scriptstorage.{}.log", generation);
+	}
+
+	std::vector<std::uint32_t> ScriptStorage::ChangeLog::FindLogs(const std::filesystem::path& folder)
+	{
+		std::vector<std::uint32_t> logs;
+
+		std::error_code ec;
+		for (const auto& entry : std::filesystem::directory_iterator(folder, ec))
+		{
+			const auto name = entry.path().filename().string();
+			if (!name.starts_with("scriptstorage.") || !name.ends_with(".log")) continue;
+
+			const auto number = name.substr(14, name.size() - 18);
+			if (number.empty() || !std::ranges::all_of(number, [](const char c) { return std::isdigit(static_cast<unsigned char>(c)) != 0; })) continue;
+
+			logs.emplace_back(static_cast<std::uint32_t>(std::strtoul(number.data(), nullptr, 10)));
+		}
+
+		std::ranges::sort(logs);
+		return logs;
+	}
+
+	void ScriptStorage::ChangeLog::WriteHeader(std::string& out, const std::uint32_t magic, const std::uint32_t generation)
+	{
+		out.append(reinterpret_cast<const char*>(&magic), sizeof(magic));
+		out.append(reinterpret_cast<const char*>(&generation), sizeof(generation));
+	}
+
+	bool ScriptStorage::ChangeLog::ReadHeader(const std::string& buffer, const std::uint32_t magic, std::uint32_t* generation)
+	{
+		if (buffer.size() < HeaderSize || std::memcmp(buffer.data(), &magic, sizeof(magic)) != 0)
+		{
+			return false;
+		}
+
+		std::memcpy(generation, buffer.data() + sizeof(magic), sizeof(*generation));
+		return true;
+	}
+
+	void ScriptStorage::ChangeLog::WriteRecord(std::string& out, const RecordType type, const std::string_view& key, const std::string_view& value)
+	{
+		// Size and CRC32 of the payload, then the type, the key length, the key and the value
+		const auto size = static_cast<std::uint32_t>(1 + sizeof(std::uint32_t) + key.size() + value.size());
+		const auto keySize = static_cast<std::uint32_t>(key.size());
+
+		const auto start = out.size();
+		out.resize(start + RecordHeaderSize + size);
+
+		auto* record = out.data() + start;
+		auto* payload = record + RecordHeaderSize;
+
+		payload[0] = static_cast<char>(type);
+		std::memcpy(payload + 1, &keySize, sizeof(keySize));
+		std::copy(key.begin(), key.end(), payload + 1 + sizeof(keySize));
+		std::copy(value.begin(), value.end(), payload + 1 + sizeof(keySize) + key.size());
+
+		const auto crc = static_cast<std::uint32_t>(crc32(0, reinterpret_cast<const Bytef*>(payload), size));
+		std::memcpy(record, &size, sizeof(size));
+		std::memcpy(record + sizeof(size), &crc, sizeof(crc));
+	}
+
+	std::size_t ScriptStorage::ChangeLog::Replay(const std::string& buffer, std::size_t pos, StorageMap& data)
+	{
+		while (buffer.size() - pos >= RecordHeaderSize)
+		{
+			std::uint32_t size, crc, keySize;
+			std::memcpy(&size, buffer.data() + pos, sizeof(size));
+			std::memcpy(&crc, buffer.data() + pos + sizeof(size), sizeof(crc));
+
+			if (size < 1 + sizeof(keySize) || size > buffer.size() - pos - RecordHeaderSize) break;
+
+			const auto* payload = buffer.data() + pos + RecordHeaderSize;
+			if (crc32(0, reinterpret_cast<const Bytef*>(payload), size) != crc) break;
+
+			std::memcpy(&keySize, payload + 1, sizeof(keySize));
+			if (keySize > size - 1 - sizeof(keySize)) break;
+
+			const std::string_view key(payload + 1 + sizeof(keySize), keySize);
+			const std::string_view value(key.data() + key.size(), size - 1 - sizeof(keySize) - keySize);
+
+			switch (static_cast<RecordType>(payload[0]))
+			{
+			case RecordType::Set:
+				data.insert_or_assign(std::string(key), std::string(value));
+				break;
+			case RecordType::Remove:
+				data.erase(std::string(key));
+				break;
+			case RecordType::Clear:
+				data.clear();
+				break;
+			default:
+				return pos;
+			}
+
+			pos += RecordHeaderSize + size;
+		}
+
+		return pos;
+	}
+
+	std::uint32_t ScriptStorage::ChangeLog::LoadSnapshot(const std::filesystem::path& folder, StorageMap& data, bool* exists)
+	{
+		const auto buffer = Utils::IO::ReadFile(SnapshotPath(folder).string());
+		if (exists)
+		{
+			*exists = !buffer.empty();
+		}
+
+		std::uint32_t generation;
+		if (!ReadHeader(buffer, SnapshotMagic, &generation))
+		{
+			if (!buffer.empty())
+			{
+				Logger::PrintError(Game::CON_CHANNEL_ERROR, "Script storage: discarding an invalid snapshot\n");
+			}
+
+			return 0;
+		}
+
+		Replay(buffer, HeaderSize, data);
+		return generation;
+	}
+
+	std::filesystem::path ScriptStorage::GetFolder()
+	{
+		char path[MAX_PATH]{};
+		Game::FS_BuildOSPath((*Game::fs_homepath)->current.string, reinterpret_cast<char*>(0x63D0BB8), "scriptdata", path);
+		return path;
+	}
+
+	void ScriptStorage::EnsureLoaded()
+	{
+		if (Loaded)
+		{
+			return;
+		}
+
+		Loaded = true;
+
+		if (Log.open(GetFolder(), Data))
+		{
+			return;
+		}
+
+		// Storage that was only ever dumped as JSON is imported once
+		FileSystem::File storageFile("scriptdata/scriptstorage.json");
+		if (!storageFile.exists())
+		{
+			return;
+		}
+
+		try
+		{
+			const nlohmann::json storageDef = nlohmann::json::parse(storageFile.getBuffer());
+			for (const auto& [key, value] : storageDef.get<StorageMap>())
+			{
+				Data.insert_or_assign(key, value);
+				Log.set(key, value);
+			}
+		}
+		catch (const std::exception& ex)
+		{
+			Logger::PrintError(Game::CON_CHANNEL_ERROR, "JSON Parse Error: {}. File {} is invalid\n", ex.what(), storageFile.getName());
+		}
+	}
+
+	void ScriptStorage::OnChange()
+	{
+		if (Log.shouldCompact() && !CompactionQueued)
+		{
+			Compact(false);
+		}
+	}
+
+	void ScriptStorage::Compact(const bool exportJson)
+	{
+		const auto generation = Log.rotate();
+		CompactionQueued = true;
+
+		Scheduler::Once([folder = Log.getFolder(), generation, exportJson]
+		{
+			StorageMap data;
+			if (!ChangeLog::Compact(folder, generation, exportJson ? &data : nullptr))
+			{
+				Logger::PrintError(Game::CON_CHANNEL_ERROR, "Script storage: failed to write a snapshot to '{}'\n", folder.string());
+			}
+			else if (exportJson)
+			{
+				const nlohmann::json json = data;
+				Utils::IO::WriteFile((folder / "scriptstorage.json").string(), json.dump());
+			}
+
+			CompactionQueued = false;
+		}, Scheduler::Pipeline::ASYNC);
+	}
 
 	void ScriptStorage::AddScriptFunctions()
 	{
@@ -20,7 +447,10 @@ namespace Components::GSC
 				return;
 			}
 
+			EnsureLoaded();
 			Data.insert_or_assign(key, value);
+			Log.set(key, value);
+			OnChange();
 		});
 
 		Script::AddFunction("StorageRemove", [] // gsc: StorageRemove(<str key>);
@@ -33,6 +463,8 @@ namespace Components::GSC
 				return;
 			}
 
+			EnsureLoaded();
+
 			if (!Data.contains(key))
 			{
 				Game::Scr_Error(Utils::String::VA("StorageRemove: Store does not have key '%s'!", key));
@@ -40,6 +472,8 @@ namespace Components::GSC
 			}
 
 			Data.erase(key);
+			Log.remove(key);
+			OnChange();
 		});
 
 		Script::AddFunction("StorageGet", [] // gsc: StorageGet(<str key>);
@@ -52,6 +486,8 @@ namespace Components::GSC
 				return;
 			}
 
+			EnsureLoaded();
+
 			if (!Data.contains(key))
 			{
 				Game::Scr_Error(Utils::String::VA("StorageGet: Store does not have key '%s'!", key));
@@ -71,51 +507,261 @@ namespace Components::GSC
 				return;
 			}
 
+			EnsureLoaded();
 			Game::Scr_AddBool(Data.contains(key));
 		});
 
 		Script::AddFunction("StorageDump", [] // gsc: StorageDump();
 		{
+			EnsureLoaded();
+
 			if (Data.empty())
 			{
 				Game::Scr_Error("StorageDump: ScriptStorage is empty!");
 				return;
 			}
 
-			const nlohmann::json json = Data;
-
-			FileSystem::FileWriter("scriptdata/scriptstorage.json").write(json.dump());
+			// Every change is on disk already, fold the logs into a snapshot and export it as JSON in the background.
+			// scriptstorage.json is only written once that is done, reading it right after this gets the previous dump
+			Compact(true);
 		});
 
 		Script::AddFunction("StorageLoad", [] // gsc: StorageLoad();
 		{
-			FileSystem::File storageFile("scriptdata/scriptstorage.json");
-			if (!storageFile.exists())
+			// The storage is loaded on first use, this only has to do it early
+			EnsureLoaded();
+		});
+
+		Script::AddFunction("StorageClear", [] // gsc: StorageClear();
+		{
+			EnsureLoaded();
+			Data.clear();
+			Log.clear();
+			OnChange();
+		});
+	}
+
+	bool ScriptStorage::unitTest()
+	{
+		const std::filesystem::path folder = "players/scriptstorage_test";
+		std::error_code ec;
+		std::filesystem::remove_all(folder, ec);
+
+		std::mt19937 random(1337);
+		const auto randomString = [&random](std::size_t min, std::size_t max)
+		{
+			std::string string(min + random() % (max - min + 1), '\0');
+			std::ranges::generate(string, [&random] { return static_cast<char>('a' + random() % 26); });
+			return string;
+		};
+
+		StorageMap expected;
+		StorageMap loaded;
+
+		const auto reopen = [&]
+		{
+			ChangeLog log;
+			log.open(folder, loaded);
+			return loaded == expected;
+		};
+
+		// Scripts mostly update stats of known players, now and then something is removed or the storage is wiped
+		const auto change = [&](ChangeLog& log)
+		{
+			const auto key = std::format("player{}_{}", random() % 200, random() % 5);
+			const auto kind = random() % 100;
+
+			if (kind < 80)
 			{
-				return;
+				const auto value = randomString(0, 80);
+				expected.insert_or_assign(key, value);
+				log.set(key, value);
 			}
-
-			const auto& buffer = storageFile.getBuffer();
-			try
+			else if (kind < 99)
 			{
-				const nlohmann::json storageDef = nlohmann::json::parse(buffer);
-				const auto& newData = storageDef.get<std::unordered_map<std::string, std::string>>();
-				Data.insert(newData.begin(), newData.end());
+				expected.erase(key);
+				log.remove(key);
 			}
-			catch (const std::exception& ex)
+			else
 			{
-				Logger::PrintError(Game::CON_CHANNEL_ERROR, "JSON Parse Error: {}. File {} is invalid\n", ex.what(), storageFile.getName());
+				expected.clear();
+				log.clear();
 			}
-		});
+		};
 
-		Script::AddFunction("StorageClear", [] // gsc: StorageClear();
+		ChangeLog log;
+		if (log.open(folder, loaded) || !loaded.empty())
 		{
-			Data.clear();
+			Logger::PrintError(Game::CON_CHANNEL_ERROR, "Script storage found data in an empty folder\n");
+			return false;
+		}
+
+		for (auto i = 0; i < 2000; ++i)
+		{
+			change(log);
+		}
+
+		// Kill the server in the middle of the last few writes, every cut has to come back as the last complete change
+		std::vector<std::pair<std::uintmax_t, StorageMap>> states;
+		states.emplace_back(std::filesystem::file_size(log.getLogPath()), expected);
+
+		for (auto i = 0; i < 3; ++i)
+		{
+			change(log);
+			states.emplace_back(std::filesystem::file_size(log.getLogPath()), expected);
+		}
+
+		log.close();
+
+		const auto logPath = log.getLogPath();
+		const auto full = Utils::IO::ReadFile(logPath.string());
+		const auto finalState = expected;
+
+		for (auto cut = states.front().first; cut <= full.size(); ++cut)
+		{
+			Utils::IO::WriteFile(logPath.string(), full.substr(0, cut));
+
+			expected = std::prev(std::ranges::find_if(states, [cut](const auto& state) { return state.first > cut; }))->second;
+			if (!reopen())
+			{
+				Logger::PrintError(Game::CON_CHANNEL_ERROR, "Script storage did not recover from a write cut off after {} bytes\n", cut);
+				return false;
+			}
+		}
+
+		// A write torn inside the last record leaves its size intact but not its contents
+		auto torn = full;
+		torn.back() ^= 0x20;
+		Utils::IO::WriteFile(logPath.string(), torn);
+
+		expected = states[states.size() - 2].second;
+		if (!reopen())
+		{
+			Logger::PrintError(Game::CON_CHANNEL_ERROR, "Script storage replayed a corrupted record\n");
+			return false;
+		}
+
+		// Garbage after the last record is dropped, and the log has to be appendable again afterwards
+		Utils::IO::WriteFile(logPath.string(), full + randomString(1, 64));
+		expected = finalState;
+
+		log.open(folder, loaded);
+		change(log);
+		log.close();
+
+		if (loaded != finalState || !reopen())
+		{
+			Logger::PrintError(Game::CON_CHANNEL_ERROR, "Script storage did not recover from garbage after the last record\n");
+			return false;
+		}
+
+		// Compact while changes keep coming in, then pretend the compaction died before it could clean up
+		log.open(folder, loaded);
+		const auto staleLog = log.getLogPath();
+		const auto staleContent = Utils::IO::ReadFile(staleLog.string());
+
+		const auto generation = log.rotate();
+		std::thread compaction([&folder, generation]
+		{
+			ChangeLog::Compact(folder, generation);
 		});
+
+		for (auto i = 0; i < 500; ++i)
+		{
+			change(log);
+		}
+
+		compaction.join();
+		log.close();
+
+		Utils::IO::WriteFile(staleLog.string(), staleContent);
+		Utils::IO::WriteFile((folder / "scriptstorage.snapshot.tmp").string(), randomString(1, 64));
+
+		if (!reopen() || Utils::IO::FileExists(staleLog.string()))
+		{
+			Logger::PrintError(Game::CON_CHANNEL_ERROR, "Script storage lost changes around a compaction\n");
+			return false;
+		}
+
+		std::filesystem::remove_all(folder, ec);
+
+		// What a change costs against the JSON dump it used to take to save one
+		for (const auto keys : { 10000u, 100000u })
+		{
+			StorageMap data;
+			for (auto i = 0u; i < keys; ++i)
+			{
+				data.emplace(std::format("player{}_kills", i), randomString(4, 40));
+			}
+
+			log.open(folder, loaded);
+			for (const auto& [key, value] : data)
+			{
+				log.set(key, value);
+			}
+
+			ChangeLog::Compact(folder, log.rotate());
+
+			constexpr auto changes = 1000;
+			std::chrono::nanoseconds appendTotal{}, appendWorst{};
+
+			for (auto i = 0; i < changes; ++i)
+			{
+				const auto key = std::format("player{}_kills", random() % keys);
+				const auto value = randomString(4, 40);
+
+				const auto duration = Utils::Time::Measure<std::chrono::nanoseconds>([&]
+				{
+					data.insert_or_assign(key, value);
+					log.set(key, value);
+				});
+
+				appendTotal += duration;
+				appendWorst = std::max(appendWorst, duration);
+			}
+
+			log.close();
+
+			constexpr auto dumps = 5;
+			std::chrono::nanoseconds dumpTotal{}, dumpWorst{};
+
+			for (auto i = 0; i < dumps; ++i)
+			{
+				const auto duration = Utils::Time::Measure<std::chrono::nanoseconds>([&]
+				{
+					const nlohmann::json json = data;
+					Utils::IO::WriteFile((folder / "scriptstorage.json").string(), json.dump());
+				});
+
+				dumpTotal += duration;
+				dumpWorst = std::max(dumpWorst, duration);
+			}
+
+			log.open(folder, loaded);
+			if (loaded != data)
+			{
+				Logger::PrintError(Game::CON_CHANNEL_ERROR, "Script storage with {} keys did not load back what was written\n", keys);
+				return false;
+			}
+
+			log.close();
+			std::filesystem::remove_all(folder, ec);
+
+			const auto us = [](std::chrono::nanoseconds duration) { return std::chrono::duration_cast<std::chrono::microseconds>(duration).count(); };
+			Logger::Print("Saving a change to a script storage of {} keys: {}us average / {}us worst appended, {}us average / {}us worst as a JSON dump\n",
+				keys, us(appendTotal / changes), us(appendWorst), us(dumpTotal / dumps), us(dumpWorst));
+		}
+
+		return true;
 	}
 
 	ScriptStorage::ScriptStorage()
 	{
 		AddScriptFunctions();
 	}
+
+	void ScriptStorage::preDestroy()
+	{
+		Log.close();
+	}
 }
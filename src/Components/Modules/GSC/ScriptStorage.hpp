@@ -7,8 +7,97 @@ namespace Components::GSC
 	public:
 		ScriptStorage();
 
+		void preDestroy() override;
+		bool unitTest() override;
+
 	private:
-		static std::unordered_map<std::string, std::string> Data;
+		using StorageMap = std::unordered_map<std::string, std::string>;
+
+		// Keeps the storage on disk as a snapshot and numbered logs of the changes made since, so a change only costs what it appends.
+		// The snapshot records the first log it does not contain
+		class ChangeLog
+		{
+		public:
+			~ChangeLog();
+
+			// Loads the snapshot and replays the logs after it, a record torn by a crash is cut off. Returns false if there was nothing on disk
+			bool open(const std::filesystem::path& folder, StorageMap& data);
+			void close();
+
+			void set(const std::string_view& key, const std::string_view& value);
+			void remove(const std::string_view& key);
+			void clear();
+
+			[[nodiscard]] bool shouldCompact() const;
+
+			[[nodiscard]] const std::filesystem::path& getFolder() const
+			{
+				return this->folder_;
+			}
+
+			[[nodiscard]] std::filesystem::path getLogPath() const
+			{
+				return LogPath(this->folder_, this->generation_);
+			}
+
+			// Continues in a new log and returns the generation a snapshot has to be compacted up to
+			std::uint32_t rotate();
+
+			// Folds the logs before generation into the snapshot. Only touches logs the appending side is done with
+			static bool Compact(const std::filesystem::path& folder, std::uint32_t generation, StorageMap* result = nullptr);
+
+		private:
+			enum class RecordType : std::uint8_t
+			{
+				Set,
+				Remove,
+				Clear,
+			};
+
+			static constexpr std::uint32_t SnapshotMagic = 0x31535353; // SSS1
+			static constexpr std::uint32_t LogMagic = 0x314C5353; // SSL1
+			static constexpr std::size_t HeaderSize = 8;
+			static constexpr std::size_t RecordHeaderSize = 8;
+			static constexpr std::uint64_t CompactSize = 4 * 1024 * 1024;
+
+			static std::mutex CompactMutex;
+
+			std::filesystem::path folder_;
+			std::FILE* log_{};
+			std::uint32_t generation_{};
+			std::uint64_t logSize_{};
+			std::string record_;
+
+			void append(RecordType type, const std::string_view& key, const std::string_view& value);
+			bool createLog();
+
+			// Only returns once the data reached the disk, not just the OS cache
+			static bool WriteDurably(const std::filesystem::path& path, const std::string& data);
+
+			static std::filesystem::path SnapshotPath(const std::filesystem::path& folder);
+			static std::filesystem::path LogPath(const std::filesystem::path& folder, std::uint32_t generation);
+			static std::vector<std::uint32_t> FindLogs(const std::filesystem::path& folder);
+
+			static void WriteHeader(std::string& out, std::uint32_t magic, std::uint32_t generation);
+			static bool ReadHeader(const std::string& buffer, std::uint32_t magic, std::uint32_t* generation);
+			static void WriteRecord(std::string& out, RecordType type, const std::string_view& key, const std::string_view& value);
+
+			// Applies records from pos on and returns where the intact part of the buffer ends
+			static std::size_t Replay(const std::string& buffer, std::size_t pos, StorageMap& data);
+
+			// Returns the generation of the snapshot, 0 if there is none
+			static std::uint32_t LoadSnapshot(const std::filesystem::path& folder, StorageMap& data, bool* exists = nullptr);
+		};
+
+		static StorageMap Data;
+		static ChangeLog Log;
+		static bool Loaded;
+		static std::atomic<bool> CompactionQueued;
+
+		static std::filesystem::path GetFolder();
+		static void EnsureLoaded();
+		static void OnChange();
+		static void Compact(bool exportJson);
 
 		static void AddScriptFunctions();
 	};
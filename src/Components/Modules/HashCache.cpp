@@ -0,0 +1,348 @@
+#include <STDInclude.hpp>
+#include "HashCache.hpp"
+
+namespace Components
+{
+	const char* HashCache::IndexFile = "players/filehashes.dat";
+
+	Utils::Concurrency::Container<HashCache::HashIndex> HashCache::Index;
+
+	std::optional<HashCache::FileState> HashCache::GetFileState(const std::string& file)
+	{
+		std::error_code ec;
+		const auto size = std::filesystem::file_size(file, ec);
+		if (ec) return {};
+
+		const auto lastWrite = std::filesystem::last_write_time(file, ec);
+		if (ec) return {};
+
+		// Paths are case insensitive on Windows
+		auto key = Utils::String::ToLower(file);
+		std::replace(key.begin(), key.end(), '\\', '/');
+
+		return FileState{ std::move(key), size, lastWrite.time_since_epoch().count() };
+	}
+
+	std::string HashCache::FormatHash(const std::string& hash, bool hex)
+	{
+		if (!hex || hash.empty()) return hash;
+		return Utils::String::DumpHex(hash, {});
+	}
+
+	std::string HashCache::GetSHA256(const std::string& file, bool hex)
+	{
+		return GetSHA256(std::vector{ file }, hex)[0];
+	}
+
+	std::vector<std::string> HashCache::GetSHA256(const std::vector<std::string>& files, bool hex)
+	{
+		std::vector<std::string> hashes(files.size());
+		std::vector<std::optional<FileState>> states(files.size());
+		std::vector<std::size_t> missing;
+
+		for (std::size_t i = 0; i < files.size(); ++i)
+		{
+			states[i] = GetFileState(files[i]);
+		}
+
+		Index.access([&](HashIndex& index)
+		{
+			LoadIndex(index);
+
+			for (std::size_t i = 0; i < files.size(); ++i)
+			{
+				if (!states[i]) continue;
+
+				const auto entry = index.entries.find(states[i]->key);
+				if (entry != index.entries.end() && entry->second.size == states[i]->size && entry->second.lastWrite == states[i]->lastWrite)
+				{
+					hashes[i] = entry->second.hash;
+				}
+				else
+				{
+					missing.emplace_back(i);
+				}
+			}
+		});
+
+		if (missing.empty())
+		{
+			std::transform(hashes.begin(), hashes.end(), hashes.begin(), [hex](const std::string& hash) { return FormatHash(hash, hex); });
+			return hashes;
+		}
+
+		// Independent files are hashed in parallel, one per hardware thread at a time
+		const std::size_t workers = std::max(std::thread::hardware_concurrency(), 1u);
+		for (std::size_t i = 0; i < missing.size(); i += workers)
+		{
+			std::vector<std::future<std::string>> jobs;
+			for (auto j = i; j < missing.size() && j < i + workers; ++j)
+			{
+				jobs.emplace_back(std::async(std::launch::async, [&file = files[missing[j]]]
+				{
+					return Utils::Cryptography::SHA256::ComputeFile(file);
+				}));
+			}
+
+			for (std::size_t j = 0; j < jobs.size(); ++j)
+			{
+				hashes[missing[i + j]] = jobs[j].get();
+			}
+		}
+
+		Index.access([&](HashIndex& index)
+		{
+			for (const auto i : missing)
+			{
+				if (hashes[i].size() != HashSize) continue;
+
+				// Don't cache the hash if the file was modified while we were reading it
+				const auto state = GetFileState(files[i]);
+				if (!state || state->size != states[i]->size || state->lastWrite != states[i]->lastWrite) continue;
+
+				index.entries[state->key] = { state->size, state->lastWrite, hashes[i] };
+				index.dirty = true;
+			}
+		});
+
+		SaveIndex();
+
+		std::transform(hashes.begin(), hashes.end(), hashes.begin(), [hex](const std::string& hash) { return FormatHash(hash, hex); });
+		return hashes;
+	}
+
+	std::string HashCache::PeekSHA256(const std::string& file, bool hex)
+	{
+		const auto state = GetFileState(file);
+		if (!state) return {};
+
+		std::string hash;
+		const auto queue = Index.access<bool>([&](HashIndex& index)
+		{
+			LoadIndex(index);
+
+			const auto entry = index.entries.find(state->key);
+			if (entry != index.entries.end() && entry->second.size == state->size && entry->second.lastWrite == state->lastWrite)
+			{
+				hash = entry->second.hash;
+				return false;
+			}
+
+			return index.pending.emplace(state->key).second;
+		});
+
+		if (queue)
+		{
+			Scheduler::Once([file, key = state->key]
+			{
+				GetSHA256(file);
+				Index.access([&](HashIndex& index)
+				{
+					index.pending.erase(key);
+				});
+			}, Scheduler::Pipeline::WORKER);
+		}
+
+		return FormatHash(hash, hex);
+	}
+
+	void HashCache::LoadIndex(HashIndex& index)
+	{
+		if (index.loaded) return;
+		index.loaded = true;
+
+		const auto data = Utils::IO::ReadFile(IndexFile);
+		if (data.size() < sizeof(std::uint32_t) * 2) return;
+
+		std::size_t pos = 0;
+		const auto read = [&](void* out, std::size_t size)
+		{
+			if (pos + size > data.size()) return false;
+
+			std::memcpy(out, data.data() + pos, size);
+			pos += size;
+			return true;
+		};
+
+		std::uint32_t magic, count;
+		if (!read(&magic, sizeof(magic)) || magic != IndexMagic || !read(&count, sizeof(count)))
+		{
+			Logger::Print("Discarding invalid file hash index\n");
+			return;
+		}
+
+		index.entries.reserve(count);
+
+		for (std::uint32_t i = 0; i < count; ++i)
+		{
+			std::uint16_t length;
+			if (!read(&length, sizeof(length)) || pos + length > data.size()) break;
+
+			std::string key(data.data() + pos, length);
+			pos += length;
+
+			Entry entry;
+			entry.hash.resize(HashSize);
+
+			if (!read(&entry.size, sizeof(entry.size)) || !read(&entry.lastWrite, sizeof(entry.lastWrite)) || !read(entry.hash.data(), HashSize)) break;
+
+			index.entries.emplace(std::move(key), std::move(entry));
+		}
+	}
+
+	void HashCache::SaveIndex()
+	{
+		std::unordered_map<std::string, Entry> entries;
+
+		const auto dirty = Index.access<bool>([&](HashIndex& index)
+		{
+			if (!index.dirty) return false;
+			index.dirty = false;
+
+			entries = index.entries;
+			return true;
+		});
+
+		if (!dirty) return;
+
+		// Files that were deleted or moved would stay in the index forever otherwise
+		std::vector<std::pair<std::string, Entry>> removed;
+		for (auto i = entries.begin(); i != entries.end();)
+		{
+			std::error_code ec;
+			if (std::filesystem::exists(i->first, ec))
+			{
+				++i;
+				continue;
+			}
+
+			removed.emplace_back(i->first, std::move(i->second));
+			i = entries.erase(i);
+		}
+
+		if (!removed.empty())
+		{
+			Index.access([&](HashIndex& index)
+			{
+				for (const auto& [key, entry] : removed)
+				{
+					// Leave entries alone that were hashed again in the meantime
+					const auto current = index.entries.find(key);
+					if (current != index.entries.end() && current->second.size == entry.size && current->second.lastWrite == entry.lastWrite)
+					{
+						index.entries.erase(current);
+					}
+				}
+			});
+		}
+
+		std::string data;
+		const auto count = static_cast<std::uint32_t>(entries.size());
+		data.append(reinterpret_cast<const char*>(&IndexMagic), sizeof(IndexMagic));
+		data.append(reinterpret_cast<const char*>(&count), sizeof(count));
+
+		for (const auto& [key, entry] : entries)
+		{
+			const auto length = static_cast<std::uint16_t>(key.size());
+			data.append(reinterpret_cast<const char*>(&length), sizeof(length));
+			data.append(key.data(), length);
+			data.append(reinterpret_cast<const char*>(&entry.size), sizeof(entry.size));
+			data.append(reinterpret_cast<const char*>(&entry.lastWrite), sizeof(entry.lastWrite));
+			data.append(entry.hash);
+		}
+
+		Utils::IO::WriteFile(IndexFile, data);
+	}
+
+	HashCache::HashCache()
+	{
+		Command::Add("clearHashCache", []
+		{
+			Index.access([](HashIndex& index)
+			{
+				index.entries.clear();
+				index.loaded = true;
+				index.dirty = true;
+			});
+
+			SaveIndex();
+			Logger::Print("File hash cache cleared\n");
+		});
+	}
+
+	HashCache::~HashCache()
+	{
+		SaveIndex();
+	}
+
+	bool HashCache::unitTest()
+	{
+		const std::string file = "players/hashcache_test.bin";
+
+		std::string data;
+		for (std::size_t i = 0; i < 3 * 1024 * 1024 + 17; ++i)
+		{
+			data.push_back(static_cast<char>(i * 31 + (i >> 7)));
+		}
+
+		Utils::IO::WriteFile(file, data);
+
+		const auto expected = Utils::Cryptography::SHA256::Compute(data, true);
+		const auto streamed = Utils::Cryptography::SHA256::ComputeFile(file, true);
+
+		// A miss is hashed in the background
+		const auto peekCold = PeekSHA256(file, true);
+
+		std::string peekWarm;
+		for (auto i = 0; i < 500 && peekWarm.empty(); ++i)
+		{
+			std::this_thread::sleep_for(10ms);
+			peekWarm = PeekSHA256(file, true);
+		}
+
+		Index.access([&](HashIndex& index)
+		{
+			index.entries.erase(GetFileState(file)->key);
+		});
+
+		const auto cold = GetSHA256(file, true);
+		const auto warm = GetSHA256(file, true);
+
+		// Saving prunes the removed test file, so it isn't left behind in the persisted index
+		const auto key = GetFileState(file)->key;
+		Utils::IO::RemoveFile(file);
+
+		Index.access([](HashIndex& index)
+		{
+			index.dirty = true;
+		});
+
+		SaveIndex();
+
+		const auto removed = Index.access<bool>([&](const HashIndex& index)
+		{
+			return !index.entries.contains(key);
+		});
+
+		if (!peekCold.empty() || peekWarm != expected)
+		{
+			Logger::PrintError(Game::CON_CHANNEL_ERROR, "File hash peek returned '{}' / '{}' (expected '' / {})\n", peekCold, peekWarm, expected);
+			return false;
+		}
+
+		if (streamed != expected || cold != expected || warm != expected)
+		{
+			Logger::PrintError(Game::CON_CHANNEL_ERROR, "File hash mismatch: {} / {} / {} (expected {})\n", streamed, cold, warm, expected);
+			return false;
+		}
+
+		if (!removed)
+		{
+			Logger::PrintError(Game::CON_CHANNEL_ERROR, "File hash index kept the removed test file\n");
+			return false;
+		}
+
+		Logger::Debug("File hashes match");
+		return true;
+	}
+}
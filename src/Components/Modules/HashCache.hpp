@@ -0,0 +1,57 @@
+#pragma once
+
+namespace Components
+{
+	class HashCache : public Component
+	{
+	public:
+		HashCache();
+		~HashCache();
+
+		bool unitTest() override;
+
+		// Returns the SHA256 of the file, or an empty string if it can't be read
+		static std::string GetSHA256(const std::string& file, bool hex = false);
+
+		// Hashes files that are not cached yet in parallel. The result has the same order as the input
+		static std::vector<std::string> GetSHA256(const std::vector<std::string>& files, bool hex = false);
+
+		// Returns the cached SHA256 without reading the file. On a miss the file is hashed on the WORKER pipeline and an empty string is returned
+		static std::string PeekSHA256(const std::string& file, bool hex = false);
+
+	private:
+		struct Entry
+		{
+			std::uint64_t size;
+			std::int64_t lastWrite;
+			std::string hash;
+		};
+
+		struct FileState
+		{
+			std::string key;
+			std::uint64_t size;
+			std::int64_t lastWrite;
+		};
+
+		struct HashIndex
+		{
+			bool loaded{};
+			bool dirty{};
+			std::unordered_map<std::string, Entry> entries;
+			std::unordered_set<std::string> pending;
+		};
+
+		static constexpr std::uint32_t IndexMagic = 0x31584348; // HCX1
+		static constexpr std::size_t HashSize = 32;
+		static const char* IndexFile;
+
+		static Utils::Concurrency::Container<HashIndex> Index;
+
+		static std::optional<FileState> GetFileState(const std::string& file);
+		static std::string FormatHash(const std::string& hash, bool hex);
+
+		static void LoadIndex(HashIndex& index);
+		static void SaveIndex();
+	};
+}
@@ -3,16 +3,31 @@
 #include "Console.hpp"
 #include "Events.hpp"
 
+#include <share.h>
+
 namespace Components
 {
 	using namespace Utils::String;
 
-	std::mutex Logger::MessageMutex;
-	std::vector<std::string> Logger::MessageQueue;
+	Logger::MessageRing<Logger::MessageQueueCapacity, Logger::MessageQueueMessageSize> Logger::MessageQueue;
 
 	std::recursive_mutex Logger::LoggingMutex;
 	std::vector<Network::Address> Logger::LoggingAddresses[2];
 
+	Utils::Concurrency::Container<Logger::GameLogBatch> Logger::GameLog;
+	std::atomic<bool> Logger::GameLogFlushQueued;
+
+	std::mutex Logger::GameLogWriterMutex;
+	std::FILE* Logger::GameLogFile;
+	std::string Logger::GameLogPath;
+	std::string Logger::GameLogBuffer;
+	std::uint64_t Logger::GameLogSize;
+	int Logger::GameLogDay;
+	bool Logger::GameLogFailed;
+
+	Dvar::Var Logger::GameLogMaxSize;
+	Dvar::Var Logger::GameLogRotateDaily;
+
 	void(*Logger::PipeCallback)(const std::string&) = nullptr;;
 
 	bool Logger::IsConsoleReady()
@@ -59,7 +74,7 @@ namespace Components
 
 		if (!Game::Sys_IsMainThread())
 		{
-			EnqueueMessage(msg);
+			EnqueueMessage(channel, msg);
 		}
 		else
 		{
@@ -124,20 +139,26 @@ namespace Components
 
 	void Logger::Frame()
 	{
-		std::unique_lock _(MessageMutex);
-
-		for (auto i = MessageQueue.begin(); i != MessageQueue.end();)
+		MessageQueue.drain([](const int channel, const char* message)
 		{
-			Game::Com_PrintMessage(Game::CON_CHANNEL_DONT_FILTER, i->data(), 0);
+			Game::Com_PrintMessage(channel, message, 0);
 
 #ifdef _DEBUG
 			if (!IsConsoleReady())
 			{
-				OutputDebugStringA(i->data());
+				OutputDebugStringA(message);
 			}
 #endif
+		});
 
-			i = MessageQueue.erase(i);
+		if (const auto dropped = MessageQueue.takeDropped())
+		{
+			Game::Com_PrintMessage(Game::CON_CHANNEL_DONT_FILTER, VA("^3%u messages from other threads were dropped, the log queue was full\n", dropped), 0);
+		}
+
+		if (const auto truncated = MessageQueue.takeTruncated())
+		{
+			Game::Com_PrintMessage(Game::CON_CHANNEL_DONT_FILTER, VA("^3%u messages from other threads were truncated to %u characters\n", truncated, MessageQueueMessageSize - 1), 0);
 		}
 	}
 
@@ -180,14 +201,207 @@ namespace Components
 
 		const auto time = Game::level->time / 1000;
 		const auto len = sprintf_s(string, "%3i:%i%i %s", time / 60, time % 60 / 10, time % 60 % 10, string2);
+		if (len <= 0)
+		{
+			return;
+		}
+
+		bool hasSubscribers;
+		{
+			std::unique_lock lock(LoggingMutex);
+			hasSubscribers = !LoggingAddresses[1].empty();
+		}
+
+		// The game still opens the file, its handle tells us whether logging is enabled. We write it ourselves off the server thread
+		const auto logToFile = Game::level->logFile != 0;
+
+		const auto flush = GameLog.access<bool>([&](GameLogBatch& batch)
+		{
+			if (logToFile)
+			{
+				// A new handle means a new map, g_log may have changed since
+				if (batch.handle != Game::level->logFile)
+				{
+					batch.handle = Game::level->logFile;
+
+					char path[MAX_PATH]{};
+					Game::FS_BuildOSPath((*Game::fs_homepath)->current.string, reinterpret_cast<char*>(0x63D0BB8), (*Game::g_log)->current.string, path);
+					batch.path = path;
+				}
+
+				batch.file.append(string, len);
+			}
+
+			// Allow the network log to run even if logFile was not opened
+			if (hasSubscribers)
+			{
+				batch.network.append(string, len);
+			}
+
+			return batch.file.size() >= GameLogFlushSize;
+		});
+
+		if (flush && !GameLogFlushQueued.exchange(true))
+		{
+			Scheduler::Once([]
+			{
+				FlushGameLog();
+			}, Scheduler::Pipeline::ASYNC);
+		}
+	}
+
+	void Logger::FlushGameLog(const bool close)
+	{
+		std::lock_guard _(GameLogWriterMutex);
+		GameLogFlushQueued = false;
+
+		std::string path;
+		GameLog.access([&](GameLogBatch& batch)
+		{
+			// Swap buffers so neither side allocates once both have grown
+			GameLogBuffer.swap(batch.file);
+			path = batch.path;
+
+			if (close)
+			{
+				batch.path.clear();
+				batch.handle = 0;
+			}
+		});
 
-		if (Game::level->logFile)
+		if (!GameLogBuffer.empty() && !path.empty())
 		{
-			Game::FS_Write(string, len, Game::level->logFile);
+			if (GameLogFile && path != GameLogPath)
+			{
+				std::fclose(GameLogFile);
+				GameLogFile = nullptr;
+			}
+
+			if (!GameLogFile)
+			{
+				GameLogPath = path;
+				GameLogFile = OpenGameLog("ab");
+
+				std::error_code ec;
+				GameLogSize = std::filesystem::file_size(GameLogPath, ec);
+
+				const auto now = std::time(nullptr);
+				std::tm tm{};
+				localtime_s(&tm, &now);
+				GameLogDay = tm.tm_yday;
+			}
+
+			RotateGameLog();
+
+			if (GameLogFile)
+			{
+				std::fwrite(GameLogBuffer.data(), 1, GameLogBuffer.size(), GameLogFile);
+				std::fflush(GameLogFile);
+				GameLogSize += GameLogBuffer.size();
+				GameLogFailed = false;
+			}
+			else
+			{
+				if (!GameLogFailed)
+				{
+					PrintError(Game::CON_CHANNEL_ERROR, "Failed to open the game log {}, retrying on the next flush\n", path);
+					GameLogFailed = true;
+				}
+
+				// Put the lines back in front of the ones that arrived in the meantime
+				GameLog.access([](GameLogBatch& batch)
+				{
+					GameLogBuffer.append(batch.file);
+					batch.file.swap(GameLogBuffer);
+
+					if (batch.file.size() > GameLogMaxPending)
+					{
+						const auto cut = batch.file.find('\n', batch.file.size() - GameLogMaxPending);
+						batch.file.erase(0, cut == std::string::npos ? batch.file.size() - GameLogMaxPending : cut + 1);
+					}
+				});
+			}
 		}
 
-		// Allow the network log to run even if logFile was not opened
-		NetworkLog(string, true);
+		GameLogBuffer.clear();
+
+		if (close && GameLogFile)
+		{
+			std::fclose(GameLogFile);
+			GameLogFile = nullptr;
+		}
+	}
+
+	void Logger::RotateGameLog()
+	{
+		const auto now = std::time(nullptr);
+		std::tm tm{};
+		localtime_s(&tm, &now);
+
+		const auto maxSize = static_cast<std::uint64_t>(GameLogMaxSize.get<int>()) * 1024 * 1024;
+		const auto bySize = maxSize && GameLogSize >= maxSize;
+		const auto byDate = GameLogRotateDaily.get<bool>() && tm.tm_yday != GameLogDay;
+		if (!GameLogFile || (!bySize && !byDate)) return;
+
+		// The game keeps its own handle to the log open, so copy and truncate instead of renaming
+		std::fclose(GameLogFile);
+		GameLogFile = nullptr;
+
+		char suffix[32]{};
+		std::strftime(suffix, sizeof(suffix), ".%Y-%m-%d_%H%M%S", &tm);
+
+		std::error_code ec;
+		std::filesystem::copy_file(GameLogPath, GameLogPath + suffix, std::filesystem::copy_options::overwrite_existing, ec);
+		if (ec)
+		{
+			PrintError(Game::CON_CHANNEL_ERROR, "Failed to rotate the game log: {}\n", ec.message());
+			GameLogFile = OpenGameLog("ab");
+			return;
+		}
+
+		GameLogFile = OpenGameLog("wb");
+		GameLogSize = 0;
+		GameLogDay = tm.tm_yday;
+	}
+
+	std::FILE* Logger::OpenGameLog(const char* mode)
+	{
+		// fopen_s denies other writers, but the game keeps its own handle to the log open for writing
+		return _fsopen(GameLogPath.data(), mode, _SH_DENYNO);
+	}
+
+	void Logger::FlushNetworkLog()
+	{
+		static std::string batch;
+		GameLog.access([](GameLogBatch& gameLog)
+		{
+			batch.swap(gameLog.network);
+		});
+
+		if (batch.empty()) return;
+
+		std::unique_lock lock(LoggingMutex);
+
+		// Several lines per packet, split at line ends
+		for (std::size_t pos = 0; pos < batch.size();)
+		{
+			auto end = std::min(pos + NetworkLogPacketSize, batch.size());
+			if (end < batch.size())
+			{
+				const auto lineEnd = batch.rfind('\n', end - 1);
+				if (lineEnd != std::string::npos && lineEnd >= pos) end = lineEnd + 1;
+			}
+
+			const auto packet = batch.substr(pos, end - pos);
+			for (const auto& addr : LoggingAddresses[1])
+			{
+				Network::SendCommand(addr, "print", packet);
+			}
+
+			pos = end;
+		}
+
+		batch.clear();
 	}
 
 	__declspec(naked) void Logger::PrintMessage_Stub()
@@ -225,10 +439,9 @@ namespace Components
 		}
 	}
 
-	void Logger::EnqueueMessage(const std::string& message)
+	void Logger::EnqueueMessage(const int channel, const std::string& message)
 	{
-		std::unique_lock _(MessageMutex);
-		MessageQueue.push_back(message);
+		MessageQueue.push(channel, message);
 	}
 
 	void Logger::LSP_LogString_Stub([[maybe_unused]] int localControllerIndex, const char* string)
@@ -357,6 +570,21 @@ namespace Components
 	{
 		Scheduler::Loop(Frame, Scheduler::Pipeline::SERVER);
 
+		GameLogMaxSize = Dvar::Register<int>("g_logMaxSize", 0, 0, 4096, Game::DVAR_NONE, "Rotate the game log once it grows beyond this many MB, 0 disables");
+		GameLogRotateDaily = Dvar::Register<bool>("g_logRotateDaily", false, Game::DVAR_NONE, "Rotate the game log when the day changes");
+
+		Scheduler::Loop([]
+		{
+			FlushGameLog();
+		}, Scheduler::Pipeline::ASYNC, GameLogFlushInterval);
+
+		Scheduler::Loop(FlushNetworkLog, Scheduler::Pipeline::SERVER, 100ms);
+
+		Scheduler::OnGameShutdown([]
+		{
+			FlushGameLog(true);
+		});
+
 		Utils::Hook(Game::G_LogPrintf, G_LogPrintf_Hk, HOOK_JUMP).install()->quick();
 		Utils::Hook(Game::Com_PrintMessage, PrintMessage_Stub, HOOK_JUMP).install()->quick();
 
@@ -371,14 +599,151 @@ namespace Components
 		Events::OnSVInit(AddServerCommands);
 	}
 
+	bool Logger::unitTest()
+	{
+		constexpr std::size_t producers = 8;
+		constexpr std::size_t capacity = 4096;
+		constexpr std::size_t floodMessages = 50000;
+
+		using TestRing = MessageRing<capacity, 128>;
+		const auto ring = std::make_unique<TestRing>();
+
+		// Up to the bound nothing may get lost, and every producer's messages must stay in order
+		std::vector<std::thread> threads;
+		for (std::size_t i = 0; i < producers; ++i)
+		{
+			threads.emplace_back([&ring, i]
+			{
+				for (std::size_t j = 0; j < capacity / producers; ++j)
+				{
+					ring->push(static_cast<int>(i), std::format("{} {}\n", i, j));
+				}
+			});
+		}
+
+		for (auto& thread : threads) thread.join();
+		threads.clear();
+
+		std::size_t next[producers]{};
+		auto ordered = true;
+
+		const auto received = ring->drain([&](const int channel, const char* message)
+		{
+			const auto index = static_cast<std::size_t>(std::atoi(std::strchr(message, ' ') + 1));
+			ordered &= index == next[channel]++;
+		});
+
+		if (received != capacity || ring->takeDropped() || !ordered)
+		{
+			PrintError(Game::CON_CHANNEL_ERROR, "Log ring lost messages below its bound: {} of {} received{}\n", received, capacity, ordered ? "" : ", out of order");
+			return false;
+		}
+
+		// Flood it while a consumer drains like the main thread does every frame. What doesn't fit must be counted
+		std::atomic<bool> done{};
+		std::atomic<std::size_t> produced{};
+		std::size_t consumed = 0, dropped = 0;
+		std::chrono::nanoseconds longestDrain{};
+
+		for (std::size_t i = 0; i < producers; ++i)
+		{
+			threads.emplace_back([&ring, &produced, i]
+			{
+				for (std::size_t j = 0; j < floodMessages; ++j)
+				{
+					ring->push(static_cast<int>(i), "flooding the log from a worker thread\n");
+					produced.fetch_add(1, std::memory_order_relaxed);
+				}
+			});
+		}
+
+		std::thread waiter([&]
+		{
+			for (auto& thread : threads) thread.join();
+			done = true;
+		});
+
+		while (true)
+		{
+			const auto finished = done.load();
+
+			const auto start = std::chrono::high_resolution_clock::now();
+			consumed += ring->drain([](int, const char*) {});
+			longestDrain = std::max<std::chrono::nanoseconds>(longestDrain, std::chrono::high_resolution_clock::now() - start);
+
+			dropped += ring->takeDropped();
+
+			if (finished && !ring->drain([&](int, const char*) { ++consumed; })) break;
+			std::this_thread::sleep_for(1ms);
+		}
+
+		waiter.join();
+		dropped += ring->takeDropped();
+
+		const auto longestDrainMs = std::chrono::duration_cast<std::chrono::milliseconds>(longestDrain).count();
+		Print("Log ring: {} messages from {} threads, {} printed, {} dropped, longest drain {}ms\n", produced.load(), producers, consumed, dropped, longestDrainMs);
+
+		if (consumed + dropped != produced.load())
+		{
+			PrintError(Game::CON_CHANNEL_ERROR, "Log ring lost track of {} messages\n", produced.load() - consumed - dropped);
+			return false;
+		}
+
+		// A drain is bounded by the capacity, it must never hold up a frame
+		if (longestDrainMs > 100)
+		{
+			PrintError(Game::CON_CHANNEL_ERROR, "Draining the log ring stalled for {}ms\n", longestDrainMs);
+			return false;
+		}
+
+		// Lines the game log can't take yet wait for the next flush
+		const std::string folder = "players/logger_test";
+		const auto logPath = folder + "/missing/games_mp.log";
+
+		std::error_code ec;
+		std::filesystem::remove_all(folder, ec);
+
+		GameLog.access([&](GameLogBatch& batch)
+		{
+			batch.path = logPath;
+			batch.file = "first line\n";
+		});
+
+		FlushGameLog();
+
+		const auto kept = GameLog.access<std::string>([](GameLogBatch& batch)
+		{
+			batch.file.append("second line\n");
+			return batch.file;
+		});
+
+		Utils::IO::CreateDir(folder + "/missing");
+
+		// The game has the log open for writing while we append to it, like level.logFile
+		auto* gameHandle = _fsopen(logPath.data(), "ab", _SH_DENYNO);
+		FlushGameLog(true);
+
+		const auto written = Utils::IO::ReadFile(logPath);
+
+		if (gameHandle) std::fclose(gameHandle);
+		std::filesystem::remove_all(folder, ec);
+
+		if (!gameHandle || kept != "first line\nsecond line\n" || written != kept)
+		{
+			PrintError(Game::CON_CHANNEL_ERROR, "Game log lines were lost while the file could not be opened or was shared: kept '{}', wrote '{}'\n", kept, written);
+			return false;
+		}
+
+		return true;
+	}
+
 	Logger::~Logger()
 	{
 		std::unique_lock lock_logging(LoggingMutex);
 		LoggingAddresses[0].clear();
 		LoggingAddresses[1].clear();
 
-		std::unique_lock lock_message(MessageMutex);
-		MessageQueue.clear();
+		FlushGameLog(true);
 
 		// Flush the console log
 		if (*Game::logfile)
@@ -9,6 +9,8 @@ namespace Components
 	public:
 		Logger();
 		~Logger();
+
+		bool unitTest() override;
 		
 		static bool IsConsoleReady();
 
@@ -123,13 +125,139 @@ namespace Components
 #endif
 		}
 
+		// Bounded multi-producer single-consumer queue of preallocated messages. Producers never wait or allocate,
+		// a message that doesn't fit is dropped and counted
+		template <std::size_t Capacity, std::size_t MessageSize>
+		class MessageRing
+		{
+			static_assert(std::has_single_bit(Capacity), "Capacity must be a power of two");
+
+		public:
+			MessageRing()
+			{
+				for (std::size_t i = 0; i < Capacity; ++i)
+				{
+					this->slots_[i].sequence.store(i, std::memory_order_relaxed);
+				}
+			}
+
+			bool push(const int channel, const std::string_view& message)
+			{
+				auto pos = this->enqueuePos_.load(std::memory_order_relaxed);
+				Slot* slot;
+
+				while (true)
+				{
+					slot = &this->slots_[pos & (Capacity - 1)];
+
+					const auto sequence = slot->sequence.load(std::memory_order_acquire);
+					const auto diff = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(pos);
+
+					if (diff == 0)
+					{
+						if (this->enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+					}
+					else if (diff < 0)
+					{
+						// The consumer hasn't freed this slot yet
+						this->dropped_.fetch_add(1, std::memory_order_relaxed);
+						return false;
+					}
+					else
+					{
+						pos = this->enqueuePos_.load(std::memory_order_relaxed);
+					}
+				}
+
+				const auto length = std::min(message.size(), MessageSize - 1);
+				if (length < message.size()) this->truncated_.fetch_add(1, std::memory_order_relaxed);
+
+				std::memcpy(slot->data, message.data(), length);
+				slot->data[length] = '\0';
+				slot->channel = channel;
+
+				slot->sequence.store(pos + 1, std::memory_order_release);
+				return true;
+			}
+
+			// Hands the queued messages to the callback, only one thread may drain at a time.
+			// Messages pushed while draining wait for the next call, so a flood can't keep the consumer here
+			template <typename T>
+			std::size_t drain(T&& callback)
+			{
+				std::size_t count = 0;
+				for (; count < Capacity; ++count)
+				{
+					auto& slot = this->slots_[this->dequeuePos_ & (Capacity - 1)];
+					if (slot.sequence.load(std::memory_order_acquire) != this->dequeuePos_ + 1) break;
+
+					callback(slot.channel, static_cast<const char*>(slot.data));
+
+					slot.sequence.store(this->dequeuePos_ + Capacity, std::memory_order_release);
+					++this->dequeuePos_;
+				}
+
+				return count;
+			}
+
+			std::size_t takeDropped() { return this->dropped_.exchange(0, std::memory_order_relaxed); }
+			std::size_t takeTruncated() { return this->truncated_.exchange(0, std::memory_order_relaxed); }
+
+		private:
+			struct Slot
+			{
+				std::atomic<std::size_t> sequence;
+				int channel;
+				char data[MessageSize];
+			};
+
+			Slot slots_[Capacity];
+
+			alignas(64) std::atomic<std::size_t> enqueuePos_{};
+			alignas(64) std::size_t dequeuePos_{};
+
+			std::atomic<std::size_t> dropped_{};
+			std::atomic<std::size_t> truncated_{};
+		};
+
 	private:
-		static std::mutex MessageMutex;
-		static std::vector<std::string> MessageQueue;
+		static constexpr std::size_t MessageQueueCapacity = 1024;
+		static constexpr std::size_t MessageQueueMessageSize = 1024;
+
+		static MessageRing<MessageQueueCapacity, MessageQueueMessageSize> MessageQueue;
 
 		static std::recursive_mutex LoggingMutex;
 		static std::vector<Network::Address> LoggingAddresses[2];
 
+		// Game log lines are collected on the server thread and written by an ASYNC worker
+		struct GameLogBatch
+		{
+			std::string file;
+			std::string network;
+			std::string path;
+			int handle;
+		};
+
+		static constexpr std::size_t GameLogFlushSize = 64 * 1024;
+		static constexpr auto GameLogFlushInterval = 1s;
+		static constexpr std::size_t GameLogMaxPending = 4 * 1024 * 1024; // Kept while the file can't be opened, older lines are dropped beyond
+		static constexpr std::size_t NetworkLogPacketSize = 1200;
+
+		static Utils::Concurrency::Container<GameLogBatch> GameLog;
+		static std::atomic<bool> GameLogFlushQueued;
+
+		// Only touched by whoever holds GameLogWriterMutex
+		static std::mutex GameLogWriterMutex;
+		static std::FILE* GameLogFile;
+		static std::string GameLogPath;
+		static std::string GameLogBuffer;
+		static std::uint64_t GameLogSize;
+		static int GameLogDay;
+		static bool GameLogFailed;
+
+		static Dvar::Var GameLogMaxSize;
+		static Dvar::Var GameLogRotateDaily;
+
 		static void(*PipeCallback)(const std::string&);
 
 		static void MessagePrint(int channel, const std::string& msg);
@@ -139,10 +267,15 @@ namespace Components
 		static void G_LogPrintf_Hk(const char* fmt, ...);
 		static void PrintMessage_Stub();
 		static void PrintMessagePipe(const char* data);
-		static void EnqueueMessage(const std::string& message);
+		static void EnqueueMessage(int channel, const std::string& message);
 
 		static void NetworkLog(const char* data, bool gLog);
 
+		static void FlushGameLog(bool close = false);
+		static void RotateGameLog();
+		static std::FILE* OpenGameLog(const char* mode);
+		static void FlushNetworkLog();
+
 		static void LSP_LogString_Stub(int localControllerIndex, const char* string);
 		static void LSP_LogStringAboutUser_Stub(int localControllerIndex, std::uint64_t xuid, const char* string);
 
@@ -2,6 +2,7 @@
 
 #include "ArenaLength.hpp"
 #include "FastFiles.hpp"
+#include "HashCache.hpp"
 #include "RawFiles.hpp"
 #include "StartupMessages.hpp"
 #include "Theatre.hpp"
@@ -434,17 +435,23 @@ namespace Components
 	{
 		if (Utils::IO::DirectoryExists(std::format("usermaps/{}", map)))
 		{
-			std::string hash;
+			std::vector<std::string> files;
 
 			for (std::size_t i = 0; i < ARRAYSIZE(Maps::UserMapFiles); ++i)
 			{
 				auto filePath = std::format("usermaps/{}/{}{}", map, map, Maps::UserMapFiles[i]);
 				if (Utils::IO::FileExists(filePath))
 				{
-					hash.append(Utils::Cryptography::SHA256::Compute(Utils::IO::ReadFile(filePath)));
+					files.emplace_back(std::move(filePath));
 				}
 			}
 
+			std::string hash;
+			for (const auto& fileHash : HashCache::GetSHA256(files))
+			{
+				hash.append(fileHash);
+			}
+
 			return Utils::Cryptography::JenkinsOneAtATime::Compute(hash);
 		}
 
@@ -604,6 +611,7 @@ namespace Components
 	void Maps::ScanCustomMaps()
 	{
 		FoundCustomMaps.clear();
+		FastFiles::RefreshZoneIndex();
 		Logger::Print("Looking for custom maps...\n");
 
 		std::filesystem::path basePath = (*Game::fs_basepath)->current.string;
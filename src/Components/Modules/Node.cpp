@@ -11,7 +11,7 @@
 namespace Components
 {
 	std::recursive_mutex Node::Mutex;
-	std::vector<Node::Entry> Node::Nodes;
+	Node::Table Node::Nodes;
 
 	bool Node::WasIngame = false;
 
@@ -49,8 +49,23 @@ namespace Components
 		if (!this->lastRequest.has_value()) this->lastRequest.emplace(Utils::Time::Point());
 		this->lastRequest->update();
 
-		Session::Send(this->address, "nodeListRequest");
-		SendList(this->address);
+		Proto::Node::Request request;
+		request.set_version(this->acknowledged);
+		request.set_epoch(this->epoch);
+		request.set_compact(true);
+
+		Session::Send(this->address, "nodeListRequest", request.SerializeAsString());
+
+		// Nodes that told us their epoch understand deltas, old ones still get the full list
+		if (this->epoch)
+		{
+			SendDelta(this->address, this->pushed);
+			this->pushed = Nodes.getVersion();
+		}
+		else
+		{
+			SendList(this->address);
+		}
 #ifdef NODE_SYSTEM_DEBUG
 		Logger::Debug("Sent request to {}", this->address.getString());
 #endif
@@ -61,6 +76,167 @@ namespace Components
 		this->lastRequest.reset();
 	}
 
+	Node::Table::Table()
+	{
+		std::random_device rd;
+		this->epoch_ = rd() | 1;
+	}
+
+	Node::Entry* Node::Table::find(const Network::Address& address)
+	{
+		const auto itr = this->index_.find(GetKey(address));
+		if (itr == this->index_.end()) return nullptr;
+
+		return &this->entries_[itr->second];
+	}
+
+	Node::Entry* Node::Table::add(const Network::Address& address)
+	{
+		const auto [itr, inserted] = this->index_.try_emplace(GetKey(address), this->entries_.size());
+		if (!inserted) return &this->entries_[itr->second];
+
+		auto& entry = this->entries_.emplace_back();
+		entry.address = address;
+		return &entry;
+	}
+
+	void Node::Table::refresh(Entry* entry)
+	{
+		entry->version = ++this->version_;
+	}
+
+	void Node::Table::erase(const std::size_t index)
+	{
+		this->index_.erase(GetKey(this->entries_[index].address));
+
+		// Order doesn't matter, move the last entry into the gap
+		if (index + 1 != this->entries_.size())
+		{
+			this->entries_[index] = std::move(this->entries_.back());
+			this->index_[GetKey(this->entries_[index].address)] = index;
+		}
+
+		this->entries_.pop_back();
+		this->packedAt_.reset();
+	}
+
+	void Node::Table::clear()
+	{
+		this->entries_.clear();
+		this->index_.clear();
+		this->packed_.clear();
+		this->packedVersions_.clear();
+		this->packedAt_.reset();
+	}
+
+	void Node::Table::Acknowledge(Entry* entry, const Chunk& chunk, const std::uint32_t epoch)
+	{
+		if (entry->epoch != epoch)
+		{
+			entry->epoch = epoch;
+			entry->acknowledged = 0;
+		}
+
+		// Chunks that arrive after a lost one are applied, but can't move the acknowledged version past the gap
+		if (chunk.since <= entry->acknowledged)
+		{
+			entry->acknowledged = std::max(entry->acknowledged, chunk.version);
+		}
+	}
+
+	std::vector<Node::Chunk> Node::Table::getDelta(std::uint64_t since)
+	{
+		this->updatePacked();
+
+		std::vector<Chunk> chunks;
+
+		auto begin = static_cast<std::size_t>(std::upper_bound(this->packedVersions_.begin(), this->packedVersions_.end(), since) - this->packedVersions_.begin());
+		while (begin < this->packedVersions_.size())
+		{
+			const auto end = std::min(begin + NODE_MAX_PACKED_NODES_TO_SEND, this->packedVersions_.size());
+			chunks.emplace_back(Chunk{ since, this->packedVersions_[end - 1], this->packed_.substr(begin * PackedSize, (end - begin) * PackedSize) });
+
+			since = this->packedVersions_[end - 1];
+			begin = end;
+		}
+
+		// The last chunk also covers the versions of entries that are not valid anymore.
+		// Without changes we still send an empty chunk so the peer learns our version
+		if (chunks.empty())
+		{
+			chunks.emplace_back(Chunk{ since, this->version_, {} });
+		}
+		else
+		{
+			chunks.back().version = this->version_;
+		}
+
+		return chunks;
+	}
+
+	void Node::Table::updatePacked()
+	{
+		// Entries also expire without a new version, so rebuild every now and then
+		if (this->packedAt_ == this->version_ && !this->packedTime_.elapsed(10s)) return;
+
+		std::vector<const Entry*> valid;
+		for (const auto& entry : this->entries_)
+		{
+			if (entry.isValid() && entry.address.getType() == Game::NA_IP)
+			{
+				valid.emplace_back(&entry);
+			}
+		}
+
+		std::sort(valid.begin(), valid.end(), [](const Entry* a, const Entry* b)
+		{
+			return a->version < b->version;
+		});
+
+		this->packed_.clear();
+		this->packed_.reserve(valid.size() * PackedSize);
+		this->packedVersions_.clear();
+		this->packedVersions_.reserve(valid.size());
+
+		for (const auto* entry : valid)
+		{
+			Pack(entry->address, this->packed_);
+			this->packedVersions_.emplace_back(entry->version);
+		}
+
+		this->packedAt_ = this->version_;
+		this->packedTime_.update();
+	}
+
+	std::uint64_t Node::Table::GetKey(const Network::Address& address)
+	{
+		return (static_cast<std::uint64_t>(address.getType()) << 48) | (static_cast<std::uint64_t>(address.getIP().full) << 16) | address.getPort();
+	}
+
+	void Node::Table::Pack(const Network::Address& address, std::string& out)
+	{
+		const auto ip = address.getIP();
+		const auto port = address.getPort();
+
+		out.append(reinterpret_cast<const char*>(ip.bytes), sizeof(ip.bytes));
+		out.push_back(static_cast<char>(port >> 8));
+		out.push_back(static_cast<char>(port & 0xFF));
+	}
+
+	Network::Address Node::Table::Unpack(const char* data)
+	{
+		Game::netIP_t ip;
+		std::memcpy(ip.bytes, data, sizeof(ip.bytes));
+
+		const auto* port = reinterpret_cast<const unsigned char*>(data + sizeof(ip.bytes));
+
+		Network::Address address;
+		address.setType(Game::NA_IP);
+		address.setIP(ip);
+		address.setPort(static_cast<unsigned short>((port[0] << 8) | port[1]));
+		return address;
+	}
+
 	void Node::LoadNodePreset()
 	{
 		Proto::Node::List list;
@@ -130,7 +306,7 @@ namespace Components
 
 		Mutex.lock();
 
-		for (auto& node : Nodes)
+		for (auto& node : Nodes.entries())
 		{
 			if (node.isValid() || force)
 			{
@@ -156,22 +332,14 @@ namespace Components
 		if (!address.isValid()) return;
 
 		std::lock_guard _(Mutex);
-		for (auto& session : Nodes)
-		{
-			if (session.address == address) return;
-		}
-
-		Entry node;
-		node.address = address;
-
-		Nodes.push_back(node);
+		Nodes.add(address);
 	}
 
 	std::vector<Node::Entry> Node::GetNodes()
 	{
 		std::lock_guard _(Mutex);
 
-		return Nodes;
+		return Nodes.entries();
 	}
 
 	void Node::RunFrame()
@@ -191,7 +359,7 @@ namespace Components
 
 		if (WasIngame) // our last frame we were in-game and now we aren't so touch all nodes
 		{
-			for (auto& entry : Nodes)
+			for (auto& entry : Nodes.entries())
 			{
 				// clearing the last request and response times makes the 
 				// dispatcher think its a new node and will force a refresh
@@ -210,18 +378,19 @@ namespace Components
 		std::lock_guard _(Mutex);
 
 		int sentRequests = 0;
-		for (auto i = Nodes.begin(); i != Nodes.end();)
+		auto& entries = Nodes.entries();
+		for (std::size_t i = 0; i < entries.size();)
 		{
-			if (i->isDead())
+			if (entries[i].isDead())
 			{
-				i = Nodes.erase(i);
+				Nodes.erase(i);
 				continue;
 			}
 
-			if (sentRequests < ServerList::NETServerQueryLimit.get<int>() && i->requiresRequest())
+			if (sentRequests < ServerList::NETServerQueryLimit.get<int>() && entries[i].requiresRequest())
 			{
 				++sentRequests;
-				i->sendRequest();
+				entries[i].sendRequest();
 			}
 
 			++i;
@@ -231,11 +400,12 @@ namespace Components
 	void Node::Synchronize()
 	{
 		std::lock_guard _(Mutex);
-		for (auto& node : Nodes)
+		for (auto& node : Nodes.entries())
 		{
-			{
-				node.reset();
-			}
+			// Start over with full lists in both directions
+			node.reset();
+			node.acknowledged = 0;
+			node.pushed = 0;
 		}
 	}
 
@@ -260,6 +430,12 @@ namespace Components
 			}
 		}
 
+		const auto& packed = list.packednodes();
+		for (std::size_t i = 0; i + Table::PackedSize <= packed.size(); i += Table::PackedSize)
+		{
+			Add(Table::Unpack(packed.data() + i));
+		}
+
 		if (list.isnode() && (!list.port() || list.port() == address.getPort()))
 		{
 			if (!Dedicated::IsEnabled() && ServerList::IsOnlineList() && !ServerList::UseMasterServer && list.protocol() == PROTOCOL)
@@ -276,24 +452,44 @@ namespace Components
 #endif
 			}
 
-			for (auto& node : Nodes)
-			{
-				if (address == node.address)
-				{
-					if (!node.lastResponse.has_value()) node.lastResponse.emplace(Utils::Time::Point());
-					node.lastResponse->update();
+			auto* node = Nodes.add(address);
 
-					node.data.protocol = list.protocol();
-					return;
-				}
+			// Nodes that (re)appear get a new version so peers pick them up with their next delta
+			if (!node->isValid()) Nodes.refresh(node);
+
+			if (!node->lastResponse.has_value()) node->lastResponse.emplace(Utils::Time::Point());
+			node->lastResponse->update();
+
+			node->data.protocol = list.protocol();
+		}
+
+		if (list.epoch())
+		{
+			if (auto* node = Nodes.find(address))
+			{
+				Table::Acknowledge(node, { list.since(), list.version(), {} }, list.epoch());
 			}
+		}
+	}
 
-			Entry entry;
-			entry.address = address;
-			entry.data.protocol = list.protocol();
-			entry.lastResponse.emplace(Utils::Time::Point());
+	void Node::HandleRequest(const Network::Address& address, const std::string& data)
+	{
+		Proto::Node::Request request;
+		if (data.empty() || !request.ParseFromString(data) || !request.compact())
+		{
+			SendList(address);
+			return;
+		}
 
-			Nodes.push_back(entry);
+		std::lock_guard _(Mutex);
+
+		// Versions of a previous run of ours mean nothing anymore
+		const auto since = request.epoch() == Nodes.getEpoch() ? request.version() : 0;
+		SendDelta(address, since);
+
+		if (auto* node = Nodes.find(address))
+		{
+			node->pushed = Nodes.getVersion();
 		}
 	}
 
@@ -304,7 +500,8 @@ namespace Components
 		// need to keep the message size below 1404 bytes else recipient will just drop it
 		std::vector<std::string> nodeListReponseMessages;
 
-		for (std::size_t curNode = 0; curNode < Nodes.size();)
+		auto& entries = Nodes.entries();
+		for (std::size_t curNode = 0; curNode < entries.size();)
 		{
 			Proto::Node::List list;
 			list.set_isnode(Dedicated::IsEnabled());
@@ -313,12 +510,12 @@ namespace Components
 
 			for (std::size_t i = 0; i < NODE_MAX_NODES_TO_SEND;)
 			{
-				if (curNode >= Nodes.size())
+				if (curNode >= entries.size())
 				{
 					break;
 				}
 
-				auto& node = Nodes.at(curNode++);
+				auto& node = entries.at(curNode++);
 
 				if (node.isValid())
 				{
@@ -334,8 +531,36 @@ namespace Components
 			nodeListReponseMessages.push_back(list.SerializeAsString());
 		}
 
+		SendMessages(address, nodeListReponseMessages);
+	}
+
+	void Node::SendDelta(const Network::Address& address, const std::uint64_t since)
+	{
+		std::lock_guard _(Mutex);
+
+		std::vector<std::string> messages;
+		for (auto& chunk : Nodes.getDelta(since))
+		{
+			Proto::Node::List list;
+			list.set_isnode(Dedicated::IsEnabled());
+			list.set_protocol(PROTOCOL);
+			list.set_port(GetPort());
+
+			list.set_packednodes(std::move(chunk.packed));
+			list.set_since(chunk.since);
+			list.set_version(chunk.version);
+			list.set_epoch(Nodes.getEpoch());
+
+			messages.emplace_back(list.SerializeAsString());
+		}
+
+		SendMessages(address, messages);
+	}
+
+	void Node::SendMessages(const Network::Address& address, const std::vector<std::string>& messages)
+	{
 		auto i = 0;
-		for (const auto& nodeListData : nodeListReponseMessages)
+		for (const auto& nodeListData : messages)
 		{
 			Scheduler::Once([=]
 			{
@@ -403,10 +628,7 @@ namespace Components
 		Scheduler::Loop(RunFrame, Scheduler::Pipeline::MAIN);
 
 		Session::Handle("nodeListResponse", HandleResponse);
-		Session::Handle("nodeListRequest", [](const Network::Address& address, [[maybe_unused]] const std::string& data)
-		{
-			SendList(address);
-		});
+		Session::Handle("nodeListRequest", HandleRequest);
 
 		Scheduler::OnGameInitialized([]
 		{
@@ -417,10 +639,10 @@ namespace Components
 
 		Command::Add("listNodes", [](const Command::Params*)
 		{
-			Logger::Print("Nodes: {}\n", Nodes.size());
-
 			std::lock_guard _(Mutex);
-			for (const auto& node : Nodes)
+			Logger::Print("Nodes: {} (version {})\n", Nodes.entries().size(), Nodes.getVersion());
+
+			for (const auto& node : Nodes.entries())
 			{
 				Logger::Print("{}\t({})\n", node.address.getString(), node.isValid() ? "Valid" : "Invalid");
 			}
@@ -443,4 +665,154 @@ namespace Components
 		StoreNodes(true);
 		Nodes.clear();
 	}
+
+	bool Node::unitTest()
+	{
+		const auto makeAddress = [](const std::size_t i)
+		{
+			Game::netIP_t ip;
+			ip.bytes[0] = 100;
+			ip.bytes[1] = static_cast<unsigned char>(i >> 16);
+			ip.bytes[2] = static_cast<unsigned char>(i >> 8);
+			ip.bytes[3] = static_cast<unsigned char>(i);
+
+			Network::Address address;
+			address.setType(Game::NA_IP);
+			address.setIP(ip);
+			address.setPort(static_cast<unsigned short>(28960 + i % 16));
+			return address;
+		};
+
+		std::string packed;
+		Table::Pack(makeAddress(70000), packed);
+		if (packed.size() != Table::PackedSize || Table::GetKey(Table::Unpack(packed.data())) != Table::GetKey(makeAddress(70000)))
+		{
+			Logger::PrintError(Game::CON_CHANNEL_ERROR, "Packed node address does not round trip\n");
+			return false;
+		}
+
+		// A lost chunk must keep the acknowledged version below the gap
+		Entry ack;
+		Table::Acknowledge(&ack, { 0, 10, {} }, 5);
+		Table::Acknowledge(&ack, { 20, 30, {} }, 5);
+		const auto gap = ack.acknowledged;
+		Table::Acknowledge(&ack, { 10, 20, {} }, 5);
+		const auto filled = ack.acknowledged;
+		Table::Acknowledge(&ack, { 0, 3, {} }, 7);
+
+		if (gap != 10 || filled != 20 || ack.acknowledged != 3)
+		{
+			Logger::PrintError(Game::CON_CHANNEL_ERROR, "Node acknowledgement mismatch: {} / {} / {}\n", gap, filled, ack.acknowledged);
+			return false;
+		}
+
+		// Simulate peers that gossip a table of 10k nodes. Every round each peer requests the lists of all peers it knows,
+		// like RunFrame does once per NODE_HALFLIFE. The full list protocol is measured on the same exchanges
+		constexpr std::size_t peerCount = 32;
+		constexpr std::size_t nodeCount = 10000;
+		constexpr std::size_t steadyRounds = 2;
+		constexpr std::size_t maxRounds = 30;
+		constexpr std::size_t messageOverhead = 32; // Remaining proto fields and the session header
+
+		std::vector<std::unique_ptr<Table>> tables;
+		for (std::size_t i = 0; i < peerCount; ++i)
+		{
+			tables.emplace_back(std::make_unique<Table>());
+		}
+
+		const auto learn = [](Table& table, const Network::Address& address)
+		{
+			auto* entry = table.add(address);
+			if (!entry->isValid())
+			{
+				// Pretend the node answered our request right away
+				entry->lastResponse.emplace(Utils::Time::Point());
+				table.refresh(entry);
+			}
+		};
+
+		for (std::size_t i = 0; i < nodeCount; ++i)
+		{
+			learn(*tables[i % peerCount], makeAddress(i));
+		}
+
+		for (std::size_t i = 0; i < peerCount; ++i)
+		{
+			learn(*tables[i], makeAddress((i + 1) % peerCount));
+		}
+
+		std::uint64_t deltaBytes = 0, fullBytes = 0, deltaMessages = 0, fullMessages = 0;
+		std::uint64_t steadyDelta = 0, steadyFull = 0;
+		std::optional<std::size_t> converged;
+
+		for (std::size_t round = 1; round <= maxRounds; ++round)
+		{
+			std::uint64_t roundDelta = 0, roundFull = 0;
+
+			for (std::size_t p = 0; p < peerCount; ++p)
+			{
+				auto& table = *tables[p];
+
+				for (std::size_t q = 0; q < peerCount; ++q)
+				{
+					if (q == p || !table.find(makeAddress(q))) continue;
+
+					auto& source = *tables[q];
+					const auto* peer = table.find(makeAddress(q));
+					const auto since = peer->epoch == source.getEpoch() ? peer->acknowledged : 0;
+
+					std::size_t valid = 0;
+					for (const auto& entry : source.entries())
+					{
+						if (entry.isValid()) ++valid;
+					}
+
+					const auto messages = (valid + NODE_MAX_NODES_TO_SEND - 1) / NODE_MAX_NODES_TO_SEND;
+					roundFull += valid * (sizeof(sockaddr) + 2) + messages * messageOverhead;
+					fullMessages += messages;
+
+					for (const auto& chunk : source.getDelta(since))
+					{
+						roundDelta += chunk.packed.size() + messageOverhead;
+						++deltaMessages;
+
+						for (std::size_t i = 0; i + Table::PackedSize <= chunk.packed.size(); i += Table::PackedSize)
+						{
+							learn(table, Table::Unpack(chunk.packed.data() + i));
+						}
+
+						Table::Acknowledge(table.find(makeAddress(q)), chunk, source.getEpoch());
+					}
+				}
+			}
+
+			deltaBytes += roundDelta;
+			fullBytes += roundFull;
+
+			// Nodes learned in the last round still travel once more, after that only empty deltas are exchanged
+			if (converged && round == *converged + steadyRounds)
+			{
+				steadyDelta = roundDelta;
+				steadyFull = roundFull;
+				break;
+			}
+
+			if (!converged && std::all_of(tables.begin(), tables.end(), [](const std::unique_ptr<Table>& table) { return table->entries().size() == nodeCount; }))
+			{
+				converged = round;
+			}
+		}
+
+		if (!converged)
+		{
+			Logger::PrintError(Game::CON_CHANNEL_ERROR, "Node gossip did not converge within {} rounds\n", maxRounds);
+			return false;
+		}
+
+		Logger::Print("Node gossip of {} nodes between {} peers converged after {} rounds (~{} min)\n", nodeCount, peerCount, *converged, *converged * NODE_HALFLIFE / 60000);
+		Logger::Print("Delta: {} KB in {} messages, {} bytes per round once converged\n", deltaBytes / 1024, deltaMessages, steadyDelta);
+		Logger::Print("Full list: {} KB in {} messages, {} bytes per round once converged\n", fullBytes / 1024, fullMessages, steadyFull);
+
+		return deltaBytes * 4 < fullBytes && steadyDelta * 100 < steadyFull;
+	}
 }
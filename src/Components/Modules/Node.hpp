@@ -2,6 +2,7 @@
 
 #define NODE_HALFLIFE (3 * 60 * 1000) // 3min
 #define NODE_MAX_NODES_TO_SEND 64
+#define NODE_MAX_PACKED_NODES_TO_SEND 200 // 6 bytes each, keeps the message below 1404 bytes
 #define NODE_SEND_RATE 500ms
 
 namespace Components
@@ -24,6 +25,16 @@ namespace Components
 			std::optional<Utils::Time::Point> lastRequest;
 			std::optional<Utils::Time::Point> lastResponse;
 
+			// Version of our table at which this node was added or last refreshed
+			std::uint64_t version{};
+
+			// Version and epoch of this node's table that we already received
+			std::uint64_t acknowledged{};
+			std::uint32_t epoch{};
+
+			// Version of our table that we last pushed to this node
+			std::uint64_t pushed{};
+
 			[[nodiscard]] bool isValid() const;
 			[[nodiscard]] bool isDead() const;
 
@@ -33,8 +44,61 @@ namespace Components
 			void reset();
 		};
 
+		// One chunk of a delta, holds the packed nodes of the table versions (since, version]
+		struct Chunk
+		{
+			std::uint64_t since;
+			std::uint64_t version;
+			std::string packed;
+		};
+
+		// Node table where every entry remembers the version at which it was added or refreshed,
+		// so peers only exchange the entries that changed since the version they acknowledged
+		class Table
+		{
+		public:
+			Table();
+
+			[[nodiscard]] Entry* find(const Network::Address& address);
+			Entry* add(const Network::Address& address);
+			void refresh(Entry* entry);
+			void erase(std::size_t index);
+			void clear();
+
+			// Applies the version range of a received chunk to the sender's acknowledged version
+			static void Acknowledge(Entry* entry, const Chunk& chunk, std::uint32_t epoch);
+
+			[[nodiscard]] std::vector<Chunk> getDelta(std::uint64_t since);
+
+			[[nodiscard]] std::vector<Entry>& entries() { return this->entries_; }
+			[[nodiscard]] std::uint64_t getVersion() const { return this->version_; }
+			[[nodiscard]] std::uint32_t getEpoch() const { return this->epoch_; }
+
+			static std::uint64_t GetKey(const Network::Address& address);
+			static void Pack(const Network::Address& address, std::string& out);
+			static Network::Address Unpack(const char* data);
+
+			static constexpr std::size_t PackedSize = 6;
+
+		private:
+			std::vector<Entry> entries_;
+			std::unordered_map<std::uint64_t, std::size_t> index_;
+
+			std::uint64_t version_{};
+			std::uint32_t epoch_{};
+
+			// Packed valid entries ordered by version, rebuilt when the table changed
+			std::string packed_;
+			std::vector<std::uint64_t> packedVersions_;
+			std::optional<std::uint64_t> packedAt_;
+			Utils::Time::Interval packedTime_;
+
+			void updatePacked();
+		};
+
 		Node();
 		void preDestroy() override;
+		bool unitTest() override;
 
 		static void Add(const Network::Address& address);
 		static std::vector<Entry> GetNodes();
@@ -43,14 +107,18 @@ namespace Components
 
 	private:
 		static std::recursive_mutex Mutex;
-		static std::vector<Entry> Nodes;
+		static Table Nodes;
 		static bool WasIngame;
 
 		static const Game::dvar_t* net_natFix;
 
 		static void HandleResponse(const Network::Address& address, const std::string& data);
 
+		static void HandleRequest(const Network::Address& address, const std::string& data);
+
 		static void SendList(const Network::Address& address);
+		static void SendDelta(const Network::Address& address, std::uint64_t since);
+		static void SendMessages(const Network::Address& address, const std::vector<std::string>& messages);
 
 		static void LoadNodePreset();
 		static void LoadNodes();
@@ -3,6 +3,7 @@
 
 #include "Auth.hpp"
 #include "Download.hpp"
+#include "Events.hpp"
 #include "Friends.hpp"
 #include "Gamepad.hpp"
 #include "Node.hpp"
@@ -40,6 +41,8 @@ namespace Components
 
 	Dvar::Var Party::PartyEnable;
 
+	Party::ResponseCache Party::InfoCache;
+
 	SteamID Party::GenerateLobbyId()
 	{
 		SteamID id;
@@ -191,6 +194,126 @@ namespace Components
 		return PartyEnable.get<bool>();
 	}
 
+	std::string Party::BuildInfoResponse()
+	{
+		auto botCount = 0;
+		auto effectiveClientCount = 0;
+		auto maxClientCount = *Game::svs_clientCount;
+		const auto securityLevel = Dvar::Var("sv_securityLevel").get<int>();
+		const auto* password = *Game::g_password ? (*Game::g_password)->current.string : "";
+
+		if (maxClientCount)
+		{
+			for (int i = 0; i < maxClientCount; ++i)
+			{
+				if (Game::svs_clients[i].header.state < Game::CS_ACTIVE) continue;
+				if (!Game::svs_clients[i].gentity || !Game::svs_clients[i].gentity->client) continue;
+
+				const auto* client = Game::svs_clients[i].gentity->client;
+				const auto team = client->sess.cs.team;
+				if (Game::svs_clients[i].bIsTestClient || team == Game::TEAM_SPECTATOR)
+				{
+					++botCount;
+				}
+				else
+				{
+					++effectiveClientCount;
+				}
+			}
+		}
+		else
+		{
+			maxClientCount = *Game::party_maxplayers ? (*Game::party_maxplayers)->current.integer : 18;
+			effectiveClientCount = Game::PartyHost_CountMembers(Game::g_lobbyData);
+		}
+
+		Utils::InfoString info;
+		info.set("gamename", "IW4");
+		info.set("hostname", (*Game::sv_hostname)->current.string);
+		info.set("gametype", (*Game::sv_gametype)->current.string);
+		info.set("fs_game", (*Game::fs_gameDirVar)->current.string);
+		info.set("xuid", Utils::String::VA("%llX", Steam::SteamUser()->GetSteamID().bits));
+		info.set("clients", std::to_string(effectiveClientCount));
+		info.set("bots", std::to_string(botCount));
+		info.set("sv_maxclients", std::to_string(maxClientCount));
+		info.set("protocol", std::to_string(PROTOCOL));
+		info.set("version", REVISION_STR);
+		info.set("mapname", Dvar::Var("mapname").get<std::string>());
+		info.set("isPrivate", *password ? "1" : "0");
+		info.set("hc", (Dvar::Var("g_hardcore").get<bool>() ? "1" : "0"));
+		info.set("securityLevel", std::to_string(securityLevel));
+		info.set("sv_running", (Dedicated::IsRunning() ? "1" : "0"));
+		info.set("aimAssist", (Gamepad::sv_allowAimAssist.get<bool>() ? "1" : "0"));
+		info.set("voiceChat", (Voice::SV_VoiceEnabled() ? "1" : "0"));
+
+		// Ensure mapname is set
+		if (info.get("mapname").empty() || IsInLobby())
+		{
+			info.set("mapname", Dvar::Var("ui_mapname").get<const char*>());
+		}
+
+		if (Maps::GetUserMap()->isValid())
+		{
+			info.set("usermaphash", Utils::String::VA("%i", Maps::GetUserMap()->getHash()));
+		}
+		else if (IsInUserMapLobby())
+		{
+			info.set("usermaphash", Utils::String::VA("%i", Maps::GetUsermapHash(info.get("mapname"))));
+		}
+
+		if (Dedicated::IsEnabled())
+		{
+			info.set("sv_motd", Dedicated::SVMOTD.get<std::string>());
+		}
+
+		// Set matchtype
+		// 0 - No match, connecting not possible
+		// 1 - Party, use Steam_JoinLobby to connect
+		// 2 - Match, use CL_ConnectFromParty to connect
+
+		if (PartyEnable.get<bool>() && Dvar::Var("party_host").get<bool>()) // Party hosting
+		{
+			info.set("matchtype", "1");
+		}
+		else if (Dvar::Var("sv_running").get<bool>()) // Match hosting
+		{
+			info.set("matchtype", "2");
+		}
+		else
+		{
+			info.set("matchtype", "0");
+		}
+
+		info.set("wwwDownload", (Download::SV_wwwDownload.get<bool>() ? "1" : "0"));
+		info.set("wwwUrl", Download::SV_wwwBaseUrl.get<std::string>());
+
+		return info.build();
+	}
+
+	const std::string& Party::GetInfoResponse()
+	{
+		const auto* mapname = (*Game::sv_mapname)->current.string;
+		const auto* uiMapname = (*Game::ui_mapname)->current.string;
+		const auto now = std::chrono::steady_clock::now();
+
+		// Dvars are not watched individually, so a short lifetime bounds how stale the response can get
+		if (!InfoCache.valid || now - InfoCache.lastBuild >= InfoCacheLifetime || InfoCache.mapname != mapname || InfoCache.uiMapname != uiMapname)
+		{
+			InfoCache.response = BuildInfoResponse();
+			InfoCache.mapname = mapname;
+			InfoCache.uiMapname = uiMapname;
+			InfoCache.lastBuild = now;
+			InfoCache.valid = true;
+		}
+
+		return InfoCache.response;
+	}
+
+	void Party::InvalidateInfoResponse()
+	{
+		InfoCache.valid = false;
+	}
+
 	Party::Party()
 	{
 		PartyEnable = Dvar::Register<bool>("party_enable", Dedicated::IsEnabled(), Game::DVAR_NONE, "Enable party system");
@@ -342,103 +465,25 @@ namespace Components
 			}, Scheduler::Pipeline::CLIENT);
 		}
 
-		// Basic info handler
-		Network::OnClientPacket("getInfo", [](const Network::Address& address, [[maybe_unused]] const std::string& data)
+		// Client slots changed, so the player counts in the info response are outdated
+		Events::OnClientConnect([]([[maybe_unused]] Game::client_s* cl)
 		{
-			auto botCount = 0;
-			auto effectiveClientCount = 0;
-			auto maxClientCount = *Game::svs_clientCount;
-			const auto securityLevel = Dvar::Var("sv_securityLevel").get<int>();
-			const auto* password = *Game::g_password ? (*Game::g_password)->current.string : "";
-
-			if (maxClientCount)
-			{
-				for (int i = 0; i < maxClientCount; ++i)
-				{
-					if (Game::svs_clients[i].header.state < Game::CS_ACTIVE) continue;
-					if (!Game::svs_clients[i].gentity || !Game::svs_clients[i].gentity->client) continue;
-
-					const auto* client = Game::svs_clients[i].gentity->client;
-					const auto team = client->sess.cs.team;
-					if (Game::svs_clients[i].bIsTestClient || team == Game::TEAM_SPECTATOR)
-					{
-						++botCount;
-					}
-					else
-					{
-						++effectiveClientCount;
-					}
-				}
-			}
-			else
-			{
-				maxClientCount = *Game::party_maxplayers ? (*Game::party_maxplayers)->current.integer : 18;
-				effectiveClientCount = Game::PartyHost_CountMembers(Game::g_lobbyData);
-			}
-
-			Utils::InfoString info;
-			info.set("challenge", Utils::ParseChallenge(data));
-			info.set("gamename", "IW4");
-			info.set("hostname", (*Game::sv_hostname)->current.string);
-			info.set("gametype", (*Game::sv_gametype)->current.string);
-			info.set("fs_game", (*Game::fs_gameDirVar)->current.string);
-			info.set("xuid", Utils::String::VA("%llX", Steam::SteamUser()->GetSteamID().bits));
-			info.set("clients", std::to_string(effectiveClientCount));
-			info.set("bots", std::to_string(botCount));
-			info.set("sv_maxclients", std::to_string(maxClientCount));
-			info.set("protocol", std::to_string(PROTOCOL));
-			info.set("version", REVISION_STR);
-			info.set("checksum", std::to_string(Game::Sys_Milliseconds()));
-			info.set("mapname", Dvar::Var("mapname").get<std::string>());
-			info.set("isPrivate", *password ? "1" : "0");
-			info.set("hc", (Dvar::Var("g_hardcore").get<bool>() ? "1" : "0"));
-			info.set("securityLevel", std::to_string(securityLevel));
-			info.set("sv_running", (Dedicated::IsRunning() ? "1" : "0"));
-			info.set("aimAssist", (Gamepad::sv_allowAimAssist.get<bool>() ? "1" : "0"));
-			info.set("voiceChat", (Voice::SV_VoiceEnabled() ? "1" : "0"));
-
-			// Ensure mapname is set
-			if (info.get("mapname").empty() || IsInLobby())
-			{
-				info.set("mapname", Dvar::Var("ui_mapname").get<const char*>());
-			}
-
-			if (Maps::GetUserMap()->isValid())
-			{
-				info.set("usermaphash", Utils::String::VA("%i", Maps::GetUserMap()->getHash()));
-			}
-			else if (IsInUserMapLobby())
-			{
-				info.set("usermaphash", Utils::String::VA("%i", Maps::GetUsermapHash(info.get("mapname"))));
-			}
-
-			if (Dedicated::IsEnabled())
-			{
-				info.set("sv_motd", Dedicated::SVMOTD.get<std::string>());
-			}
-
-			// Set matchtype
-			// 0 - No match, connecting not possible
-			// 1 - Party, use Steam_JoinLobby to connect
-			// 2 - Match, use CL_ConnectFromParty to connect
+			InvalidateInfoResponse();
+		});
 
-			if (PartyEnable.get<bool>() && Dvar::Var("party_host").get<bool>()) // Party hosting
-			{
-				info.set("matchtype", "1");
-			}
-			else if (Dvar::Var("sv_running").get<bool>()) // Match hosting
-			{
-				info.set("matchtype", "2");
-			}
-			else
-			{
-				info.set("matchtype", "0");
-			}
+		Events::OnClientDisconnect([]([[maybe_unused]] const int clientNum)
+		{
+			InvalidateInfoResponse();
+		});
 
-			info.set("wwwDownload", (Download::SV_wwwDownload.get<bool>() ? "1" : "0"));
-			info.set("wwwUrl", Download::SV_wwwBaseUrl.get<std::string>());
+		// Basic info handler
+		Network::OnClientPacket("getInfo", [](const Network::Address& address, [[maybe_unused]] const std::string& data)
+		{
+			// Only the challenge and checksum differ between queries
+			auto response = std::format("\\challenge\\{}\\checksum\\{}", Utils::ParseChallenge(data), Game::Sys_Milliseconds());
+			response.append(GetInfoResponse());
 
-			Network::SendCommand(address, "infoResponse", info.build());
+			Network::SendCommand(address, "infoResponse", response);
 		});
 
 		Network::OnClientPacket("infoResponse", [](const Network::Address& address, [[maybe_unused]] const std::string& data)
@@ -579,4 +624,130 @@ namespace Components
 			Friends::UpdateServer(address, info.get("hostname"), info.get("mapname"));
 		});
 	}
+
+	bool Party::unitTest()
+	{
+		// Replays getInfo queries against synthetic server state, the game's dvars don't exist yet
+		constexpr auto queryCount = 100000;
+
+		const std::unordered_map<std::string, std::string> dvars =
+		{
+			{ "sv_hostname", "^2IW4x ^7Unit Test Server ^1#1" },
+			{ "g_gametype", "war" },
+			{ "fs_game", "mods/unittest" },
+			{ "mapname", "mp_rust" },
+			{ "ui_mapname", "mp_rust" },
+			{ "g_password", "" },
+			{ "g_hardcore", "0" },
+			{ "sv_securityLevel", "23" },
+			{ "sv_running", "1" },
+			{ "sv_allowAimAssist", "1" },
+			{ "sv_voice", "1" },
+			{ "party_host", "0" },
+			{ "sv_motd", "Welcome to the unit test server, have fun!" },
+			{ "sv_wwwDownload", "1" },
+			{ "sv_wwwBaseUrl", "http://iw4x.example/fastdl/" },
+		};
+
+		// Active clients, every third one a bot
+		std::array<int, 18> clients{};
+		for (std::size_t i = 0; i < clients.size(); ++i)
+		{
+			clients[i] = i < 14 ? (i % 3 ? 1 : 2) : 0;
+		}
+
+		// Mirrors BuildInfoResponse, looking every dvar up by name like Dvar::Var does
+		const auto build = [&](Utils::InfoString& info)
+		{
+			auto botCount = 0;
+			auto effectiveClientCount = 0;
+			for (const auto state : clients)
+			{
+				if (state == 2) ++botCount;
+				else if (state == 1) ++effectiveClientCount;
+			}
+
+			const auto dvar = [&](const std::string& name) { return dvars.at(name); };
+
+			info.set("gamename", "IW4");
+			info.set("hostname", dvar("sv_hostname"));
+			info.set("gametype", dvar("g_gametype"));
+			info.set("fs_game", dvar("fs_game"));
+			info.set("xuid", Utils::String::VA("%llX", 0x110000100000001ull));
+			info.set("clients", std::to_string(effectiveClientCount));
+			info.set("bots", std::to_string(botCount));
+			info.set("sv_maxclients", std::to_string(clients.size()));
+			info.set("protocol", std::to_string(PROTOCOL));
+			info.set("version", REVISION_STR);
+			info.set("mapname", dvar("mapname"));
+			info.set("isPrivate", dvar("g_password").empty() ? "0" : "1");
+			info.set("hc", dvar("g_hardcore"));
+			info.set("securityLevel", dvar("sv_securityLevel"));
+			info.set("sv_running", dvar("sv_running"));
+			info.set("aimAssist", dvar("sv_allowAimAssist"));
+			info.set("voiceChat", dvar("sv_voice"));
+			info.set("sv_motd", dvar("sv_motd"));
+			info.set("matchtype", dvar("party_host") == "1" ? "1" : (dvar("sv_running") == "1" ? "2" : "0"));
+			info.set("wwwDownload", dvar("sv_wwwDownload"));
+			info.set("wwwUrl", dvar("sv_wwwBaseUrl"));
+		};
+
+		const auto challenge = Utils::Cryptography::Rand::GenerateChallenge();
+		std::size_t rebuiltBytes = 0, cachedBytes = 0;
+
+		// How every query was answered before the response got cached
+		const auto rebuilt = Utils::Time::Measure([&]
+		{
+			for (auto i = 0; i < queryCount; ++i)
+			{
+				Utils::InfoString info;
+				info.set("challenge", challenge);
+				build(info);
+				info.set("checksum", std::to_string(i));
+
+				rebuiltBytes += info.build().size();
+			}
+		});
+
+		// The cached body is built once per lifetime, so include one build in the measurement
+		std::string body;
+		const auto cached = Utils::Time::Measure([&]
+		{
+			Utils::InfoString info;
+			build(info);
+			body = info.build();
+
+			for (auto i = 0; i < queryCount; ++i)
+			{
+				auto response = std::format("\\challenge\\{}\\checksum\\{}", challenge, i);
+				response.append(body);
+
+				cachedBytes += response.size();
+			}
+		});
+
+		Logger::Print("getInfo replay of {} queries: {} us rebuilding the info string, {} us splicing the cached response\n", queryCount, rebuilt.count(), cached.count());
+
+		// Both paths have to answer with the same keys and values
+		Utils::InfoString expected;
+		expected.set("challenge", challenge);
+		build(expected);
+		expected.set("checksum", "42");
+
+		const Utils::InfoString spliced(std::format("\\challenge\\{}\\checksum\\{}", challenge, 42) + body);
+
+		if (expected.to_json() != spliced.to_json() || rebuiltBytes != cachedBytes)
+		{
+			Logger::PrintError(Game::CON_CHANNEL_ERROR, "Cached getInfo response differs from a rebuilt one\n");
+			return false;
+		}
+
+		if (cached >= rebuilt)
+		{
+			Logger::PrintError(Game::CON_CHANNEL_ERROR, "Cached getInfo response was not faster than rebuilding it\n");
+			return false;
+		}
+
+		return true;
+	}
 }
@@ -7,6 +7,8 @@ namespace Components
 	public:
 		Party();
 
+		bool unitTest() override;
+
 		static Network::Address Target();
 		static void Connect(Network::Address target);
 		static const char* GetLobbyInfo(SteamID lobby, const std::string& key);
@@ -27,11 +29,28 @@ namespace Components
 		static std::string GetHostName();
 		static int GetMaxClients();
 
+		static void InvalidateInfoResponse();
+
 	private:
 		static std::map<std::uint64_t, Network::Address> LobbyMap;
 
 		static Dvar::Var PartyEnable;
 
+		struct ResponseCache
+		{
+			std::string response;
+			std::string mapname;
+			std::string uiMapname;
+			std::chrono::steady_clock::time_point lastBuild;
+			bool valid;
+		};
+
+		static constexpr auto InfoCacheLifetime = 1s;
+		static ResponseCache InfoCache;
+
+		static std::string BuildInfoResponse();
+		static const std::string& GetInfoResponse();
+
 		static SteamID GenerateLobbyId();
 
 		static DWORD UIDvarIntStub(char* dvar);
@@ -8,6 +8,33 @@ namespace Components
 	std::thread Scheduler::Thread;
 	volatile bool Scheduler::Kill = false;
 	Scheduler::TaskPipeline Scheduler::Pipelines[static_cast<std::underlying_type_t<Pipeline>>(Pipeline::COUNT)];
+	Scheduler::LatencyHistogram Scheduler::Latencies[static_cast<std::underlying_type_t<Pipeline>>(Pipeline::COUNT)];
+
+	std::chrono::steady_clock::time_point Scheduler::Epoch = std::chrono::steady_clock::now();
+	std::mutex Scheduler::TimerMutex;
+	std::condition_variable Scheduler::TimerWake;
+	Scheduler::TimerWheel Scheduler::Timers;
+	Scheduler::WorkerPool Scheduler::Workers;
+	Scheduler::SerialQueue Scheduler::AsyncQueue;
+
+	void Scheduler::LatencyHistogram::record(const std::chrono::nanoseconds latency)
+	{
+		const auto ms = static_cast<std::uint64_t>(std::max<std::int64_t>(0, std::chrono::duration_cast<std::chrono::milliseconds>(latency).count()));
+		const auto bucket = std::min<std::size_t>(std::bit_width(ms), Buckets - 1);
+		++this->buckets_[bucket];
+	}
+
+	std::string Scheduler::LatencyHistogram::toString() const
+	{
+		std::string result;
+		for (std::size_t i = 0; i < Buckets; ++i)
+		{
+			if (i == Buckets - 1) result.append(std::format(">={}ms: {}", 1 << (i - 1), this->buckets_[i].load()));
+			else result.append(std::format("<{}ms: {}  ", 1 << i, this->buckets_[i].load()));
+		}
+
+		return result;
+	}
 
 	void Scheduler::TaskPipeline::add(Task&& task)
 	{
@@ -17,34 +44,39 @@ namespace Components
 		});
 	}
 
-	void Scheduler::TaskPipeline::execute()
+	void Scheduler::TaskPipeline::execute(LatencyHistogram& latency)
 	{
 		callbacks_.access([&](taskList& tasks)
 		{
 			this->mergeCallbacks();
 
-			for (auto i = tasks.begin(); i != tasks.end();)
+			// Read the clock once per pass and drop finished tasks in one go afterwards
+			const auto now = std::chrono::high_resolution_clock::now();
+			auto finished = false;
+
+			for (std::size_t i = 0; i < tasks.size(); ++i)
 			{
-				const auto now = std::chrono::high_resolution_clock::now();
-				const auto diff = now - i->lastCall;
+				auto& task = tasks[i];
 
-				if (diff < i->interval)
-				{
-					++i;
-					continue;
-				}
+				const auto due = task.lastCall + task.interval;
+				if (task.finished || now < due) continue;
 
-				i->lastCall = now;
+				latency.record(now - due);
+				task.lastCall = now;
 
-				const auto res = i->handler();
-				if (res == COND_END)
+				if (task.handler() == COND_END)
 				{
-					i = tasks.erase(i);
+					tasks[i].finished = true;
+					finished = true;
 				}
-				else
+			}
+
+			if (finished)
+			{
+				std::erase_if(tasks, [](const Task& task)
 				{
-					++i;
-				}
+					return task.finished;
+				});
 			}
 		});
 	}
@@ -61,11 +93,336 @@ namespace Components
 		});
 	}
 
+	void Scheduler::TimerWheel::add(Timer&& timer)
+	{
+		timer.due = std::max(timer.due, this->tick_);
+		++this->count_;
+		this->place(std::move(timer));
+	}
+
+	void Scheduler::TimerWheel::place(Timer&& timer)
+	{
+		const auto delta = timer.due - this->tick_;
+		if (delta < Level0Size)
+		{
+			this->level0_[timer.due & (Level0Size - 1)].emplace_back(std::move(timer));
+			return;
+		}
+
+		for (std::size_t level = 0; level < Levels; ++level)
+		{
+			const auto shift = Level0Bits + LevelBits * level;
+			const auto range = std::uint64_t(1) << (shift + LevelBits);
+
+			if (delta < range || level == Levels - 1)
+			{
+				// Timers beyond the last level wait in its farthest slot and get placed again once it cascades
+				const auto due = std::min(timer.due, this->tick_ + range - 1);
+				this->levels_[level][(due >> shift) & (LevelSize - 1)].emplace_back(std::move(timer));
+				return;
+			}
+		}
+	}
+
+	void Scheduler::TimerWheel::cascade(const std::size_t level, const std::size_t slot)
+	{
+		auto timers = std::move(this->levels_[level][slot]);
+		this->levels_[level][slot] = {};
+
+		for (auto& timer : timers)
+		{
+			this->place(std::move(timer));
+		}
+	}
+
+	void Scheduler::TimerWheel::advance(const std::uint64_t tick, std::vector<Timer>& expired)
+	{
+		if (!this->count_)
+		{
+			this->tick_ = std::max(this->tick_, tick + 1);
+			return;
+		}
+
+		while (this->tick_ <= tick)
+		{
+			// Whenever the first level wraps, pull the next slot of the upper levels down
+			if (!(this->tick_ & (Level0Size - 1)))
+			{
+				for (std::size_t level = 0; level < Levels; ++level)
+				{
+					const auto slot = (this->tick_ >> (Level0Bits + LevelBits * level)) & (LevelSize - 1);
+					this->cascade(level, slot);
+
+					if (slot) break;
+				}
+			}
+
+			auto& timers = this->level0_[this->tick_ & (Level0Size - 1)];
+			for (auto& timer : timers)
+			{
+				expired.emplace_back(std::move(timer));
+			}
+
+			this->count_ -= timers.size();
+			timers.clear();
+
+			++this->tick_;
+		}
+	}
+
+	std::optional<std::uint64_t> Scheduler::TimerWheel::nextWake() const
+	{
+		if (!this->count_) return {};
+
+		// The upper levels still have to cascade into this tick
+		if (!(this->tick_ & (Level0Size - 1))) return this->tick_;
+
+		const auto boundary = (this->tick_ | (Level0Size - 1)) + 1;
+		for (auto tick = this->tick_; tick < boundary; ++tick)
+		{
+			if (!this->level0_[tick & (Level0Size - 1)].empty())
+			{
+				return tick;
+			}
+		}
+
+		return boundary;
+	}
+
+	thread_local std::size_t Scheduler::WorkerPool::CurrentWorker = std::numeric_limits<std::size_t>::max();
+
+	void Scheduler::WorkerPool::start(const std::size_t count)
+	{
+		this->stop_ = false;
+
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			this->workers_.emplace_back(std::make_unique<Worker>());
+		}
+
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			this->workers_[i]->thread = Utils::Thread::CreateNamedThread(std::format("Async Worker {}", i), [this, i]
+			{
+				this->run(i);
+			});
+		}
+	}
+
+	void Scheduler::WorkerPool::stop()
+	{
+		{
+			std::lock_guard _(this->sleepMutex_);
+			this->stop_ = true;
+		}
+
+		this->wake_.notify_all();
+
+		for (const auto& worker : this->workers_)
+		{
+			if (worker->thread.joinable())
+			{
+				worker->thread.join();
+			}
+		}
+
+		this->workers_.clear();
+	}
+
+	void Scheduler::WorkerPool::submit(std::function<void()>&& job)
+	{
+		if (this->workers_.empty()) return;
+
+		// Jobs spawned by a worker stay with it, the others get spread across the pool
+		const auto index = CurrentWorker < this->workers_.size() ? CurrentWorker : this->next_++ % this->workers_.size();
+
+		{
+			auto& worker = *this->workers_[index];
+			std::lock_guard _(worker.mutex);
+			worker.jobs.emplace_back(std::move(job));
+		}
+
+		++this->queued_;
+
+		{
+			std::lock_guard _(this->sleepMutex_);
+		}
+
+		this->wake_.notify_one();
+	}
+
+	bool Scheduler::WorkerPool::pop(const std::size_t index, std::function<void()>& job)
+	{
+		{
+			auto& worker = *this->workers_[index];
+			std::lock_guard _(worker.mutex);
+
+			if (!worker.jobs.empty())
+			{
+				job = std::move(worker.jobs.back());
+				worker.jobs.pop_back();
+				--this->queued_;
+				return true;
+			}
+		}
+
+		// Steal the oldest job of another worker
+		for (std::size_t i = 1; i < this->workers_.size(); ++i)
+		{
+			auto& victim = *this->workers_[(index + i) % this->workers_.size()];
+			std::lock_guard _(victim.mutex);
+
+			if (!victim.jobs.empty())
+			{
+				job = std::move(victim.jobs.front());
+				victim.jobs.pop_front();
+				--this->queued_;
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	void Scheduler::WorkerPool::run(const std::size_t index)
+	{
+		CurrentWorker = index;
+
+		std::function<void()> job;
+		while (true)
+		{
+			if (this->pop(index, job))
+			{
+				job();
+				job = nullptr;
+				continue;
+			}
+
+			std::unique_lock lock(this->sleepMutex_);
+			this->wake_.wait(lock, [this]
+			{
+				return this->stop_ || this->queued_ > 0;
+			});
+
+			if (this->stop_) return;
+		}
+	}
+
+	void Scheduler::SerialQueue::submit(WorkerPool& pool, std::function<void()>&& job)
+	{
+		std::lock_guard _(this->mutex_);
+		this->jobs_.emplace_back(std::move(job));
+
+		if (!this->running_)
+		{
+			this->running_ = true;
+			pool.submit([this]
+			{
+				this->run();
+			});
+		}
+	}
+
+	void Scheduler::SerialQueue::run()
+	{
+		std::function<void()> job;
+		while (true)
+		{
+			{
+				std::lock_guard _(this->mutex_);
+				if (this->jobs_.empty())
+				{
+					this->running_ = false;
+					return;
+				}
+
+				job = std::move(this->jobs_.front());
+				this->jobs_.pop_front();
+			}
+
+			job();
+			job = nullptr;
+		}
+	}
+
 	void Scheduler::Execute(Pipeline type)
 	{
 		assert(type < Pipeline::COUNT);
 		const auto index = static_cast<std::underlying_type_t<Pipeline>>(type);
-		Pipelines[index].execute();
+		Pipelines[index].execute(Latencies[index]);
+	}
+
+	std::uint64_t Scheduler::GetTick()
+	{
+		return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - Epoch).count());
+	}
+
+	void Scheduler::AddTimer(Task&& task, const Pipeline type, const std::chrono::steady_clock::time_point due)
+	{
+		// Round up, a timer must never fire early
+		const auto delay = std::max(due - Epoch, std::chrono::steady_clock::duration::zero());
+		const auto tick = static_cast<std::uint64_t>(std::chrono::ceil<std::chrono::milliseconds>(delay).count());
+
+		{
+			std::lock_guard _(TimerMutex);
+			Timers.add({ tick, type, std::move(task) });
+		}
+
+		TimerWake.notify_one();
+	}
+
+	void Scheduler::RunTimer(TimerWheel::Timer& timer)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		Latencies[static_cast<std::underlying_type_t<Pipeline>>(timer.type)].record(start - (Epoch + std::chrono::milliseconds(timer.due)));
+
+		// Looping tasks are armed again once they are done, so they never overlap with themselves
+		if (timer.task.handler() == COND_CONTINUE && !Kill)
+		{
+			const auto interval = std::max<std::chrono::milliseconds>(timer.task.interval, MinLoopInterval);
+			AddTimer(std::move(timer.task), timer.type, start + interval);
+		}
+	}
+
+	void Scheduler::TimerThread()
+	{
+		std::vector<TimerWheel::Timer> expired;
+		std::unique_lock lock(TimerMutex);
+
+		while (!Kill)
+		{
+			Timers.advance(GetTick(), expired);
+
+			if (!expired.empty())
+			{
+				lock.unlock();
+
+				for (auto& timer : expired)
+				{
+					const auto type = timer.type;
+					auto job = [timer = std::move(timer)]() mutable
+					{
+						RunTimer(timer);
+					};
+
+					if (type == Pipeline::ASYNC) AsyncQueue.submit(Workers, std::move(job));
+					else Workers.submit(std::move(job));
+				}
+
+				expired.clear();
+				lock.lock();
+				continue;
+			}
+
+			if (const auto wake = Timers.nextWake())
+			{
+				TimerWake.wait_until(lock, Epoch + std::chrono::milliseconds(*wake));
+			}
+			else
+			{
+				TimerWake.wait(lock);
+			}
+		}
 	}
 
 	void Scheduler::ScrPlace_EndFrame_Hk()
@@ -108,6 +465,12 @@ namespace Components
 		task.interval = delay;
 		task.lastCall = std::chrono::high_resolution_clock::now();
 
+		if (type == Pipeline::ASYNC || type == Pipeline::WORKER)
+		{
+			AddTimer(std::move(task), type, std::chrono::steady_clock::now() + delay);
+			return;
+		}
+
 		const auto index = static_cast<std::underlying_type_t<Pipeline>>(type);
 		Pipelines[index].add(std::move(task));
 	}
@@ -156,14 +519,29 @@ namespace Components
 		}, Pipeline::QUIT, 0ms);
 	}
 
+	void Scheduler::Async(const std::function<void()>& work, const std::function<void()>& callback, const Pipeline type)
+	{
+		Once([=]
+		{
+			work();
+			Once(callback, type);
+		}, Pipeline::ASYNC);
+	}
+
 	Scheduler::Scheduler()
 	{
-		Thread = Utils::Thread::CreateNamedThread("Async Scheduler", []
+		// A slow WORKER job (disk or network) only occupies one worker instead of stalling every other background task
+		Workers.start(std::clamp<std::size_t>(std::thread::hardware_concurrency() / 2, 2, 8));
+		Thread = Utils::Thread::CreateNamedThread("Async Scheduler", TimerThread);
+
+		Command::Add("schedulerStats", []
 		{
-			while (!Kill)
+			static const char* names[] = { "ASYNC", "RENDERER", "SERVER", "CLIENT", "MAIN", "QUIT", "WORKER" };
+			static_assert(std::extent_v<decltype(names)> == static_cast<std::size_t>(Pipeline::COUNT));
+
+			for (std::size_t i = 0; i < std::extent_v<decltype(names)>; ++i)
 			{
-				Execute(Pipeline::ASYNC);
-				std::this_thread::sleep_for(10ms);
+				Logger::Print("{}: {}\n", names[i], Latencies[i].toString());
 			}
 		});
 
@@ -184,10 +562,83 @@ namespace Components
 
 	void Scheduler::preDestroy()
 	{
-		Kill = true;
+		{
+			std::lock_guard _(TimerMutex);
+			Kill = true;
+		}
+
+		TimerWake.notify_all();
+
 		if (Thread.joinable())
 		{
 			Thread.join();
 		}
+
+		Workers.stop();
+	}
+
+	bool Scheduler::unitTest()
+	{
+		// Static, so late tasks can't touch a dead stack frame if the test times out
+		static std::chrono::steady_clock::time_point start;
+		static std::atomic<std::int64_t> shortDelay, longDelay, blocked;
+		static std::atomic<int> serialRunning, serialDone;
+		static std::atomic<bool> serialOverlap, serialOrder;
+
+		constexpr auto serialCount = 16;
+
+		start = std::chrono::steady_clock::now();
+		shortDelay = longDelay = blocked = -1;
+		serialRunning = serialDone = 0;
+		serialOverlap = false;
+		serialOrder = true;
+
+		const auto elapsed = []
+		{
+			return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+		};
+
+		// A slow WORKER job must not hold back the others, and delays below the old 10ms pass have to work
+		Once([=] { std::this_thread::sleep_for(300ms); blocked = elapsed(); }, Pipeline::WORKER);
+		Once([=] { shortDelay = elapsed(); }, Pipeline::WORKER, 3ms);
+		Once([=] { longDelay = elapsed(); }, Pipeline::ASYNC, 600ms); // Goes through a cascade of the wheel
+
+		// ASYNC jobs still run one at a time and in order
+		for (auto i = 0; i < serialCount; ++i)
+		{
+			Once([i]
+			{
+				if (++serialRunning > 1) serialOverlap = true;
+				if (serialDone != i) serialOrder = false;
+
+				std::this_thread::sleep_for(2ms);
+
+				--serialRunning;
+				++serialDone;
+			}, Pipeline::ASYNC);
+		}
+
+		while ((blocked < 0 || shortDelay < 0 || longDelay < 0 || serialDone < serialCount) && std::chrono::steady_clock::now() - start < 3s)
+		{
+			std::this_thread::sleep_for(1ms);
+		}
+
+		Logger::Print("WORKER: 3ms task after {}ms, slow task done after {}ms. ASYNC: 600ms task after {}ms, {} serial tasks done\n", shortDelay.load(), blocked.load(), longDelay.load(), serialDone.load());
+		Logger::Print("ASYNC latency: {}\n", Latencies[static_cast<std::underlying_type_t<Pipeline>>(Pipeline::ASYNC)].toString());
+		Logger::Print("WORKER latency: {}\n", Latencies[static_cast<std::underlying_type_t<Pipeline>>(Pipeline::WORKER)].toString());
+
+		if (shortDelay < 3 || shortDelay >= 100 || longDelay < 600 || longDelay >= 900 || blocked < 300)
+		{
+			Logger::PrintError(Game::CON_CHANNEL_ERROR, "Background pipeline timings are off\n");
+			return false;
+		}
+
+		if (serialDone != serialCount || serialOverlap || !serialOrder)
+		{
+			Logger::PrintError(Game::CON_CHANNEL_ERROR, "ASYNC tasks did not run one after another\n");
+			return false;
+		}
+
+		return true;
 	}
 }
@@ -7,18 +7,20 @@ namespace Components
 	public:
 		enum class Pipeline : int
 		{
-			ASYNC,
+			ASYNC, // Background tasks, run one after another
 			RENDERER,
 			SERVER,
 			CLIENT,
 			MAIN,
 			QUIT,
+			WORKER, // Background tasks that run at the same time on the worker pool, they must not rely on each other's order
 			COUNT,
 		};
 
 		Scheduler();
 
 		void preDestroy() override;
+		bool unitTest() override;
 
 		static void Schedule(const std::function<bool()>& callback, Pipeline type,
 			std::chrono::milliseconds delay = 0ms);
@@ -30,21 +32,51 @@ namespace Components
 			std::chrono::milliseconds delay = 0ms);
 		static void OnGameShutdown(const std::function<void()>& callback);
 
+		// Runs work on the ASYNC workers, then runs callback on the given pipeline
+		static void Async(const std::function<void()>& work, const std::function<void()>& callback, Pipeline type = Pipeline::MAIN);
+
+		template <typename T>
+		static void Async(const std::function<T()>& work, const std::function<void(T)>& callback, Pipeline type = Pipeline::MAIN)
+		{
+			Once([=]
+			{
+				auto result = std::make_shared<T>(work());
+				Once([callback, result]
+				{
+					callback(std::move(*result));
+				}, type);
+			}, Pipeline::ASYNC);
+		}
+
 	private:
 		struct Task
 		{
 			std::function<bool()> handler{};
 			std::chrono::milliseconds interval{};
 			std::chrono::high_resolution_clock::time_point lastCall{};
+			bool finished{};
 		};
 
 		using taskList = std::vector<Task>;
 
+		// Counts how late tasks ran, bucket i holds tasks that were less than 2^i ms late
+		class LatencyHistogram
+		{
+		public:
+			static constexpr std::size_t Buckets = 12;
+
+			void record(std::chrono::nanoseconds latency);
+			[[nodiscard]] std::string toString() const;
+
+		private:
+			std::atomic<std::uint64_t> buckets_[Buckets]{};
+		};
+
 		class TaskPipeline
 		{
 		public:
 			void add(Task&& task);
-			void execute();
+			void execute(LatencyHistogram& latency);
 
 		private:
 			Utils::Concurrency::Container<taskList> newCallbacks_;
@@ -53,12 +85,105 @@ namespace Components
 			void mergeCallbacks();
 		};
 
+		// Hierarchical timer wheel with 1ms ticks for delayed and looping ASYNC tasks
+		class TimerWheel
+		{
+		public:
+			struct Timer
+			{
+				std::uint64_t due;
+				Pipeline type;
+				Task task;
+			};
+
+			void add(Timer&& timer);
+			void advance(std::uint64_t tick, std::vector<Timer>& expired);
+
+			// Tick at which advance has to be called next, nothing if there are no timers
+			[[nodiscard]] std::optional<std::uint64_t> nextWake() const;
+
+		private:
+			static constexpr std::size_t Level0Bits = 8;
+			static constexpr std::size_t Level0Size = 1 << Level0Bits;
+			static constexpr std::size_t LevelBits = 6;
+			static constexpr std::size_t LevelSize = 1 << LevelBits;
+			static constexpr std::size_t Levels = 3;
+
+			std::vector<Timer> level0_[Level0Size];
+			std::vector<Timer> levels_[Levels][LevelSize];
+
+			std::uint64_t tick_{};
+			std::size_t count_{};
+
+			void place(Timer&& timer);
+			void cascade(std::size_t level, std::size_t slot);
+		};
+
+		// Work stealing thread pool that runs the ASYNC and WORKER tasks
+		class WorkerPool
+		{
+		public:
+			void start(std::size_t count);
+			void stop();
+			void submit(std::function<void()>&& job);
+
+		private:
+			struct Worker
+			{
+				std::mutex mutex;
+				std::deque<std::function<void()>> jobs;
+				std::thread thread;
+			};
+
+			std::vector<std::unique_ptr<Worker>> workers_;
+			std::atomic<std::size_t> next_{};
+			std::atomic<std::size_t> queued_{};
+			bool stop_{};
+
+			std::mutex sleepMutex_;
+			std::condition_variable wake_;
+
+			static thread_local std::size_t CurrentWorker;
+
+			bool pop(std::size_t index, std::function<void()>& job);
+			void run(std::size_t index);
+		};
+
+		// Runs its jobs on the pool one at a time and in the order they were queued
+		class SerialQueue
+		{
+		public:
+			void submit(WorkerPool& pool, std::function<void()>&& job);
+
+		private:
+			std::mutex mutex_;
+			std::deque<std::function<void()>> jobs_;
+			bool running_{};
+
+			void run();
+		};
+
+		static constexpr auto MinLoopInterval = 1ms;
+
 		static volatile bool Kill;
 		static std::thread Thread;
 		static TaskPipeline Pipelines[];
+		static LatencyHistogram Latencies[];
+
+		static std::chrono::steady_clock::time_point Epoch;
+		static std::mutex TimerMutex;
+		static std::condition_variable TimerWake;
+		static TimerWheel Timers;
+		static WorkerPool Workers;
+		static SerialQueue AsyncQueue;
 
 		static void Execute(Pipeline type);
 
+		static std::uint64_t GetTick();
+		static void AddTimer(Task&& task, Pipeline type, std::chrono::steady_clock::time_point due);
+		static void RunTimer(TimerWheel::Timer& timer);
+		static void TimerThread();
+
 		static void ScrPlace_EndFrame_Hk();
 		static void ServerFrame_Hk();
 		static void ClientFrame_Hk(int localClientNum);
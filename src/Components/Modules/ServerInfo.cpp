@@ -1,6 +1,7 @@
 #include <STDInclude.hpp>
 #include <Utils/InfoString.hpp>
 
+#include "Events.hpp"
 #include "Friends.hpp"
 #include "Gamepad.hpp"
 #include "Party.hpp"
@@ -14,6 +15,7 @@
 namespace Components
 {
 	ServerInfo::Container ServerInfo::PlayerContainer;
+	ServerInfo::ResponseCache ServerInfo::StatusCache;
 
 	unsigned int ServerInfo::GetPlayerCount()
 	{
@@ -184,6 +186,72 @@ namespace Components
 		return info;
 	}
 
+	std::string ServerInfo::BuildStatusResponse()
+	{
+		std::string playerList;
+
+		Utils::InfoString info = GetInfo();
+		info.remove("checksum");
+
+		for (std::size_t i = 0; i < Game::MAX_CLIENTS; ++i)
+		{
+			auto score = 0;
+			auto ping = 0;
+			std::string name;
+
+			if (Dedicated::IsRunning())
+			{
+				if (Game::svs_clients[i].header.state < Game::CS_ACTIVE) continue;
+				if (!Game::svs_clients[i].gentity || !Game::svs_clients[i].gentity->client) continue;
+
+				const auto* client = Game::svs_clients[i].gentity->client;
+				const auto team = client->sess.cs.team;
+				if (Game::svs_clients[i].bIsTestClient || team == Game::TEAM_SPECTATOR)
+				{
+					continue;
+				}
+
+				score = Game::SV_GameClientNum_Score(static_cast<int>(i));
+				ping = Game::svs_clients[i].ping;
+				name = Game::svs_clients[i].name;
+			}
+			else
+			{
+				// Score and ping are irrelevant
+				const auto* namePtr = Game::PartyHost_GetMemberName(reinterpret_cast<Game::PartyData*>(0x1081C00), i);
+				if (!namePtr || !*namePtr) continue;
+
+				name = namePtr;
+			}
+
+			playerList.append(std::format("{} {} \"{}\"\n", score, ping, name));
+		}
+
+		return info.build() + "\n"s + playerList + "\n"s;
+	}
+
+	const std::string& ServerInfo::GetStatusResponse()
+	{
+		const auto* mapname = (*Game::sv_mapname)->current.string;
+		const auto now = std::chrono::steady_clock::now();
+
+		// Scores and pings change all the time, the lifetime decides how fresh they are
+		if (!StatusCache.valid || now - StatusCache.lastBuild >= StatusCacheLifetime || StatusCache.mapname != mapname)
+		{
+			StatusCache.response = BuildStatusResponse();
+			StatusCache.mapname = mapname;
+			StatusCache.lastBuild = now;
+			StatusCache.valid = true;
+		}
+
+		return StatusCache.response;
+	}
+
+	void ServerInfo::InvalidateStatusResponse()
+	{
+		StatusCache.valid = false;
+	}
+
 	ServerInfo::ServerInfo()
 	{
 		PlayerContainer.currentPlayer = 0;
@@ -197,51 +265,27 @@ namespace Components
 		// Add uiscript
 		UIScript::Add("ServerStatus", ServerStatus);
 
+		// Client slots changed, so the player list in the status response is outdated
+		Events::OnClientConnect([]([[maybe_unused]] Game::client_s* cl)
+		{
+			InvalidateStatusResponse();
+		});
+
+		Events::OnClientDisconnect([]([[maybe_unused]] const int clientNum)
+		{
+			InvalidateStatusResponse();
+		});
+
 		// Add uifeeder
 		UIFeeder::Add(13.0f, GetPlayerCount, GetPlayerText, SelectPlayer);
 
 		Network::OnClientPacket("getStatus", [](const Network::Address& address, [[maybe_unused]] const std::string& data)
 		{
-			std::string playerList;
-
-			Utils::InfoString info = GetInfo();
-			info.set("challenge", Utils::ParseChallenge(data));
-
-			for (std::size_t i = 0; i < Game::MAX_CLIENTS; ++i)
-			{
-				auto score = 0;
-				auto ping = 0;
-				std::string name;
-
-				if (Dedicated::IsRunning())
-				{
-					if (Game::svs_clients[i].header.state < Game::CS_ACTIVE) continue;
-					if (!Game::svs_clients[i].gentity || !Game::svs_clients[i].gentity->client) continue;
-
-					const auto* client = Game::svs_clients[i].gentity->client;
-					const auto team = client->sess.cs.team;
-					if (Game::svs_clients[i].bIsTestClient || team == Game::TEAM_SPECTATOR)
-					{
-						continue;
-					}
-
-					score = Game::SV_GameClientNum_Score(static_cast<int>(i));
-					ping = Game::svs_clients[i].ping;
-					name = Game::svs_clients[i].name;
-				}
-				else
-				{
-					// Score and ping are irrelevant
-					const auto* namePtr = Game::PartyHost_GetMemberName(reinterpret_cast<Game::PartyData*>(0x1081C00), i);
-					if (!namePtr || !*namePtr) continue;
-
-					name = namePtr;
-				}
-
-				playerList.append(std::format("{} {} \"{}\"\n", score, ping, name));
-			}
+			// Only the challenge and checksum differ between queries
+			auto response = std::format("\\challenge\\{}\\checksum\\{:X}", Utils::ParseChallenge(data), Utils::Cryptography::JenkinsOneAtATime::Compute(std::to_string(Game::Sys_Milliseconds())));
+			response.append(GetStatusResponse());
 
-			Network::SendCommand(address, "statusResponse", info.build() + "\n"s + playerList + "\n"s);
+			Network::SendCommand(address, "statusResponse", response);
 		});
 
 		Network::OnClientPacket("statusResponse", [](const Network::Address& address, [[maybe_unused]] const std::string& data)
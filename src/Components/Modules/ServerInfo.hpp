@@ -11,6 +11,8 @@ namespace Components
 		static Utils::InfoString GetHostInfo();
 		static Utils::InfoString GetInfo();
 
+		static void InvalidateStatusResponse();
+
 	private:
 		class Container
 		{
@@ -30,6 +32,20 @@ namespace Components
 
 		static Container PlayerContainer;
 
+		struct ResponseCache
+		{
+			std::string response;
+			std::string mapname;
+			std::chrono::steady_clock::time_point lastBuild;
+			bool valid;
+		};
+
+		static constexpr auto StatusCacheLifetime = 1s;
+		static ResponseCache StatusCache;
+
+		static std::string BuildStatusResponse();
+		static const std::string& GetStatusResponse();
+
 		static void ServerStatus([[maybe_unused]] const UIScript::Token& token, [[maybe_unused]] const Game::uiInfo_s* info);
 
 		static unsigned int GetPlayerCount();
@@ -21,12 +21,18 @@ namespace Components
 
 	unsigned int ServerList::CurrentServer = 0;
 	ServerList::Container ServerList::RefreshContainer;
+	ServerList::QueryPacer ServerList::Pacer;
 
 	std::vector<ServerList::ServerInfo> ServerList::OnlineList;
 	std::vector<ServerList::ServerInfo> ServerList::OfflineList;
 	std::vector<ServerList::ServerInfo> ServerList::FavouriteList;
 
+	ServerList::ServerIndex ServerList::OnlineIndex;
+	ServerList::ServerIndex ServerList::OfflineIndex;
+	ServerList::ServerIndex ServerList::FavouriteIndex;
+
 	std::vector<unsigned int> ServerList::VisibleList;
+	bool ServerList::VisibleListSorted = true;
 
 	bool ServerList::UseMasterServer = false;
 
@@ -34,6 +40,148 @@ namespace Components
 	Dvar::Var ServerList::UIServerSelectedMap;
 	Dvar::Var ServerList::NETServerQueryLimit;
 	Dvar::Var ServerList::NETServerFrames;
+	Dvar::Var ServerList::NETServerQueryMaxRate;
+
+	ServerList::QueryPacer::QueryPacer()
+	{
+		this->reset(30.0, 30.0, 30.0, Clock::now());
+	}
+
+	void ServerList::QueryPacer::reset(const double rate, const double minRate, const double maxRate, const Clock::time_point now)
+	{
+		this->minRate = minRate;
+		this->maxRate = std::max(minRate, maxRate);
+		this->rate = std::clamp(rate, this->minRate, this->maxRate);
+		this->tokens = 1.0;
+
+		this->lastRefill = now;
+		this->windowStart = now;
+		this->windowReceived = 0;
+		this->windowExpired = 0;
+
+		this->sent = 0;
+		this->received = 0;
+		this->expired = 0;
+		this->responseRate = 1.0;
+
+		this->hasRtt = false;
+		this->srtt = 0.0;
+		this->rttvar = 0.0;
+	}
+
+	std::size_t ServerList::QueryPacer::acquire(const Clock::time_point now)
+	{
+		this->adjust(now);
+
+		const std::chrono::duration<double> elapsed = now - this->lastRefill;
+		this->lastRefill = now;
+
+		// Allow bursts of up to 50ms worth of queries, more would distort the measured pings
+		const auto burst = std::max(1.0, this->rate * 0.05);
+		this->tokens = std::min(burst, this->tokens + elapsed.count() * this->rate);
+
+		return static_cast<std::size_t>(this->tokens);
+	}
+
+	void ServerList::QueryPacer::onSent([[maybe_unused]] const Clock::time_point now)
+	{
+		this->tokens = std::max(0.0, this->tokens - 1.0);
+		++this->sent;
+	}
+
+	void ServerList::QueryPacer::onResponse([[maybe_unused]] const Clock::time_point now)
+	{
+		++this->received;
+		++this->windowReceived;
+	}
+
+	void ServerList::QueryPacer::onResponse(const std::chrono::milliseconds rtt, const Clock::time_point now)
+	{
+		this->onResponse(now);
+
+		// Smoothed round trip time as in RFC 6298
+		const auto sample = static_cast<double>(rtt.count());
+		if (!this->hasRtt)
+		{
+			this->hasRtt = true;
+			this->srtt = sample;
+			this->rttvar = sample / 2.0;
+		}
+		else
+		{
+			this->rttvar = 0.75 * this->rttvar + 0.25 * std::abs(this->srtt - sample);
+			this->srtt = 0.875 * this->srtt + 0.125 * sample;
+		}
+	}
+
+	void ServerList::QueryPacer::onTimeout([[maybe_unused]] const Clock::time_point now)
+	{
+		++this->expired;
+		++this->windowExpired;
+	}
+
+	std::chrono::milliseconds ServerList::QueryPacer::getTimeout(const int knownPing) const
+	{
+		std::chrono::milliseconds timeout = InitialTimeout;
+
+		if (knownPing >= 0)
+		{
+			timeout = std::chrono::milliseconds(knownPing * 2) + 200ms;
+		}
+		else if (this->hasRtt)
+		{
+			timeout = std::chrono::milliseconds(static_cast<std::int64_t>(this->srtt + 4.0 * this->rttvar)) + 100ms;
+		}
+
+		return std::clamp(timeout, std::chrono::milliseconds(MinTimeout), std::chrono::milliseconds(MaxTimeout));
+	}
+
+	void ServerList::QueryPacer::adjust(const Clock::time_point now)
+	{
+		if (now - this->windowStart < Window) return;
+		this->windowStart = now;
+
+		const auto outcomes = this->windowReceived + this->windowExpired;
+		if (outcomes < 4) return;
+
+		const auto ratio = static_cast<double>(this->windowReceived) / outcomes;
+		this->responseRate = ratio;
+
+		this->windowReceived = 0;
+		this->windowExpired = 0;
+
+		if (ratio < 0.9)
+		{
+			// Queries are getting lost, back off
+			this->rate = std::max(this->minRate, this->rate * 0.5);
+		}
+		else if (ratio > 0.97)
+		{
+			this->rate = std::min(this->maxRate, this->rate * 1.25);
+		}
+		else
+		{
+			this->rate = std::min(this->maxRate, this->rate + this->minRate);
+		}
+	}
+
+	void ServerList::ResetPacer()
+	{
+		const auto minRate = static_cast<double>(NETServerQueryLimit.get<int>() * NETServerFrames.get<int>());
+		Pacer.reset(minRate, minRate, NETServerQueryMaxRate.get<int>(), QueryPacer::Clock::now());
+	}
+
+	int ServerList::GetKnownPing(const Network::Address& address)
+	{
+		const auto* index = GetIndex();
+		const auto* list = GetList();
+		if (!index || !list) return -1;
+
+		const auto entry = index->addresses.find(address);
+		if (entry == index->addresses.end() || entry->second >= list->size()) return -1;
+
+		return (*list)[entry->second].ping;
+	}
 
 	std::vector<ServerList::ServerInfo>* ServerList::GetList()
 	{
@@ -55,6 +203,46 @@ namespace Components
 		return nullptr;
 	}
 
+	ServerList::ServerIndex* ServerList::GetIndex()
+	{
+		if (IsOnlineList())
+		{
+			return &OnlineIndex;
+		}
+
+		if (IsOfflineList())
+		{
+			return &OfflineIndex;
+		}
+
+		if (IsFavouriteList())
+		{
+			return &FavouriteIndex;
+		}
+
+		return nullptr;
+	}
+
+	void ServerList::ClearList()
+	{
+		auto* list = GetList();
+		if (list) list->clear();
+
+		auto* index = GetIndex();
+		if (index) index->clear();
+	}
+
+	void ServerList::RebuildIndex(const std::vector<ServerInfo>& list, ServerIndex* index)
+	{
+		index->clear();
+
+		for (unsigned int i = 0; i < list.size(); ++i)
+		{
+			index->addresses[list[i].addr] = i;
+			++index->hashes[list[i].hash];
+		}
+	}
+
 	bool ServerList::IsFavouriteList()
 	{
 		return (*Game::ui_netSource)->current.integer == 2;
@@ -208,12 +396,14 @@ namespace Components
 		}
 		else
 		{
-			list->clear();
+			ClearList();
+			ClearVisibleList();
 
 			std::lock_guard _(RefreshContainer.mutex);
 
 			RefreshContainer.sendCount = 0;
 			RefreshContainer.sentCount = 0;
+			ResetPacer();
 
 			for (const auto& server : tempList)
 			{
@@ -231,7 +421,7 @@ namespace Components
 	{
 		Game::Dvar_SetBoolByName("ui_serverSelected", false);
 
-		VisibleList.clear();
+		ClearVisibleList();
 
 		auto* list = GetList();
 		if (!list) return;
@@ -242,39 +432,53 @@ namespace Components
 			return;
 		}
 
-		auto ui_browserShowFull = Dvar::Var("ui_browserShowFull").get<bool>();
-		auto ui_browserShowEmpty = Dvar::Var("ui_browserShowEmpty").get<bool>();
-		auto ui_browserShowHardcore = Dvar::Var("ui_browserKillcam").get<int>();
-		auto ui_browserShowPassword = Dvar::Var("ui_browserShowPassword").get<int>();
-		auto ui_browserMod = Dvar::Var("ui_browserMod").get<int>();
-		auto ui_joinGametype = (*Game::ui_joinGametype)->current.integer;
+		const auto filter = GetBrowserFilter();
 
 		for (unsigned int i = 0; i < list->size(); ++i)
 		{
-			auto* serverInfo = &(*list)[i];
+			if (IsServerVisible(filter, (*list)[i]))
+			{
+				VisibleList.push_back(i);
+			}
+		}
 
-			// Filter full servers
-			if (!ui_browserShowFull && serverInfo->clients >= serverInfo->maxClients) continue;
+		VisibleListSorted = false;
+		SortList();
+	}
 
-			// Filter empty servers
-			if (!ui_browserShowEmpty && serverInfo->clients <= 0) continue;
+	ServerList::BrowserFilter ServerList::GetBrowserFilter()
+	{
+		BrowserFilter filter;
+		filter.showFull = Dvar::Var("ui_browserShowFull").get<bool>();
+		filter.showEmpty = Dvar::Var("ui_browserShowEmpty").get<bool>();
+		filter.showHardcore = Dvar::Var("ui_browserKillcam").get<int>();
+		filter.showPassword = Dvar::Var("ui_browserShowPassword").get<int>();
+		filter.mod = Dvar::Var("ui_browserMod").get<int>();
+		filter.gametype = (*Game::ui_joinGametype)->current.integer;
+		return filter;
+	}
 
-			// Filter hardcore servers
-			if ((ui_browserShowHardcore == 0 && serverInfo->hardcore) || (ui_browserShowHardcore == 1 && !serverInfo->hardcore)) continue;
+	bool ServerList::IsServerVisible(const BrowserFilter& filter, const ServerInfo& server)
+	{
+		// Filter full servers
+		if (!filter.showFull && server.clients >= server.maxClients) return false;
 
-			// Filter servers with password
-			if ((ui_browserShowPassword == 0 && serverInfo->password) || (ui_browserShowPassword == 1 && !serverInfo->password)) continue;
+		// Filter empty servers
+		if (!filter.showEmpty && server.clients <= 0) return false;
 
-			// Don't show modded servers
-			if ((ui_browserMod == 0 && static_cast<int>(serverInfo->mod.size())) || (ui_browserMod == 1 && serverInfo->mod.empty())) continue;
+		// Filter hardcore servers
+		if ((filter.showHardcore == 0 && server.hardcore) || (filter.showHardcore == 1 && !server.hardcore)) return false;
 
-			// Filter by gametype
-			if (ui_joinGametype > 0 && (ui_joinGametype - 1) < *Game::gameTypeCount  && Game::gameTypes[(ui_joinGametype - 1)].gameType != serverInfo->gametype) continue;
+		// Filter servers with password
+		if ((filter.showPassword == 0 && server.password) || (filter.showPassword == 1 && !server.password)) return false;
 
-			VisibleList.push_back(i);
-		}
+		// Don't show modded servers
+		if ((filter.mod == 0 && static_cast<int>(server.mod.size())) || (filter.mod == 1 && server.mod.empty())) return false;
 
-		SortList();
+		// Filter by gametype
+		if (filter.gametype > 0 && (filter.gametype - 1) < *Game::gameTypeCount && Game::gameTypes[(filter.gametype - 1)].gameType != server.gametype) return false;
+
+		return true;
 	}
 
 	void ServerList::ParseNewMasterServerResponse(const std::string& servers)
@@ -344,16 +548,17 @@ namespace Components
 	{
 		Dvar::Var("ui_serverSelected").set(false);
 
-		auto* list = GetList();
-		if (list) list->clear();
-
-		VisibleList.clear();
+		ClearList();
+		ClearVisibleList();
 
 		{
 			std::lock_guard _(RefreshContainer.mutex);
 			RefreshContainer.servers.clear();
+			RefreshContainer.pending = {};
+			RefreshContainer.inFlight = {};
 			RefreshContainer.sendCount = 0;
 			RefreshContainer.sentCount = 0;
+			ResetPacer();
 		}
 
 		if (IsOfflineList())
@@ -474,9 +679,8 @@ namespace Components
 		const auto data = nlohmann::json(servers);
 		Utils::IO::WriteFile(FavouriteFile, data.dump());
 
-		auto* list = GetList();
-		if (list) list->clear();
-		
+		ClearList();
+
 		RefreshVisibleListInternal(UIScript::Token(), nullptr);
 	}
 
@@ -487,8 +691,7 @@ namespace Components
 			return;
 		}
 
-		auto* list = GetList();
-		if (list) list->clear();
+		ClearList();
 
 		const auto parseData = Utils::IO::ReadFile(FavouriteFile);
 		if (parseData.empty())
@@ -526,144 +729,133 @@ namespace Components
 	{
 		std::lock_guard _(RefreshContainer.mutex);
 
+		if (RefreshContainer.servers.contains(address)) return;
+
 		Container::ServerContainer container;
 		container.sent = false;
+		container.attempts = 0;
 		container.target = address;
 
-		auto alreadyInserted = false;
-		for (auto &server : RefreshContainer.servers)
-		{
-			if (server.target == container.target)
-			{
-				alreadyInserted = true;
-				break;
-			}
-		}
+		RefreshContainer.servers.emplace(address, container);
+		RefreshContainer.pending.push(address);
 
-		if (!alreadyInserted)
+		const auto* index = GetIndex();
+		if (index && index->addresses.contains(address))
 		{
-			RefreshContainer.servers.push_back(container);
-
-			auto* list = GetList();
-			if (list)
-			{
-				for (auto& server : *list)
-				{
-					if (server.addr == container.target)
-					{
-						--RefreshContainer.sendCount;
-						--RefreshContainer.sentCount;
-						break;
-					}
-				}
-			}
-
-			++RefreshContainer.sendCount;
+			--RefreshContainer.sendCount;
+			--RefreshContainer.sentCount;
 		}
+
+		++RefreshContainer.sendCount;
 	}
 
 	void ServerList::Insert(const Network::Address& address, const Utils::InfoString& info)
 	{
 		std::lock_guard _(RefreshContainer.mutex);
 
-		for (auto i = RefreshContainer.servers.begin(); i != RefreshContainer.servers.end();)
+		// Our desired server
+		const auto request = RefreshContainer.servers.find(address);
+		if (request == RefreshContainer.servers.end() || !request->second.sent) return;
+
+		// Challenge did not match
+		if (request->second.challenge != info.get("challenge"))
 		{
-			// Our desired server
-			if ((i->target != address) || !i->sent)
-			{
-				++i;
-				continue;
-			}
+			// Shall we remove the server from the queue?
+			// Better not, it might send a second response with the correct challenge.
+			// This might happen when users refresh twice (or more often) in a short period of time
+			return;
+		}
 
-			// Challenge did not match
-			if (i->challenge != info.get("challenge"))
-			{
-				// Shall we remove the server from the queue?
-				// Better not, it might send a second response with the correct challenge.
-				// This might happen when users refresh twice (or more often) in a short period of time
-				break;
-			}
+		ServerInfo server;
+		server.hostname = info.get("hostname");
+		server.mapname = info.get("mapname");
+		server.gametype = info.get("gametype");
+		server.version = info.get("version");
+		server.mod = info.get("fs_game");
+		server.matchType = std::strtol(info.get("matchtype").data(), nullptr, 10);
+		server.clients = std::strtol(info.get("clients").data(), nullptr, 10);
+		server.bots = std::strtol(info.get("bots").data(), nullptr, 10);
+		server.securityLevel = std::strtol(info.get("securityLevel").data(), nullptr, 10);
+		server.maxClients = std::strtol(info.get("sv_maxclients").data(), nullptr, 10);
+		server.password = info.get("isPrivate") == "1"s;
+		server.aimassist = info.get("aimAssist") == "1";
+		server.voice = info.get("voiceChat") == "1"s;
+		server.hardcore = info.get("hc") == "1"s;
+		server.svRunning = info.get("sv_running") == "1"s;
+		const auto now = QueryPacer::Clock::now();
+		const auto rtt = std::chrono::duration_cast<std::chrono::milliseconds>(now - request->second.sendTime);
+
+		// A retried query could have been answered by either attempt, so its round trip time is no sample for the pacer
+		if (request->second.attempts > 1) Pacer.onResponse(now);
+		else Pacer.onResponse(rtt, now);
+
+		server.ping = static_cast<int>(rtt.count());
+		server.addr = address;
+
+		std::hash<ServerInfo> hashFn;
+		server.hash = hashFn(server);
+
+		server.hostname = TextRenderer::StripMaterialTextIcons(server.hostname);
+		server.mapname = TextRenderer::StripMaterialTextIcons(server.mapname);
+		server.gametype = TextRenderer::StripMaterialTextIcons(server.gametype);
+		server.mod = TextRenderer::StripMaterialTextIcons(server.mod);
+
+		ComputeSortKeys(&server);
+
+		// Remove server from queue
+		RefreshContainer.servers.erase(request);
+
+		// Servers with more than 18 players or less than 0 players are faking for sure
+		// So lets ignore those
+		if (static_cast<std::size_t>(server.clients) > Game::MAX_CLIENTS || static_cast<std::size_t>(server.maxClients) > Game::MAX_CLIENTS)
+		{
+			return;
+		}
 
-			ServerInfo server;
-			server.hostname = info.get("hostname");
-			server.mapname = info.get("mapname");
-			server.gametype = info.get("gametype");
-			server.version = info.get("version");
-			server.mod = info.get("fs_game");
-			server.matchType = std::strtol(info.get("matchtype").data(), nullptr, 10);
-			server.clients = std::strtol(info.get("clients").data(), nullptr, 10);
-			server.bots = std::strtol(info.get("bots").data(), nullptr, 10);
-			server.securityLevel = std::strtol(info.get("securityLevel").data(), nullptr, 10);
-			server.maxClients = std::strtol(info.get("sv_maxclients").data(), nullptr, 10);
-			server.password = info.get("isPrivate") == "1"s;
-			server.aimassist = info.get("aimAssist") == "1";
-			server.voice = info.get("voiceChat") == "1"s;
-			server.hardcore = info.get("hc") == "1"s;
-			server.svRunning = info.get("sv_running") == "1"s;
-			server.ping = (Game::Sys_Milliseconds() - i->sendTime);
-			server.addr = address;
-
-			std::hash<ServerInfo> hashFn;
-			server.hash = hashFn(server);
-
-			server.hostname = TextRenderer::StripMaterialTextIcons(server.hostname);
-			server.mapname = TextRenderer::StripMaterialTextIcons(server.mapname);
-			server.gametype = TextRenderer::StripMaterialTextIcons(server.gametype);
-			server.mod = TextRenderer::StripMaterialTextIcons(server.mod);
-
-			// Remove server from queue
-			i = RefreshContainer.servers.erase(i);
-
-			// Servers with more than 18 players or less than 0 players are faking for sure
-			// So lets ignore those
-			if (static_cast<std::size_t>(server.clients) > Game::MAX_CLIENTS || static_cast<std::size_t>(server.maxClients) > Game::MAX_CLIENTS)
-			{
-				return;
-			}
+		auto* list = GetList();
+		auto* index = GetIndex();
+		if (!list || !index) return;
 
-			// Check if already inserted and remove
-			auto* list = GetList();
-			if (!list) return;
+		// Check if already inserted, the entry is then updated in place so indices stay valid
+		const auto existing = index->addresses.find(address);
+		if (existing != index->addresses.end())
+		{
+			const auto position = existing->second;
+			RemoveVisible(*list, position);
+
+			auto& hashes = index->hashes[(*list)[position].hash];
+			if (!--hashes) index->hashes.erase((*list)[position].hash);
+		}
 
-			std::size_t k = 0;
-			for (auto j = list->begin(); j != list->end(); ++k)
+		if (info.get("gamename") == "IW4"s && server.matchType && !IsServerDuplicate(index, server))
+		{
+			unsigned int position;
+			if (existing != index->addresses.end())
 			{
-				if (j->addr == address)
-				{
-					j = list->erase(j);
-				}
-				else
-				{
-					++j;
-				}
+				position = existing->second;
+				(*list)[position] = server;
 			}
-
-			// Also remove from visible list
-			for (auto j = VisibleList.begin(); j != VisibleList.end();)
+			else
 			{
-				if (*j == k)
-				{
-					j = VisibleList.erase(j);
-				}
-				else
-				{
-					++j;
-				}
+				position = list->size();
+				list->push_back(server);
+				index->addresses.emplace(address, position);
 			}
 
-			if (info.get("gamename") == "IW4"s && server.matchType)
+			++index->hashes[server.hash];
+
+			if (IsServerVisible(GetBrowserFilter(), (*list)[position]))
 			{
-				auto* lList = GetList();
-				if (lList)
-				{
-					if (!IsServerDuplicate(lList, server))
-					{
-						lList->push_back(server);
-						RefreshVisibleListInternal(UIScript::Token(), nullptr);
-					}
-				}
+				InsertVisible(*list, position);
 			}
 		}
+		else if (existing != index->addresses.end())
+		{
+			// Rare, the server no longer qualifies. Erasing shifts indices, so rebuild everything
+			list->erase(list->begin() + existing->second);
+			RebuildIndex(*list, index);
+			RefreshVisibleListInternal(UIScript::Token(), nullptr);
+		}
 	}
 
 	bool ServerList::CompareVersion(const std::string& version1, const std::string& version2)
@@ -694,17 +886,9 @@ namespace Components
 		return true;
 	}
 
-	bool ServerList::IsServerDuplicate(const std::vector<ServerInfo>* list, const ServerInfo& server)
+	bool ServerList::IsServerDuplicate(const ServerIndex* index, const ServerInfo& server)
 	{
-		for (auto l = list->begin(); l != list->end(); ++l)
-		{
-			if (l->hash == server.hash)
-			{
-				return true;
-			}
-		}
-
-		return false;
+		return index->hashes.contains(server.hash);
 	}
 
 	ServerList::ServerInfo* ServerList::GetCurrentServer()
@@ -717,39 +901,114 @@ namespace Components
 		// Only sort when the serverlist is open
 		if (!IsServerListOpen()) return;
 
-		std::ranges::stable_sort(VisibleList, [](const unsigned int& server1, const unsigned int& server2) -> bool
+		auto* list = GetList();
+		if (!list) return;
+
+		std::ranges::sort(VisibleList, [list](const unsigned int server1, const unsigned int server2)
 		{
-			ServerInfo* info1 = nullptr;
-			ServerInfo* info2 = nullptr;
+			return CompareServers(*list, server1, server2);
+		});
 
-			auto* list = GetList();
-			if (!list) return false;
+		VisibleListSorted = true;
+	}
 
-			if (list->size() > server1) info1 = &(*list)[server1];
-			if (list->size() > server2) info2 = &(*list)[server2];
+	std::string ServerList::GetSortKey(ServerInfo* server, Column column)
+	{
+		return Utils::String::ToLower(TextRenderer::StripColors(GetServerInfoText(server, static_cast<std::underlying_type_t<Column>>(column), true)));
+	}
 
-			if (!info1) return false;
-			if (!info2) return false;
+	void ServerList::ComputeSortKeys(ServerInfo* server)
+	{
+		for (auto i = 0; i < static_cast<std::underlying_type_t<Column>>(Column::Count); ++i)
+		{
+			const auto column = static_cast<Column>(i);
 
-			// Numerical comparisons
-			if (SortKey == static_cast<std::underlying_type_t<Column>>(Column::Ping))
-			{
-				return info1->ping < info2->ping;
-			}
+			// Numerical columns are compared directly
+			if (column == Column::Ping || column == Column::Players) continue;
 
-			if (SortKey == static_cast<std::underlying_type_t<Column>>(Column::Players))
-			{
-				return info1->clients < info2->clients;
-			}
+			server->sortKeys[i] = GetSortKey(server, column);
+		}
+	}
+
+	bool ServerList::CompareServers(const std::vector<ServerInfo>& list, const unsigned int index1, const unsigned int index2)
+	{
+		if (list.size() <= index1 || list.size() <= index2) return false;
 
-			auto text1 = Utils::String::ToLower(TextRenderer::StripColors(GetServerInfoText(info1, SortKey, true)));
-			auto text2 = Utils::String::ToLower(TextRenderer::StripColors(GetServerInfoText(info2, SortKey, true)));
+		const auto& info1 = list[index1];
+		const auto& info2 = list[index2];
 
+		auto result = 0;
+
+		// Numerical comparisons
+		if (SortKey == static_cast<std::underlying_type_t<Column>>(Column::Ping))
+		{
+			result = (info1.ping > info2.ping) - (info1.ping < info2.ping);
+		}
+		else if (SortKey == static_cast<std::underlying_type_t<Column>>(Column::Players))
+		{
+			result = (info1.clients > info2.clients) - (info1.clients < info2.clients);
+		}
+		else if (SortKey >= 0 && SortKey < static_cast<std::underlying_type_t<Column>>(Column::Count))
+		{
 			// ASCII-based comparison
-			return text1.compare(text2) < 0;
+			result = info1.sortKeys[SortKey].compare(info2.sortKeys[SortKey]);
+		}
+
+		// Fall back to the list order so the ordering is total and insertions land where a full sort would put them
+		if (!result)
+		{
+			result = (index1 > index2) - (index1 < index2);
+		}
+
+		return SortAsc ? result < 0 : result > 0;
+	}
+
+	void ServerList::InsertVisible(const std::vector<ServerInfo>& list, const unsigned int index)
+	{
+		if (!VisibleListSorted)
+		{
+			VisibleList.push_back(index);
+			return;
+		}
+
+		const auto position = std::ranges::upper_bound(VisibleList, index, [&list](const unsigned int server1, const unsigned int server2)
+		{
+			return CompareServers(list, server1, server2);
 		});
 
-		if (!SortAsc) std::ranges::reverse(VisibleList);
+		VisibleList.insert(position, index);
+	}
+
+	void ServerList::ClearVisibleList()
+	{
+		// An empty list is sorted, so servers arriving after a refresh are inserted in order
+		VisibleList.clear();
+		VisibleListSorted = true;
+	}
+
+	void ServerList::RemoveVisible(const std::vector<ServerInfo>& list, const unsigned int index)
+	{
+		if (VisibleListSorted)
+		{
+			// The order is total, so the entry is exactly where a lookup with its current data lands
+			const auto position = std::ranges::lower_bound(VisibleList, index, [&list](const unsigned int server1, const unsigned int server2)
+			{
+				return CompareServers(list, server1, server2);
+			});
+
+			if (position != VisibleList.end() && *position == index)
+			{
+				VisibleList.erase(position);
+			}
+
+			return;
+		}
+
+		const auto position = std::ranges::find(VisibleList, index);
+		if (position != VisibleList.end())
+		{
+			VisibleList.erase(position);
+		}
 	}
 
 	ServerList::ServerInfo* ServerList::GetServer(unsigned int index)
@@ -801,21 +1060,43 @@ namespace Components
 			}
 		}
 
+		const auto now = QueryPacer::Clock::now();
+		ExpireQueries(now);
+
+		if (RefreshContainer.pending.empty())
+		{
+			UpdateVisibleInfo();
+			return;
+		}
+
 		const auto challenge = Utils::Cryptography::Rand::GenerateChallenge();
-		auto requestLimit = NETServerQueryLimit.get<int>();
-		for (std::size_t i = 0; i < RefreshContainer.servers.size() && requestLimit > 0; ++i)
+		auto requestLimit = Pacer.acquire(now);
+		while (!RefreshContainer.pending.empty() && requestLimit > 0)
 		{
-			auto* server = &RefreshContainer.servers[i];
+			const auto entry = RefreshContainer.servers.find(RefreshContainer.pending.front());
+			RefreshContainer.pending.pop();
+
+			if (entry == RefreshContainer.servers.end()) continue;
+
+			auto* server = &entry->second;
 			if (server->sent) continue;
 
 			// Found server we can send a request to
 			server->sent = true;
 			requestLimit--;
 
-			server->sendTime = Game::Sys_Milliseconds();
-			server->challenge = challenge;
+			// Retries keep the challenge and send time of the first attempt, a late answer to it is still welcome
+			if (!server->attempts++)
+			{
+				server->sendTime = now;
+				server->challenge = challenge;
+				++RefreshContainer.sentCount;
+			}
 
-			++RefreshContainer.sentCount;
+			// The last attempt waits as long as we ever do, otherwise servers slower than the estimate would never show up
+			const auto timeout = server->attempts < MaxQueryAttempts ? Pacer.getTimeout(GetKnownPing(server->target)) : std::chrono::milliseconds(QueryPacer::MaxTimeout);
+			RefreshContainer.inFlight.push({ now + timeout, server->attempts, server->target });
+			Pacer.onSent(now);
 
 			Network::SendCommand(server->target, "getinfo", server->challenge);
 		}
@@ -823,6 +1104,31 @@ namespace Components
 		UpdateVisibleInfo();
 	}
 
+	void ServerList::ExpireQueries(const QueryPacer::Clock::time_point now)
+	{
+		while (!RefreshContainer.inFlight.empty() && RefreshContainer.inFlight.top().deadline <= now)
+		{
+			const auto query = RefreshContainer.inFlight.top();
+			RefreshContainer.inFlight.pop();
+
+			// Already answered, or sent again since
+			const auto entry = RefreshContainer.servers.find(query.target);
+			if (entry == RefreshContainer.servers.end() || !entry->second.sent || entry->second.attempts != query.attempt) continue;
+
+			Pacer.onTimeout(now);
+
+			if (entry->second.attempts < MaxQueryAttempts)
+			{
+				entry->second.sent = false;
+				RefreshContainer.pending.push(query.target);
+			}
+			else
+			{
+				RefreshContainer.servers.erase(entry);
+			}
+		}
+	}
+
 	void ServerList::UpdateSource()
 	{
 		auto source = (*Game::ui_netSource)->current.integer;
@@ -898,7 +1204,7 @@ namespace Components
 		OnlineList.clear();
 		OfflineList.clear();
 		FavouriteList.clear();
-		VisibleList.clear();
+		ClearVisibleList();
 
 		Events::OnDvarInit([]
 		{
@@ -911,6 +1217,8 @@ namespace Components
 				1, 10, Dedicated::IsEnabled() ? Game::DVAR_NONE : Game::DVAR_ARCHIVE, "Amount of server queries per frame");
 			NETServerFrames = Dvar::Register<int>("net_serverFrames", 30,
 				1, 60, Dedicated::IsEnabled() ? Game::DVAR_NONE : Game::DVAR_ARCHIVE, "Amount of server query frames per second");
+			NETServerQueryMaxRate = Dvar::Register<int>("net_serverQueryMaxRate", 1000,
+				10, 10000, Dedicated::IsEnabled() ? Game::DVAR_NONE : Game::DVAR_ARCHIVE, "Maximum amount of server queries per second while the query rate adapts");
 		});
 
 		// Fix ui_netsource dvar
@@ -1032,14 +1340,257 @@ namespace Components
 		UIScript::AddOwnerDraw(220, UpdateSource);
 		UIScript::AddOwnerDraw(253, UpdateGameType);
 
+		Command::Add("serverQueryStats", []
+		{
+			std::lock_guard _(RefreshContainer.mutex);
+
+			Logger::Print("Server queries: {} sent, {} answered, {} timed out, {} pending\n", Pacer.getSent(), Pacer.getReceived(), Pacer.getExpired(), RefreshContainer.pending.size());
+			Logger::Print("Rate: {:.0f}/s, response rate: {:.0f}%, smoothed rtt: {:.0f}ms\n", Pacer.getRate(), Pacer.getResponseRate() * 100.0, Pacer.getSmoothedRtt());
+		});
+
 		// Add frame callback
 		Scheduler::Loop(Frame, Scheduler::Pipeline::CLIENT);
 	}
 
+	bool ServerList::unitTest()
+	{
+		const auto sortKey = SortKey;
+		const auto sortAsc = SortAsc;
+		const auto visibleList = VisibleList;
+		const auto visibleListSorted = VisibleListSorted;
+
+		SortKey = static_cast<std::underlying_type_t<Column>>(Column::Hostname);
+		SortAsc = true;
+
+		constexpr std::size_t serverCount = 5000;
+		constexpr std::size_t arrivals = 50;
+
+		std::mt19937 random(1337);
+		std::vector<ServerInfo> list(serverCount);
+		for (std::size_t i = 0; i < list.size(); ++i)
+		{
+			list[i].hostname = std::format("^{}Server ^7{} #{}", random() % 10, (random() % 2) ? "TDM" : "ffa", random() % 1000);
+			list[i].ping = static_cast<int>(random() % 300);
+		}
+
+		const auto legacyCompare = [&list](const unsigned int server1, const unsigned int server2)
+		{
+			const auto text1 = Utils::String::ToLower(TextRenderer::StripColors(GetServerInfoText(&list[server1], SortKey, true)));
+			const auto text2 = Utils::String::ToLower(TextRenderer::StripColors(GetServerInfoText(&list[server2], SortKey, true)));
+			return text1.compare(text2) < 0;
+		};
+
+		const auto keyedCompare = [&list](const unsigned int server1, const unsigned int server2)
+		{
+			return CompareServers(list, server1, server2);
+		};
+
+		std::vector<unsigned int> legacy;
+		for (unsigned int i = 0; i < serverCount; ++i) legacy.push_back(i);
+
+		auto keyed = legacy;
+		const auto legacySort = Utils::Time::Measure([&] { std::ranges::stable_sort(legacy, legacyCompare); });
+
+		const auto keyedSort = Utils::Time::Measure([&]
+		{
+			for (auto& server : list)
+			{
+				server.sortKeys[SortKey] = GetSortKey(&server, Column::Hostname);
+			}
+
+			std::ranges::sort(keyed, keyedCompare);
+		});
+
+		// Let the last servers arrive one by one
+		legacy.clear();
+		for (unsigned int i = 0; i < serverCount - arrivals; ++i) legacy.push_back(i);
+		std::ranges::stable_sort(legacy, legacyCompare);
+
+		VisibleList = legacy;
+		VisibleListSorted = true;
+
+		const auto legacyInsert = Utils::Time::Measure([&]
+		{
+			for (auto i = static_cast<unsigned int>(serverCount - arrivals); i < serverCount; ++i)
+			{
+				legacy.push_back(i);
+				std::ranges::stable_sort(legacy, legacyCompare);
+			}
+		});
+
+		const auto keyedInsert = Utils::Time::Measure([&]
+		{
+			for (auto i = static_cast<unsigned int>(serverCount - arrivals); i < serverCount; ++i)
+			{
+				InsertVisible(list, i);
+			}
+		});
+
+		auto success = (legacy == keyed && VisibleList == keyed);
+
+		// Servers answering after a refresh land in order, whatever order the list was left in
+		VisibleListSorted = false;
+		ClearVisibleList();
+
+		std::vector<unsigned int> arrivalOrder = keyed;
+		std::ranges::shuffle(arrivalOrder, random);
+
+		for (const auto i : arrivalOrder)
+		{
+			InsertVisible(list, i);
+		}
+
+		success &= (VisibleList == keyed);
+
+		Logger::Print("Sorting {} servers: {} us (legacy), {} us (sort keys)\n", serverCount, legacySort.count(), keyedSort.count());
+		Logger::Print("Inserting {} servers: {} us (legacy), {} us (binary insertion)\n", arrivals, legacyInsert.count(), keyedInsert.count());
+
+		SortKey = sortKey;
+		SortAsc = sortAsc;
+		VisibleList = visibleList;
+		VisibleListSorted = visibleListSorted;
+
+		if (!success)
+		{
+			Logger::PrintError(Game::CON_CHANNEL_ERROR, "Server list order mismatch\n");
+			return false;
+		}
+
+		return SimulateQueries();
+	}
+
+	bool ServerList::SimulateQueries()
+	{
+		// Simulated fleet: every server answers after its own round trip time, some of them slower than any query timeout the pacer estimates.
+		// The link silently drops whatever exceeds its capacity and a few packets get lost anyway
+		constexpr std::size_t fleetSize = 3000;
+		constexpr std::size_t slowFleetSize = 150;
+		constexpr double linkCapacity = 600.0; // Packets per second
+		constexpr double legacyRate = 30.0; // net_serverQueryLimit * net_serverFrames
+		constexpr auto step = 5ms;
+
+		struct Event
+		{
+			QueryPacer::Clock::time_point time;
+			std::size_t server;
+			int attempt;
+
+			bool operator>(const Event& other) const
+			{
+				return this->time > other.time;
+			}
+		};
+
+		std::mt19937 random(1337);
+		std::vector<int> rtts(fleetSize);
+		std::vector<int> attempts(fleetSize);
+		std::vector<bool> answered(fleetSize);
+		std::vector<bool> dropped(fleetSize);
+
+		std::queue<std::size_t> pending;
+		for (std::size_t i = 0; i < fleetSize; ++i)
+		{
+			rtts[i] = i % (fleetSize / slowFleetSize) == 0 ? 1000 + static_cast<int>(random() % 1500) : 20 + static_cast<int>(random() % 230);
+			pending.push(i);
+		}
+
+		std::priority_queue<Event, std::vector<Event>, std::greater<>> responses;
+		std::priority_queue<Event, std::vector<Event>, std::greater<>> deadlines;
+
+		QueryPacer pacer;
+		QueryPacer::Clock::time_point now{};
+		pacer.reset(legacyRate, legacyRate, 5000.0, now);
+
+		std::size_t received = 0, failed = 0, slowReceived = 0;
+		double link = 0.0, peakRate = 0.0;
+
+		while (received + failed < fleetSize && now.time_since_epoch() < 120s)
+		{
+			now += step;
+			link = std::min(linkCapacity * 0.02, link + linkCapacity * std::chrono::duration<double>(step).count());
+
+			while (!responses.empty() && responses.top().time <= now)
+			{
+				const auto response = responses.top();
+				responses.pop();
+
+				// Any attempt may answer as long as the server has not been given up on, they all share the challenge
+				if (answered[response.server] || dropped[response.server]) continue;
+
+				answered[response.server] = true;
+				++received;
+				if (response.server % (fleetSize / slowFleetSize) == 0) ++slowReceived;
+
+				if (attempts[response.server] > 1) pacer.onResponse(now);
+				else pacer.onResponse(std::chrono::milliseconds(rtts[response.server]), now);
+			}
+
+			while (!deadlines.empty() && deadlines.top().time <= now)
+			{
+				const auto deadline = deadlines.top();
+				deadlines.pop();
+
+				if (answered[deadline.server] || attempts[deadline.server] != deadline.attempt) continue;
+
+				pacer.onTimeout(now);
+
+				if (attempts[deadline.server] < MaxQueryAttempts)
+				{
+					pending.push(deadline.server);
+				}
+				else
+				{
+					dropped[deadline.server] = true;
+					++failed;
+				}
+			}
+
+			for (auto count = pacer.acquire(now); count > 0 && !pending.empty(); --count)
+			{
+				const auto server = pending.front();
+				pending.pop();
+
+				const auto attempt = ++attempts[server];
+				pacer.onSent(now);
+				deadlines.push({ now + (attempt < MaxQueryAttempts ? pacer.getTimeout(-1) : std::chrono::milliseconds(QueryPacer::MaxTimeout)), server, attempt });
+
+				if (link >= 1.0 && random() % 100 != 0)
+				{
+					link -= 1.0;
+					responses.push({ now + std::chrono::milliseconds(rtts[server]), server, attempt });
+				}
+			}
+
+			peakRate = std::max(peakRate, pacer.getRate());
+		}
+
+		const auto duration = std::chrono::duration<double>(now.time_since_epoch()).count();
+		const auto legacyDuration = fleetSize / legacyRate;
+
+		Logger::Print("Querying {} simulated servers: {:.1f}s (legacy at least {:.1f}s), {} answered ({}/{} slow), {} lost, peak rate {:.0f}/s, final rate {:.0f}/s\n",
+			fleetSize, duration, legacyDuration, received, slowReceived, slowFleetSize, failed, peakRate, pacer.getRate());
+
+		if (received < fleetSize * 95 / 100 || duration >= legacyDuration)
+		{
+			Logger::PrintError(Game::CON_CHANNEL_ERROR, "Server query pacing did not beat the fixed rate\n");
+			return false;
+		}
+
+		if (slowReceived < slowFleetSize * 95 / 100)
+		{
+			Logger::PrintError(Game::CON_CHANNEL_ERROR, "Servers slower than the query timeout were given up on\n");
+			return false;
+		}
+
+		return true;
+	}
+
 	void ServerList::preDestroy()
 	{
 		std::lock_guard _(RefreshContainer.mutex);
 		RefreshContainer.awatingList = false;
 		RefreshContainer.servers.clear();
+		RefreshContainer.pending = {};
+		RefreshContainer.inFlight = {};
 	}
 }
@@ -7,6 +7,22 @@ namespace Components
 	public:
 		typedef int(SortCallback)(const void*, const void*);
 
+		enum class Column : int
+		{
+			Password,
+			Matchtype,
+			AimAssist,
+			VoiceChat,
+			Hostname,
+			Mapname,
+			Players,
+			Gametype,
+			Mod,
+			Ping,
+
+			Count
+		};
+
 		struct ServerInfo
 		{
 			Network::Address addr;
@@ -27,9 +43,14 @@ namespace Components
 			bool svRunning;
 			bool aimassist;
 			bool voice;
+
+			// Lowercase, color stripped column texts, computed once when the server is inserted
+			std::array<std::string, static_cast<std::size_t>(Column::Count)> sortKeys;
 		};
 
 		ServerList();
+
+		bool unitTest() override;
 		
 		void preDestroy() override;
 
@@ -57,22 +78,17 @@ namespace Components
 		static Dvar::Var UIServerSelectedMap;
 		static Dvar::Var NETServerQueryLimit;
 		static Dvar::Var NETServerFrames;
+		static Dvar::Var NETServerQueryMaxRate;
 
 	private:
-		enum class Column : int
+		struct BrowserFilter
 		{
-			Password,
-			Matchtype,
-			AimAssist,
-			VoiceChat,
-			Hostname,
-			Mapname,
-			Players,
-			Gametype,
-			Mod,
-			Ping,
-
-			Count
+			bool showFull;
+			bool showEmpty;
+			int showHardcore;
+			int showPassword;
+			int mod;
+			int gametype;
 		};
 
 		static constexpr auto* FavouriteFile = "players/favourites.json";
@@ -107,11 +123,24 @@ namespace Components
 			{
 			public:
 				bool sent;
-				int sendTime;
+				int attempts;
+				std::chrono::steady_clock::time_point sendTime;
 				std::string challenge;
 				Network::Address target;
 			};
 
+			struct Query
+			{
+				std::chrono::steady_clock::time_point deadline;
+				int attempt;
+				Network::Address target;
+
+				bool operator>(const Query& other) const
+				{
+					return this->deadline > other.deadline;
+				}
+			};
+
 			bool awatingList;
 			int awaitTime;
 
@@ -119,10 +148,81 @@ namespace Components
 			int sendCount;
 
 			Network::Address host;
-			std::vector<ServerContainer> servers;
+			std::unordered_map<Network::Address, ServerContainer> servers;
+			std::queue<Network::Address> pending; // Servers that have not been queried yet, in insertion order
+			std::priority_queue<Query, std::vector<Query>, std::greater<>> inFlight; // Sent queries, earliest deadline first
 			std::recursive_mutex mutex;
 		};
 
+		// Paces getinfo queries with a token bucket. The rate grows while servers keep answering and is halved when queries time out
+		class QueryPacer
+		{
+		public:
+			using Clock = std::chrono::steady_clock;
+
+			QueryPacer();
+
+			void reset(double rate, double minRate, double maxRate, Clock::time_point now);
+
+			// Returns how many queries may be sent right now
+			std::size_t acquire(Clock::time_point now);
+
+			void onSent(Clock::time_point now);
+			void onResponse(Clock::time_point now); // Answer without a usable round trip time
+			void onResponse(std::chrono::milliseconds rtt, Clock::time_point now);
+			void onTimeout(Clock::time_point now);
+
+			// Deadline for a query, based on the last ping of the server if known or the smoothed round trip time otherwise
+			[[nodiscard]] std::chrono::milliseconds getTimeout(int knownPing) const;
+
+			[[nodiscard]] double getRate() const { return this->rate; }
+			[[nodiscard]] std::uint64_t getSent() const { return this->sent; }
+			[[nodiscard]] std::uint64_t getReceived() const { return this->received; }
+			[[nodiscard]] std::uint64_t getExpired() const { return this->expired; }
+			[[nodiscard]] double getResponseRate() const { return this->responseRate; }
+			[[nodiscard]] double getSmoothedRtt() const { return this->srtt; }
+
+			static constexpr auto Window = 250ms;
+			static constexpr auto MinTimeout = 300ms;
+			static constexpr auto MaxTimeout = 3000ms;
+			static constexpr auto InitialTimeout = 1000ms;
+
+		private:
+			double rate;
+			double minRate;
+			double maxRate;
+			double tokens;
+
+			Clock::time_point lastRefill;
+			Clock::time_point windowStart;
+
+			std::uint32_t windowReceived;
+			std::uint32_t windowExpired;
+
+			std::uint64_t sent;
+			std::uint64_t received;
+			std::uint64_t expired;
+			double responseRate;
+
+			bool hasRtt;
+			double srtt;
+			double rttvar;
+
+			void adjust(Clock::time_point now);
+		};
+
+		struct ServerIndex
+		{
+			std::unordered_map<Network::Address, unsigned int> addresses; // Position of the server in its list
+			std::unordered_map<std::size_t, unsigned int> hashes; // Number of servers per ServerInfo hash
+
+			void clear()
+			{
+				this->addresses.clear();
+				this->hashes.clear();
+			}
+		};
+
 		static void ParseNewMasterServerResponse(const std::string& servers);
 
 		static unsigned int GetServerCount();
@@ -134,6 +234,14 @@ namespace Components
 		static void UpdateGameType();
 
 		static void SortList();
+		static void ComputeSortKeys(ServerInfo* server);
+		static std::string GetSortKey(ServerInfo* server, Column column);
+		static bool CompareServers(const std::vector<ServerInfo>& list, unsigned int index1, unsigned int index2);
+		static void InsertVisible(const std::vector<ServerInfo>& list, unsigned int index);
+		static void ClearVisibleList();
+
+		static BrowserFilter GetBrowserFilter();
+		static bool IsServerVisible(const BrowserFilter& filter, const ServerInfo& server);
 
 		static void LoadFavourties();
 		static void StoreFavourite(const std::string& server);
@@ -142,19 +250,37 @@ namespace Components
 		static ServerInfo* GetServer(unsigned int index);
 
 		static bool CompareVersion(const std::string& version1, const std::string& version2);
-		static bool IsServerDuplicate(const std::vector<ServerInfo>* list, const ServerInfo& server);
+		static bool IsServerDuplicate(const ServerIndex* index, const ServerInfo& server);
+
+		static ServerIndex* GetIndex();
+		static void ClearList();
+		static void RebuildIndex(const std::vector<ServerInfo>& list, ServerIndex* index);
+		static void RemoveVisible(const std::vector<ServerInfo>& list, unsigned int index);
 
 		static int SortKey;
 		static bool SortAsc;
 
 		static unsigned int CurrentServer;
 		static Container RefreshContainer;
+		static QueryPacer Pacer;
+
+		static constexpr int MaxQueryAttempts = 2;
+
+		static void ResetPacer();
+		static void ExpireQueries(QueryPacer::Clock::time_point now);
+		static int GetKnownPing(const Network::Address& address);
+		static bool SimulateQueries();
 
 		static std::vector<ServerInfo> OnlineList;
 		static std::vector<ServerInfo> OfflineList;
 		static std::vector<ServerInfo> FavouriteList;
 
+		static ServerIndex OnlineIndex;
+		static ServerIndex OfflineIndex;
+		static ServerIndex FavouriteIndex;
+
 		static std::vector<unsigned int> VisibleList;
+		static bool VisibleListSorted;
 
 		static bool IsServerListOpen();
 	};
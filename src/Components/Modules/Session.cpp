@@ -18,29 +18,343 @@ namespace Components
 
 	std::queue<std::pair<Network::Address, std::string>> Session::SignatureQueue;
 
-	void Session::Send(const Network::Address& target, const std::string& command, const std::string& data)
+	std::unordered_map<Network::Address, std::unique_ptr<Session::Peer>> Session::Peers;
+	std::unordered_map<Network::Address, Session::Channel::Clock::time_point> Session::LegacyPeers;
+
+	Session::Channel::Channel(const std::uint32_t id) : id_(id)
+	{
+	}
+
+	bool Session::Channel::push(const std::string_view command, const std::string_view data)
+	{
+		if (command.size() > std::numeric_limits<std::uint8_t>::max() || data.size() > std::numeric_limits<std::uint16_t>::max()) return false;
+		if (static_cast<std::uint16_t>(this->nextSeq_ - this->base_) >= Capacity) return false;
+
+		auto& slot = this->slots_[this->nextSeq_ % Capacity];
+		slot.used = true;
+		slot.sent = false;
+		slot.retries = 0;
+
+		// The slot keeps the buffers of its previous message, so this doesn't allocate once the channel is warm
+		slot.command.assign(command);
+		slot.data.assign(data);
+
+		++this->nextSeq_;
+		return true;
+	}
+
+	bool Session::Channel::receive(const std::string_view frame, const Clock::time_point now, std::vector<Message>& delivered)
+	{
+		if (frame.size() < HeaderSize || static_cast<std::uint8_t>(frame[0]) != FrameVersion) return false;
+
+		const auto read16 = [&](const std::size_t pos)
+		{
+			return static_cast<std::uint16_t>(static_cast<std::uint8_t>(frame[pos]) | static_cast<std::uint8_t>(frame[pos + 1]) << 8);
+		};
+
+		const auto read32 = [&](const std::size_t pos)
+		{
+			return static_cast<std::uint32_t>(read16(pos) | static_cast<std::uint32_t>(read16(pos + 2)) << 16);
+		};
+
+		const auto id = read32(1);
+		const auto base = read16(5);
+
+		if (this->peerId_ != id)
+		{
+			this->peerId_ = id;
+			this->expected_ = base;
+			this->receivedBits_ = 0;
+		}
+
+		// The peer gave up on everything before its base, don't wait for it
+		while (static_cast<std::int16_t>(base - this->expected_) > 0)
+		{
+			this->advance();
+		}
+
+		this->established_ = true;
+		this->unreachable_ = false;
+		this->acknowledge(read16(7), read32(9), now);
+
+		for (auto pos = HeaderSize; pos < frame.size();)
+		{
+			if (pos + MessageHeaderSize > frame.size()) return false;
+
+			const auto seq = read16(pos);
+			const std::size_t commandLength = static_cast<std::uint8_t>(frame[pos + 2]);
+			const std::size_t dataLength = read16(pos + 3);
+			pos += MessageHeaderSize;
+
+			if (pos + commandLength + dataLength > frame.size()) return false;
+
+			const Message message{ frame.substr(pos, commandLength), frame.substr(pos + commandLength, dataLength) };
+			pos += commandLength + dataLength;
+
+			// Duplicates are acked as well, our previous ack might have been lost
+			if (!this->ackPending_)
+			{
+				this->ackPending_ = true;
+				this->ackDue_ = now + AckDelay;
+			}
+
+			const auto distance = static_cast<std::uint16_t>(seq - this->expected_);
+			if (distance == 0)
+			{
+				delivered.emplace_back(message);
+				this->advance();
+			}
+			else if (distance <= Window)
+			{
+				const auto bit = 1u << (distance - 1);
+				if (!(this->receivedBits_ & bit))
+				{
+					this->receivedBits_ |= bit;
+					delivered.emplace_back(message);
+				}
+			}
+		}
+
+		return true;
+	}
+
+	bool Session::Channel::poll(const Clock::time_point now, std::string& frame)
 	{
-#ifdef DISABLE_SESSION
-		class DelayedResend
+		const auto write16 = [&](const std::uint16_t value)
 		{
-		public:
-			Network::Address target;
-			std::string command;
-			std::string data;
+			frame.push_back(static_cast<char>(value & 0xFF));
+			frame.push_back(static_cast<char>(value >> 8));
 		};
 
-		auto* delayData = new DelayedResend;
-		delayData->target = target;
-		delayData->command = command;
-		delayData->data = data;
+		const auto write32 = [&](const std::uint32_t value)
+		{
+			write16(static_cast<std::uint16_t>(value & 0xFFFF));
+			write16(static_cast<std::uint16_t>(value >> 16));
+		};
+
+		frame.clear();
+		frame.push_back(static_cast<char>(FrameVersion));
+		write32(this->id_);
+		write16(this->base_);
+		write16(this->expected_);
+		write32(this->receivedBits_);
+
+		auto hasData = false;
+		const auto pending = static_cast<std::uint16_t>(this->nextSeq_ - this->base_);
 
-		Network::SendCommand(target, command, data);
+		for (std::uint16_t i = 0; i < pending && i < Window; ++i)
+		{
+			const auto seq = static_cast<std::uint16_t>(this->base_ + i);
+			auto& slot = this->slots_[seq % Capacity];
+			if (!slot.used || (slot.sent && slot.due > now)) continue;
+
+			if (slot.sent && !this->established_ && slot.retries >= SESSION_MAX_RETRIES)
+			{
+				// Nothing ever came back, keep the messages so they can be sent another way
+				this->unreachable_ = true;
+				continue;
+			}
+
+			if (slot.sent && slot.retries >= MaxRetries)
+			{
+				this->release(slot);
+				++this->stats_.expired;
+				continue;
+			}
+
+			if (hasData && frame.size() + MessageHeaderSize + slot.command.size() + slot.data.size() > MaxFrameSize) break;
+
+			write16(seq);
+			frame.push_back(static_cast<char>(slot.command.size()));
+			write16(static_cast<std::uint16_t>(slot.data.size()));
+			frame.append(slot.command);
+			frame.append(slot.data);
+
+			if (slot.sent)
+			{
+				++slot.retries;
+				++this->stats_.retransmits;
+			}
+
+			slot.sent = true;
+			slot.sentAt = now;
+			slot.due = now + std::min<Clock::duration>(this->rto_ * (1 << slot.retries), MaxTimeout);
+
+			hasData = true;
+		}
 
-		Scheduler::Once([delayData]
+		while (this->base_ != this->nextSeq_ && !this->slots_[this->base_ % Capacity].used)
 		{
-			Network::SendCommand(delayData->target, delayData->command, delayData->data);
-			delete delayData;
-		}, Scheduler::Pipeline::MAIN, 500ms + std::chrono::milliseconds(std::rand() % 200));
+			++this->base_;
+		}
+
+		if (!hasData && (!this->ackPending_ || now < this->ackDue_)) return false;
+
+		this->ackPending_ = false;
+		++this->stats_.frames;
+		this->stats_.bytes += frame.size();
+		return true;
+	}
+
+	void Session::Channel::drain(const std::function<void(const Message&)>& callback)
+	{
+		for (; this->base_ != this->nextSeq_; ++this->base_)
+		{
+			auto& slot = this->slots_[this->base_ % Capacity];
+			if (!slot.used) continue;
+
+			callback({ slot.command, slot.data });
+			this->release(slot);
+		}
+	}
+
+	bool Session::Channel::isIdle() const
+	{
+		return this->base_ == this->nextSeq_ && !this->ackPending_;
+	}
+
+	void Session::Channel::acknowledge(const std::uint16_t ack, const std::uint32_t bits, const Clock::time_point now)
+	{
+		const auto pending = static_cast<std::uint16_t>(this->nextSeq_ - this->base_);
+
+		// Acks for messages we never sent are stale or bogus
+		if (static_cast<std::uint16_t>(ack - this->base_) > pending) return;
+
+		for (std::uint16_t i = 0; i < pending; ++i)
+		{
+			const auto seq = static_cast<std::uint16_t>(this->base_ + i);
+			auto& slot = this->slots_[seq % Capacity];
+			if (!slot.used || !slot.sent) continue;
+
+			const auto distance = static_cast<std::uint16_t>(seq - ack);
+			const auto acked = static_cast<std::int16_t>(distance) < 0 || (distance >= 1 && distance <= Window && (bits & (1u << (distance - 1))));
+			if (!acked) continue;
+
+			// Only messages that were sent once give a clear round trip time
+			if (!slot.retries) this->sampleRtt(now - slot.sentAt);
+			this->release(slot);
+		}
+
+		while (this->base_ != this->nextSeq_ && !this->slots_[this->base_ % Capacity].used)
+		{
+			++this->base_;
+		}
+	}
+
+	void Session::Channel::advance()
+	{
+		// Moves past the expected message and everything behind it that already arrived
+		++this->expected_;
+		while (this->receivedBits_ & 1)
+		{
+			this->receivedBits_ >>= 1;
+			++this->expected_;
+		}
+
+		this->receivedBits_ >>= 1;
+	}
+
+	void Session::Channel::release(Slot& slot)
+	{
+		slot.used = false;
+		slot.command.clear();
+		slot.data.clear();
+	}
+
+	void Session::Channel::sampleRtt(const Clock::duration rtt)
+	{
+		// RFC 6298
+		if (!this->srtt_)
+		{
+			this->srtt_ = rtt;
+			this->rttvar_ = rtt / 2;
+		}
+		else
+		{
+			const auto error = *this->srtt_ > rtt ? *this->srtt_ - rtt : rtt - *this->srtt_;
+			this->rttvar_ = (this->rttvar_ * 3 + error) / 4;
+			this->srtt_ = (*this->srtt_ * 7 + rtt) / 8;
+		}
+
+		this->rto_ = std::clamp<Clock::duration>(*this->srtt_ + this->rttvar_ * 4, MinTimeout, MaxTimeout);
+	}
+
+	Session::Peer& Session::GetPeer(const Network::Address& address, const Channel::Clock::time_point now)
+	{
+		if (const auto peer = Session::Peers.find(address); peer != Session::Peers.end())
+		{
+			peer->second->lastActivity = now;
+			return *peer->second;
+		}
+
+		if (Session::Peers.size() >= MaxPeers)
+		{
+			const auto oldest = std::ranges::min_element(Session::Peers, {}, [](const auto& entry) { return entry.second->lastActivity; });
+			DropPeer(oldest->first, *oldest->second);
+			Session::Peers.erase(oldest);
+		}
+
+		auto& peer = Session::Peers[address];
+		peer = std::make_unique<Peer>(Utils::Cryptography::Rand::GenerateInt());
+		peer->lastActivity = now;
+		return *peer;
+	}
+
+	void Session::DropPeer(const Network::Address& address, Peer& peer)
+	{
+		// Whatever is still waiting for an ack goes out as plain commands, the peer can only tell the difference by a duplicate
+		peer.channel.drain([&](const Channel::Message& message)
+		{
+			Network::SendCommand(address, std::string(message.command), std::string(message.data));
+		});
+	}
+
+	bool Session::IsLegacy(const Network::Address& address, const Channel::Clock::time_point now)
+	{
+		const auto entry = Session::LegacyPeers.find(address);
+		if (entry == Session::LegacyPeers.end()) return false;
+		if (now - entry->second < LegacyTimeout) return true;
+
+		Session::LegacyPeers.erase(entry);
+		return false;
+	}
+
+	void Session::MarkLegacy(const Network::Address& address, const Channel::Clock::time_point now)
+	{
+		if (Session::LegacyPeers.size() >= MaxLegacyPeers && !Session::LegacyPeers.contains(address))
+		{
+			Session::LegacyPeers.erase(std::ranges::min_element(Session::LegacyPeers, {}, [](const auto& entry) { return entry.second; }));
+		}
+
+		Session::LegacyPeers[address] = now;
+	}
+
+	void Session::HandlePlain(const Network::Address& address, const Channel::Clock::time_point now)
+	{
+		if (const auto peer = Session::Peers.find(address); peer != Session::Peers.end())
+		{
+			// Peers that answered our frames only fall back to plain commands when their window is full
+			if (peer->second->channel.isEstablished()) return;
+
+			DropPeer(address, *peer->second);
+			Session::Peers.erase(peer);
+		}
+
+		MarkLegacy(address, now);
+	}
+
+	void Session::Send(const Network::Address& target, const std::string& command, const std::string& data)
+	{
+#ifdef SESSION_RELIABLE_CHANNEL
+		std::lock_guard _(Session::Mutex);
+
+		const auto now = Channel::Clock::now();
+
+		// Peers that never answered our frames get plain commands, just like a full window
+		if (IsLegacy(target, now) || !GetPeer(target, now).channel.push(command, data))
+		{
+			Network::SendCommand(target, command, data);
+		}
 #else
 		std::lock_guard _(Session::Mutex);
 
@@ -63,14 +377,94 @@ namespace Components
 
 	void Session::Handle(const std::string& packet, const Network::networkCallback& callback)
 	{
-#ifdef DISABLE_SESSION
-		Network::OnClientPacket(packet, callback);
+#ifdef SESSION_RELIABLE_CHANNEL
+		// Old clients still send plain commands, answer them the same way right away instead of waiting for our frames to go unanswered
+		Network::OnClientPacket(packet, [callback](Network::Address& address, const std::string& data)
+		{
+			{
+				std::lock_guard _(Session::Mutex);
+				HandlePlain(address, Channel::Clock::now());
+			}
+
+			callback(address, data);
+		});
+
+		std::lock_guard _(Session::Mutex);
+		Session::PacketHandlers[packet] = callback;
 #else
 		std::lock_guard _(Session::Mutex);
 		Session::PacketHandlers[packet] = callback;
 #endif
 	}
 
+	void Session::Flush()
+	{
+		std::lock_guard _(Session::Mutex);
+
+		const auto now = Channel::Clock::now();
+		static std::string frame;
+
+		for (auto i = Session::Peers.begin(); i != Session::Peers.end();)
+		{
+			const auto& address = i->first;
+			auto& peer = *i->second;
+
+			while (peer.channel.poll(now, frame))
+			{
+				Network::SendCommand(address, "sessionData", frame);
+			}
+
+			if (peer.channel.isUnreachable())
+			{
+				MarkLegacy(address, now);
+				DropPeer(address, peer);
+
+				i = Session::Peers.erase(i);
+				continue;
+			}
+
+			if (peer.channel.isIdle() && now - peer.lastActivity > std::chrono::milliseconds(SESSION_TIMEOUT))
+			{
+				i = Session::Peers.erase(i);
+				continue;
+			}
+
+			++i;
+		}
+	}
+
+	void Session::HandleData(const Network::Address& address, const std::string& data)
+	{
+		std::lock_guard _(Session::Mutex);
+
+		const auto now = Channel::Clock::now();
+
+		auto& peer = GetPeer(address, now);
+		Session::LegacyPeers.erase(address);
+
+		static std::vector<Channel::Message> delivered;
+		delivered.clear();
+
+		if (!peer.channel.receive(data, now, delivered)) return;
+
+		static std::string command, payload;
+		for (const auto& message : delivered)
+		{
+			command.assign(message.command);
+			payload.assign(message.data);
+			Dispatch(address, command, payload);
+		}
+	}
+
+	void Session::Dispatch(const Network::Address& address, const std::string& command, const std::string& data)
+	{
+		const auto handler = Session::PacketHandlers.find(command);
+		if (handler == Session::PacketHandlers.end()) return;
+
+		auto target = address;
+		handler->second(target, data);
+	}
+
 	void Session::RunFrame()
 	{
 		std::lock_guard _(Session::Mutex);
@@ -135,7 +529,10 @@ namespace Components
 
 	Session::Session()
 	{
-#ifndef DISABLE_SESSION
+#ifdef SESSION_RELIABLE_CHANNEL
+		Network::OnClientPacket("sessionData", HandleData);
+		Scheduler::Loop(Flush, Scheduler::Pipeline::MAIN);
+#else
 		Session::SignatureKey = Utils::Cryptography::ECC::GenerateKey(512);
 		//Scheduler::OnFrame(Session::RunFrame);
 
@@ -203,6 +600,8 @@ namespace Components
 		std::lock_guard _(Session::Mutex);
 		Session::PacketHandlers.clear();
 		Session::PacketQueue.clear();
+		Session::Peers.clear();
+		Session::LegacyPeers.clear();
 		Session::SignatureQueue = std::queue<std::pair<Network::Address, std::string>>();
 
 		Session::SignatureKey.free();
@@ -281,6 +680,171 @@ namespace Components
 			return false;
 		}
 
+		printf("Success\n");
+		printf("Testing reliable delivery under 20%% loss...");
+
+		using Clock = Channel::Clock;
+		constexpr auto messageCount = 300;
+		constexpr auto loss = 20;
+		constexpr std::size_t wireOverhead = 4 + sizeof("sessionData"); // OOB header, command and separator
+
+		struct Transit
+		{
+			Clock::time_point arrival;
+			bool toB;
+			std::string frame;
+		};
+
+		std::mt19937 random(1337);
+		std::vector<Transit> link;
+		std::vector<Channel::Message> delivered;
+		std::vector<int> received(messageCount);
+		std::string frame;
+
+		Channel a(1), b(2);
+		Clock::time_point now{};
+
+		std::uint64_t reliableBytes = 0, legacyBytes = 0;
+		auto legacyLost = 0, legacyDuplicates = 0;
+
+		const auto transmit = [&](const bool toB)
+		{
+			reliableBytes += wireOverhead + frame.size();
+			if (static_cast<int>(random() % 100) < loss) return;
+
+			link.push_back({ now + std::chrono::milliseconds(20 + random() % 60), toB, frame });
+		};
+
+		auto next = 0;
+		for (auto step = 0; step < 60000; step += 10, now += 10ms)
+		{
+			// Bursts of node traffic, small requests and full list chunks
+			for (auto i = 0; step % 100 == 0 && i < 10 && next < messageCount; ++i)
+			{
+				const auto* command = next % 3 ? "nodeListRequest" : "nodeListResponse";
+				std::string data(next % 3 ? 20 : 1200, 'x');
+				std::memcpy(data.data(), &next, sizeof(next));
+
+				if (!a.push(command, data)) break;
+
+				// The old path sent every packet twice, blindly
+				legacyBytes += 2 * (4 + std::strlen(command) + 1 + data.size());
+				const auto first = static_cast<int>(random() % 100) >= loss;
+				const auto second = static_cast<int>(random() % 100) >= loss;
+				if (!first && !second) ++legacyLost;
+				if (first && second) ++legacyDuplicates;
+
+				++next;
+			}
+
+			for (auto i = link.begin(); i != link.end();)
+			{
+				if (i->arrival > now)
+				{
+					++i;
+					continue;
+				}
+
+				delivered.clear();
+				(i->toB ? b : a).receive(i->frame, now, delivered);
+
+				for (const auto& message : delivered)
+				{
+					int index;
+					std::memcpy(&index, message.data.data(), sizeof(index));
+					++received[index];
+				}
+
+				i = link.erase(i);
+			}
+
+			while (a.poll(now, frame)) transmit(true);
+			while (b.poll(now, frame)) transmit(false);
+		}
+
+		if (next != messageCount || !a.isIdle() || std::any_of(received.begin(), received.end(), [](const int count) { return count != 1; }))
+		{
+			printf("Error\n");
+			printf("Reliable delivery lost or duplicated messages (%d queued)\n", next);
+			return false;
+		}
+
+		printf("Success\n");
+		printf("Reliable: %llu bytes in %llu frames, %llu retransmits. Double send: %llu bytes, %d lost, %d duplicated\n",
+			reliableBytes, a.getStats().frames + b.getStats().frames, a.getStats().retransmits, legacyBytes, legacyLost, legacyDuplicates);
+
+		if (reliableBytes >= legacyBytes)
+		{
+			printf("Reliable delivery used more bandwidth than sending everything twice\n");
+			return false;
+		}
+
+		// A peer that never answers gets the message handed back for a plain send
+		Channel silent(3);
+		silent.push("nodeListRequest", {});
+		for (auto step = 0; step < 20000; step += 10, now += 10ms)
+		{
+			while (silent.poll(now, frame));
+		}
+
+		auto drained = 0;
+		silent.drain([&](const Channel::Message& message)
+		{
+			if (message.command == "nodeListRequest") ++drained;
+		});
+
+		if (!silent.isUnreachable() || drained != 1 || !silent.isIdle())
+		{
+			printf("Unanswered messages were not handed back\n");
+			return false;
+		}
+
+		printf("Testing peer limits...");
+
+		const auto makeAddress = [](const std::size_t index)
+		{
+			Network::Address address;
+			address.setType(Game::NA_IP);
+			address.setIP(static_cast<DWORD>(0x0A000000 + index));
+			address.setPort(28960);
+			return address;
+		};
+
+		std::lock_guard _(Session::Mutex);
+
+		// The first peer keeps talking, so the second one is the least recently active once the table is full
+		const auto start = Clock::now();
+		for (std::size_t i = 0; i <= MaxPeers; ++i)
+		{
+			GetPeer(makeAddress(i), start + std::chrono::milliseconds(i));
+			GetPeer(makeAddress(0), start + std::chrono::milliseconds(i));
+		}
+
+		const auto peersKept = Session::Peers.size() == MaxPeers && Session::Peers.contains(makeAddress(0)) && !Session::Peers.contains(makeAddress(1)) && Session::Peers.contains(makeAddress(MaxPeers));
+
+		for (std::size_t i = 0; i <= MaxLegacyPeers; ++i)
+		{
+			MarkLegacy(makeAddress(i), start + std::chrono::milliseconds(i));
+		}
+
+		const auto legacyKept = Session::LegacyPeers.size() == MaxLegacyPeers && !IsLegacy(makeAddress(0), start) && IsLegacy(makeAddress(1), start + LegacyTimeout)
+			&& !IsLegacy(makeAddress(1), start + LegacyTimeout + 1ms);
+
+		// A plain command from a peer that never answered a frame makes it an old client at once
+		Session::LegacyPeers.clear();
+		HandlePlain(makeAddress(0), start);
+		const auto plainKept = !Session::Peers.contains(makeAddress(0)) && IsLegacy(makeAddress(0), start);
+
+		Session::Peers.clear();
+		Session::LegacyPeers.clear();
+
+		if (!peersKept || !legacyKept || !plainKept)
+		{
+			printf("Error\n");
+			printf("Peer tables dropped the wrong entries (peers %s, old clients %s, plain commands %s)\n", peersKept ? "ok" : "wrong", legacyKept ? "ok" : "wrong", plainKept ? "ok" : "wrong");
+			return false;
+		}
+
 		printf("Success\n");
 		return true;
 	}
@@ -4,7 +4,8 @@
 #define SESSION_MAX_RETRIES 3
 #define SESSION_REQUEST_LIMIT 10
 
-#define DISABLE_SESSION
+// Sessions are sent over a reliable channel. Without this the old signed sessionSyn/sessionAck/sessionFin handshake is used
+#define SESSION_RELIABLE_CHANNEL
 
 namespace Components
 {
@@ -28,6 +29,102 @@ namespace Components
 			Utils::Time::Point creationPoint;
 		};
 
+		// Reliable delivery towards one peer. Messages get sequence numbers, are coalesced into frames
+		// and only resent when the peer's ack is missing. Doesn't touch the network, so it can be driven by any host
+		class Channel
+		{
+		public:
+			using Clock = std::chrono::steady_clock;
+
+			struct Message
+			{
+				std::string_view command;
+				std::string_view data;
+			};
+
+			struct Stats
+			{
+				std::uint64_t frames;
+				std::uint64_t bytes;
+				std::uint64_t retransmits;
+				std::uint64_t expired;
+			};
+
+			static constexpr std::size_t Window = 32;
+			static constexpr std::size_t Capacity = 64;
+			static constexpr std::size_t MaxFrameSize = 1300;
+			static constexpr std::uint8_t FrameVersion = 1;
+			static constexpr std::size_t HeaderSize = 13;
+			static constexpr std::size_t MessageHeaderSize = 5;
+
+			// The id tells the peer when we start over with fresh sequence numbers
+			explicit Channel(std::uint32_t id);
+
+			// Queues a message, false if too many messages are waiting for an ack
+			bool push(std::string_view command, std::string_view data);
+
+			// Handles a received frame and appends the new messages to delivered, they point into the frame.
+			// Returns false if the frame is malformed
+			bool receive(std::string_view frame, Clock::time_point now, std::vector<Message>& delivered);
+
+			// Writes the next frame that has to be sent, false if there is nothing to send right now
+			bool poll(Clock::time_point now, std::string& frame);
+
+			// Hands out every message that is still waiting for an ack, used when the peer turns out not to speak this protocol
+			void drain(const std::function<void(const Message&)>& callback);
+
+			[[nodiscard]] bool isIdle() const;
+			[[nodiscard]] bool isEstablished() const { return this->established_; }
+			[[nodiscard]] bool isUnreachable() const { return this->unreachable_; }
+			[[nodiscard]] const Stats& getStats() const { return this->stats_; }
+
+		private:
+			struct Slot
+			{
+				bool used;
+				bool sent;
+				std::uint8_t retries;
+				Clock::time_point sentAt;
+				Clock::time_point due;
+				std::string command;
+				std::string data;
+			};
+
+			static constexpr auto AckDelay = 20ms;
+			static constexpr auto InitialTimeout = 500ms;
+			static constexpr auto MinTimeout = 100ms;
+			static constexpr auto MaxTimeout = 4000ms;
+
+			// Retransmits before a message to a peer that answered before is dropped.
+			// A peer that never answered is given up on after SESSION_MAX_RETRIES instead, it probably runs an old client
+			static constexpr std::uint8_t MaxRetries = 6;
+
+			std::uint32_t id_;
+			std::optional<std::uint32_t> peerId_;
+
+			std::array<Slot, Capacity> slots_{};
+			std::uint16_t base_{};
+			std::uint16_t nextSeq_{};
+
+			std::uint16_t expected_{};
+			std::uint32_t receivedBits_{};
+			bool ackPending_{};
+			Clock::time_point ackDue_{};
+
+			std::optional<Clock::duration> srtt_;
+			Clock::duration rttvar_{};
+			Clock::duration rto_ = InitialTimeout;
+
+			bool established_{};
+			bool unreachable_{};
+			Stats stats_{};
+
+			void acknowledge(std::uint16_t ack, std::uint32_t bits, Clock::time_point now);
+			void advance();
+			void release(Slot& slot);
+			void sampleRtt(Clock::duration rtt);
+		};
+
 		Session();
 		~Session();
 
@@ -50,6 +147,35 @@ namespace Components
 
 		static std::queue<std::pair<Network::Address, std::string>> SignatureQueue;
 
+		struct Peer
+		{
+			explicit Peer(const std::uint32_t id) : channel(id) {}
+
+			Channel channel;
+			Channel::Clock::time_point lastActivity;
+		};
+
+		// Every peer costs a few KB of buffers and anyone can make us create one, the least recently active is dropped beyond this
+		static constexpr std::size_t MaxPeers = 1024;
+
+		// Peers that never answered a frame are remembered a lot longer than their channel is kept,
+		// so only the first command to an old client waits for the retries to run out
+		static constexpr std::size_t MaxLegacyPeers = 4096;
+		static constexpr auto LegacyTimeout = 30min;
+
+		static std::unordered_map<Network::Address, std::unique_ptr<Peer>> Peers;
+		static std::unordered_map<Network::Address, Channel::Clock::time_point> LegacyPeers;
+
+		static Peer& GetPeer(const Network::Address& address, Channel::Clock::time_point now);
+		static void DropPeer(const Network::Address& address, Peer& peer);
+		static bool IsLegacy(const Network::Address& address, Channel::Clock::time_point now);
+		static void MarkLegacy(const Network::Address& address, Channel::Clock::time_point now);
+		static void HandlePlain(const Network::Address& address, Channel::Clock::time_point now);
+
+		static void Flush();
+		static void HandleData(const Network::Address& address, const std::string& data);
+		static void Dispatch(const Network::Address& address, const std::string& command, const std::string& data);
+
 		static void RunFrame();
 		static void HandleSignatures();
 	};
@@ -3,7 +3,10 @@
 
 namespace Components
 {
+	const char* StringTable::CacheFolder = "players/stringtables";
+
 	std::unordered_map<std::string, Game::StringTable*> StringTable::StringTableMap;
+	std::unordered_map<const Game::StringTable*, std::vector<StringTable::IndexEntry>> StringTable::Indices;
 
 	Game::StringTable* StringTable::LoadObject(std::string filename)
 	{
@@ -11,52 +14,251 @@ namespace Components
 
 		filename = Utils::String::ToLower(filename);
 
-		Game::StringTable* table = nullptr;
 		FileSystem::File rawTable(filename);
-
-		if (rawTable.exists())
+		if (!rawTable.exists())
 		{
-			Utils::CSV parsedTable(rawTable.getBuffer(), false, false);
+			StringTableMap[filename] = nullptr;
+			return nullptr;
+		}
+
+		// Every table has a single cache file that records the hash of its source.
+		// An edited table doesn't match it anymore and overwrites it, so stale caches don't pile up
+		const auto& buffer = rawTable.getBuffer();
+		const auto cacheFile = std::format("{}/{}.bin", CacheFolder, Utils::Cryptography::SHA1::Compute(filename, true));
+		const auto sourceHash = Utils::Cryptography::SHA1::Compute(buffer);
 
-			table = allocator->allocate<Game::StringTable>();
+		std::string cached;
+		auto parsed = Utils::IO::ReadFile(cacheFile, &cached) ? Deserialize(cached, sourceHash) : std::nullopt;
 
-			if (table)
+		if (!parsed)
+		{
+			parsed = Parse(buffer, Game::StringTable_HashString);
+
+			Scheduler::Once([cacheFile, data = Serialize(*parsed, sourceHash)]
 			{
-				table->name = allocator->duplicateString(filename);
-				table->columnCount = static_cast<int>(parsedTable.getColumns());
-				table->rowCount = static_cast<int>(parsedTable.getRows());
+				Utils::IO::WriteFile(cacheFile, data);
+			}, Scheduler::Pipeline::ASYNC);
+		}
 
-				table->values = allocator->allocateArray<Game::StringTableCell>(table->columnCount * table->rowCount);
+		auto* table = allocator->allocate<Game::StringTable>();
+		auto* pool = allocator->allocateArray<char>(parsed->pool.size());
 
-				if (!table->values)
-				{
-					return nullptr;
-				}
+		table->name = allocator->duplicateString(filename);
+		table->columnCount = static_cast<int>(parsed->columnCount);
+		table->rowCount = static_cast<int>(parsed->rowCount);
+		table->values = allocator->allocateArray<Game::StringTableCell>(parsed->cells.size());
+
+		std::memcpy(pool, parsed->pool.data(), parsed->pool.size());
+
+		for (std::size_t i = 0; i < parsed->cells.size(); ++i)
+		{
+			const auto& string = parsed->strings[parsed->cells[i]];
+			table->values[i].string = pool + string.offset;
+			table->values[i].hash = string.hash;
+		}
+
+		// Lookups only happen on the main thread, so the index is handed over there instead of locking every lookup.
+		// Until then the table is scanned
+		Scheduler::Once([table, index = BuildIndex(table)]() mutable
+		{
+			Indices[table] = std::move(index);
+		}, Scheduler::Pipeline::MAIN);
+
+		StringTableMap[filename] = table;
+		return table;
+	}
 
-				for (int i = 0; i < table->rowCount; ++i)
+	StringTable::ParsedTable StringTable::Parse(const std::string& buffer, HashFunction hash)
+	{
+		ParsedTable table{};
+		table.pool.push_back('\0'); // Cells that are missing in short rows
+
+		// Looked up by the views the tokenizer hands out, a string is only built for new values
+		std::unordered_map<std::string, std::uint32_t, InternHash, std::equal_to<>> interned;
+		interned.emplace(std::string{}, 0);
+		table.strings.push_back({ 0, hash("") });
+
+		std::vector<std::size_t> rowStarts;
+		std::vector<std::uint32_t> cells;
+
+		Utils::CSV::Tokenizer tokenizer(buffer, false);
+		std::vector<std::string_view> row;
+
+		while (tokenizer.next(row))
+		{
+			rowStarts.push_back(cells.size());
+			table.columnCount = std::max(table.columnCount, static_cast<std::uint32_t>(row.size()));
+
+			for (const auto& cell : row)
+			{
+				auto entry = interned.find(cell);
+				if (entry == interned.end())
 				{
-					for (int j = 0; j < table->columnCount; ++j)
-					{
-						std::string value = parsedTable.getElementAt(i, j);
+					const auto offset = static_cast<std::uint32_t>(table.pool.size());
+					table.pool.append(cell);
+					table.pool.push_back('\0');
+					table.strings.push_back({ offset, hash(table.pool.data() + offset) });
 
-						Game::StringTableCell* cell = &table->values[i * table->columnCount + j];
-						cell->hash = Game::StringTable_HashString(value.data());
-						cell->string = allocator->duplicateString(value);
-						//if (!cell->string) cell->string = ""; // We have to assume it allocated successfully
-					}
+					entry = interned.emplace(std::string(cell), static_cast<std::uint32_t>(table.strings.size() - 1)).first;
 				}
 
-				StringTableMap[filename] = table;
+				cells.push_back(entry->second);
 			}
 		}
-		else
+
+		table.rowCount = static_cast<std::uint32_t>(rowStarts.size());
+		table.cells.assign(static_cast<std::size_t>(table.rowCount) * table.columnCount, 0);
+
+		for (std::size_t i = 0; i < rowStarts.size(); ++i)
 		{
-			StringTableMap[filename] = nullptr;
+			const auto end = i + 1 < rowStarts.size() ? rowStarts[i + 1] : cells.size();
+			std::copy(cells.begin() + rowStarts[i], cells.begin() + end, table.cells.begin() + i * table.columnCount);
+		}
+
+		return table;
+	}
+
+	std::string StringTable::Serialize(const ParsedTable& table, const std::string& sourceHash)
+	{
+		std::string data;
+
+		const auto write = [&data](const void* value, std::size_t size)
+		{
+			data.append(static_cast<const char*>(value), size);
+		};
+
+		const auto stringCount = static_cast<std::uint32_t>(table.strings.size());
+		const auto poolSize = static_cast<std::uint32_t>(table.pool.size());
+
+		write(&CacheMagic, sizeof(CacheMagic));
+		write(sourceHash.data(), SourceHashSize);
+		write(&table.columnCount, sizeof(table.columnCount));
+		write(&table.rowCount, sizeof(table.rowCount));
+		write(&stringCount, sizeof(stringCount));
+		write(&poolSize, sizeof(poolSize));
+		write(table.pool.data(), table.pool.size());
+		write(table.strings.data(), table.strings.size() * sizeof(ParsedString));
+		write(table.cells.data(), table.cells.size() * sizeof(std::uint32_t));
+
+		return data;
+	}
+
+	std::optional<StringTable::ParsedTable> StringTable::Deserialize(const std::string& data, const std::string& sourceHash)
+	{
+		std::size_t pos = 0;
+		const auto read = [&](void* out, std::size_t size)
+		{
+			if (pos + size > data.size()) return false;
+
+			std::memcpy(out, data.data() + pos, size);
+			pos += size;
+			return true;
+		};
+
+		ParsedTable table{};
+		std::uint32_t magic, stringCount, poolSize;
+		char cachedHash[SourceHashSize];
+
+		if (!read(&magic, sizeof(magic)) || magic != CacheMagic
+			|| !read(cachedHash, sizeof(cachedHash)) || sourceHash.size() != SourceHashSize || std::memcmp(cachedHash, sourceHash.data(), SourceHashSize)
+			|| !read(&table.columnCount, sizeof(table.columnCount)) || !read(&table.rowCount, sizeof(table.rowCount))
+			|| !read(&stringCount, sizeof(stringCount)) || !read(&poolSize, sizeof(poolSize)))
+		{
+			return {};
+		}
+
+		const auto cellCount = static_cast<std::uint64_t>(table.columnCount) * table.rowCount;
+		if (!poolSize || !stringCount || data.size() - pos != poolSize + static_cast<std::uint64_t>(stringCount) * sizeof(ParsedString) + cellCount * sizeof(std::uint32_t))
+		{
+			return {};
+		}
+
+		table.pool.resize(poolSize);
+		table.strings.resize(stringCount);
+		table.cells.resize(static_cast<std::size_t>(cellCount));
+
+		read(table.pool.data(), poolSize);
+		read(table.strings.data(), table.strings.size() * sizeof(ParsedString));
+		read(table.cells.data(), table.cells.size() * sizeof(std::uint32_t));
+
+		// Every string has to end inside the pool
+		if (table.pool.back() != '\0') return {};
+
+		const auto validString = [&](const ParsedString& string) { return string.offset < poolSize; };
+		const auto validCell = [&](std::uint32_t cell) { return cell < stringCount; };
+
+		if (!std::all_of(table.strings.begin(), table.strings.end(), validString) || !std::all_of(table.cells.begin(), table.cells.end(), validCell))
+		{
+			return {};
 		}
 
 		return table;
 	}
 
+	std::vector<StringTable::IndexEntry> StringTable::BuildIndex(const Game::StringTable* table)
+	{
+		std::vector<IndexEntry> index(static_cast<std::size_t>(table->columnCount) * table->rowCount);
+
+		for (auto column = 0; column < table->columnCount; ++column)
+		{
+			const auto begin = index.begin() + column * table->rowCount;
+
+			for (auto row = 0; row < table->rowCount; ++row)
+			{
+				begin[row] = { table->values[row * table->columnCount + column].hash, row };
+			}
+
+			std::sort(begin, begin + table->rowCount, [](const IndexEntry& a, const IndexEntry& b)
+			{
+				return a.hash != b.hash ? a.hash < b.hash : a.row < b.row;
+			});
+		}
+
+		return index;
+	}
+
+	int StringTable::FindRow(const std::vector<IndexEntry>& index, int rowCount, int column, int hash)
+	{
+		const auto begin = index.begin() + column * rowCount;
+		const auto end = begin + rowCount;
+
+		// The first entry with the hash has the lowest row, which is what a scan would find first
+		const auto entry = std::lower_bound(begin, end, hash, [](const IndexEntry& entry, int value)
+		{
+			return entry.hash < value;
+		});
+
+		return entry != end && entry->hash == hash ? entry->row : -1;
+	}
+
+	int StringTable::StringTable_LookupRowNumForValue_Hk(const Game::StringTable* table, int comparisonColumn, const char* value)
+	{
+		if (!table || comparisonColumn < 0 || comparisonColumn >= table->columnCount)
+		{
+			return -1;
+		}
+
+		// Rows are matched on the hash alone, like the game does
+		const auto hash = Game::StringTable_HashString(value);
+
+		const auto index = Indices.find(table);
+		if (index != Indices.end())
+		{
+			return FindRow(index->second, table->rowCount, comparisonColumn, hash);
+		}
+
+		// Tables from fastfiles come and go with their zones, so they are scanned
+		for (auto row = 0; row < table->rowCount; ++row)
+		{
+			if (table->values[row * table->columnCount + comparisonColumn].hash == hash)
+			{
+				return row;
+			}
+		}
+
+		return -1;
+	}
+
 	StringTable::StringTable()
 	{
 		AssetHandler::OnFind(Game::XAssetType::ASSET_TYPE_STRINGTABLE, [](Game::XAssetType, const std::string& _filename)
@@ -76,5 +278,455 @@ namespace Components
 
 			return header;
 		});
+
+		Utils::Hook(Game::StringTable_LookupRowNumForValue, StringTable_LookupRowNumForValue_Hk, HOOK_JUMP).install()->quick();
+	}
+
+	bool StringTable::TestAllocator()
+	{
+		// Loading a 50k cell table and unloading a fifth of it, the old vector backed allocator against the arena
+		struct LegacyAllocator
+		{
+			std::mutex mutex;
+			std::vector<void*> pool;
+
+			char* duplicateString(const std::string& string)
+			{
+				std::lock_guard _(this->mutex);
+
+				auto* data = Utils::Memory::DuplicateString(string);
+				this->pool.push_back(data);
+				return data;
+			}
+
+			void free(void* data)
+			{
+				std::lock_guard _(this->mutex);
+
+				const auto i = std::find(this->pool.begin(), this->pool.end(), data);
+				if (i != this->pool.end())
+				{
+					Utils::Memory::Free(data);
+					this->pool.erase(i);
+				}
+			}
+
+			void clear()
+			{
+				std::lock_guard _(this->mutex);
+
+				for (auto* data : this->pool)
+				{
+					Utils::Memory::Free(data);
+				}
+
+				this->pool.clear();
+			}
+		};
+
+		constexpr std::size_t cellCount = 50000;
+		constexpr std::size_t freeStride = 5;
+
+		std::vector<std::string> cells;
+		cells.reserve(cellCount);
+		for (std::size_t i = 0; i < cellCount; ++i)
+		{
+			cells.emplace_back(std::format("cell_{}{}", (i * 7919) % 100000, std::string(i % 13, 'x')));
+		}
+
+		// Returns false if a cell that wasn't freed got corrupted
+		const auto measure = [&]<typename T>(T& allocator, std::chrono::microseconds (&times)[3])
+		{
+			std::vector<char*> strings(cells.size());
+
+			times[0] = Utils::Time::Measure([&]
+			{
+				for (std::size_t i = 0; i < cells.size(); ++i)
+				{
+					strings[i] = allocator.duplicateString(cells[i]);
+				}
+			});
+
+			times[1] = Utils::Time::Measure([&]
+			{
+				for (std::size_t i = 0; i < cells.size(); i += freeStride)
+				{
+					allocator.free(strings[i]);
+					strings[i] = nullptr;
+				}
+			});
+
+			auto intact = true;
+			for (std::size_t i = 0; i < cells.size(); ++i)
+			{
+				if (strings[i] && cells[i] != strings[i]) intact = false;
+			}
+
+			times[2] = Utils::Time::Measure([&]
+			{
+				allocator.clear();
+			});
+
+			return intact;
+		};
+
+		LegacyAllocator legacyAllocator;
+		Utils::Memory::Allocator arenaAllocator;
+		std::chrono::microseconds legacy[3], arena[3];
+
+		if (!measure(legacyAllocator, legacy) || !measure(arenaAllocator, arena) || !arenaAllocator.empty())
+		{
+			Logger::PrintError(Game::CON_CHANNEL_ERROR, "String table cells were corrupted by the allocator\n");
+			return false;
+		}
+
+		Logger::Print("Allocating {} cells: {}us legacy, {}us arena\n", cellCount, legacy[0].count(), arena[0].count());
+		Logger::Print("Freeing {} cells: {}us legacy, {}us arena\n", cellCount / freeStride, legacy[1].count(), arena[1].count());
+		Logger::Print("Clearing: {}us legacy, {}us arena\n", legacy[2].count(), arena[2].count());
+
+		// Most allocators only live for a single small table, creating and destroying one has to cost about as much as the heap
+		constexpr std::size_t cycles = 20000;
+		constexpr std::size_t cycleAllocations = 8;
+
+		const auto heapCycles = Utils::Time::Measure([]
+		{
+			void* blocks[cycleAllocations];
+			for (std::size_t i = 0; i < cycles; ++i)
+			{
+				for (std::size_t j = 0; j < cycleAllocations; ++j) blocks[j] = Utils::Memory::Allocate(16 + j * 8);
+				for (std::size_t j = 0; j < cycleAllocations; ++j) Utils::Memory::Free(blocks[j]);
+			}
+		});
+
+		auto cyclesIntact = true;
+		const auto allocatorCycles = Utils::Time::Measure([&]
+		{
+			for (std::size_t i = 0; i < cycles; ++i)
+			{
+				Utils::Memory::Allocator allocator;
+				for (std::size_t j = 0; j < cycleAllocations; ++j) allocator.allocate(16 + j * 8);
+				if (allocator.empty()) cyclesIntact = false;
+			}
+		});
+
+		if (!cyclesIntact)
+		{
+			Logger::PrintError(Game::CON_CHANNEL_ERROR, "Short lived allocator lost track of its blocks\n");
+			return false;
+		}
+
+		Logger::Print("{} construct, allocate and destroy cycles: {}us heap, {}us allocator\n", cycles, heapCycles.count(), allocatorCycles.count());
+
+		// Threads allocating and freeing at once must never get overlapping or dirty blocks
+		std::atomic<bool> failed = false;
+		std::vector<std::thread> threads;
+
+		for (auto t = 0; t < 4; ++t)
+		{
+			threads.emplace_back([&arenaAllocator, &failed, t]
+			{
+				std::mt19937 random(t);
+				std::vector<std::pair<unsigned char*, std::size_t>> blocks;
+
+				const auto check = [&](const unsigned char* data, std::size_t length, unsigned char value)
+				{
+					if (!Utils::Memory::IsSet(const_cast<unsigned char*>(data), static_cast<char>(value), length))
+					{
+						failed = true;
+					}
+				};
+
+				for (auto i = 0; i < 20000; ++i)
+				{
+					if (blocks.empty() || random() % 3)
+					{
+						const auto length = random() % 3000 + 1;
+						auto* data = static_cast<unsigned char*>(arenaAllocator.allocate(length));
+
+						check(data, length, 0);
+						std::memset(data, t + 1, length);
+						blocks.emplace_back(data, length);
+					}
+					else
+					{
+						const auto index = random() % blocks.size();
+						check(blocks[index].first, blocks[index].second, static_cast<unsigned char>(t + 1));
+
+						arenaAllocator.free(blocks[index].first);
+						blocks[index] = blocks.back();
+						blocks.pop_back();
+					}
+				}
+
+				for (const auto& [data, length] : blocks)
+				{
+					check(data, length, static_cast<unsigned char>(t + 1));
+					arenaAllocator.free(data);
+				}
+			});
+		}
+
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+
+		if (failed || !arenaAllocator.empty())
+		{
+			Logger::PrintError(Game::CON_CHANNEL_ERROR, "Allocator handed out overlapping or dirty blocks\n");
+			return false;
+		}
+
+		return true;
+	}
+
+	bool StringTable::TestParse()
+	{
+		// The interning parser has to produce exactly what Utils::CSV does
+		std::string csv = "name,\"quoted, \\\"value\\\"\",\t tab\r\n\n\"\"\nshort\n,\nlast,row,has,more\n\"unterminated\nnewline,at,end";
+		for (std::size_t i = 0; i < 5000; ++i)
+		{
+			csv.append(std::format("\nweapon_{},{},{},attachment_{},{}", i, i % 7, i * 13 % 1000, i % 31, i % 2 ? "\"a,b\"" : ""));
+		}
+
+		// A weak hash, so the index has to deal with collisions
+		const auto lengthHash = [](const char* string) { return static_cast<int>(std::strlen(string)); };
+
+		std::size_t csvRows = 0, csvColumns = 0;
+		std::vector<std::string> csvCells;
+
+		const auto csvParse = Utils::Time::Measure([&]
+		{
+			const Utils::CSV csvTable(csv, false, false);
+			csvRows = csvTable.getRows();
+			csvColumns = csvTable.getColumns();
+
+			for (std::size_t row = 0; row < csvRows; ++row)
+			{
+				for (std::size_t column = 0; column < csvColumns; ++column)
+				{
+					csvCells.emplace_back(csvTable.getElementAt(row, column));
+				}
+			}
+		});
+
+		ParsedTable parsed;
+		const auto internedParse = Utils::Time::Measure([&]
+		{
+			parsed = Parse(csv, lengthHash);
+		});
+
+		if (parsed.rowCount != csvRows || parsed.columnCount != csvColumns || parsed.cells.size() != csvCells.size())
+		{
+			Logger::PrintError(Game::CON_CHANNEL_ERROR, "Parsed string table has {}x{} cells, expected {}x{}\n", parsed.rowCount, parsed.columnCount, csvRows, csvColumns);
+			return false;
+		}
+
+		for (std::size_t i = 0; i < csvCells.size(); ++i)
+		{
+			const auto& string = parsed.strings[parsed.cells[i]];
+			if (csvCells[i] != parsed.pool.data() + string.offset || string.hash != lengthHash(csvCells[i].data()))
+			{
+				Logger::PrintError(Game::CON_CHANNEL_ERROR, "String table cell {} is '{}', expected '{}'\n", i, parsed.pool.data() + string.offset, csvCells[i]);
+				return false;
+			}
+		}
+
+		Logger::Print("Parsing {} cells: {}us Utils::CSV, {}us interned, {} distinct values\n", csvCells.size(), csvParse.count(), internedParse.count(), parsed.strings.size());
+
+		const auto sourceHash = Utils::Cryptography::SHA1::Compute(csv);
+		auto serialized = Serialize(parsed, sourceHash);
+		const auto deserialized = Deserialize(serialized, sourceHash);
+		if (!deserialized || deserialized->pool != parsed.pool || deserialized->cells != parsed.cells || deserialized->strings.size() != parsed.strings.size())
+		{
+			Logger::PrintError(Game::CON_CHANNEL_ERROR, "String table cache did not round trip\n");
+			return false;
+		}
+
+		if (Deserialize(serialized, Utils::Cryptography::SHA1::Compute(csv + "\n")))
+		{
+			Logger::PrintError(Game::CON_CHANNEL_ERROR, "String table cache of an edited table was accepted\n");
+			return false;
+		}
+
+		serialized.pop_back();
+		if (Deserialize(serialized, sourceHash) || Deserialize({}, sourceHash))
+		{
+			Logger::PrintError(Game::CON_CHANNEL_ERROR, "Truncated string table cache was accepted\n");
+			return false;
+		}
+
+		// Index lookups against a scan of the table
+		std::vector<Game::StringTableCell> values(parsed.cells.size());
+		for (std::size_t i = 0; i < values.size(); ++i)
+		{
+			values[i] = { parsed.pool.data() + parsed.strings[parsed.cells[i]].offset, parsed.strings[parsed.cells[i]].hash };
+		}
+
+		const Game::StringTable table{ "test", static_cast<int>(parsed.columnCount), static_cast<int>(parsed.rowCount), values.data() };
+		const auto index = BuildIndex(&table);
+
+		for (auto column = 0; column < table.columnCount; ++column)
+		{
+			for (auto hash = -1; hash < 32; ++hash)
+			{
+				auto expected = -1;
+				for (auto row = 0; row < table.rowCount && expected < 0; ++row)
+				{
+					if (table.values[row * table.columnCount + column].hash == hash) expected = row;
+				}
+
+				if (FindRow(index, table.rowCount, column, hash) != expected)
+				{
+					Logger::PrintError(Game::CON_CHANNEL_ERROR, "String table index found the wrong row for hash {} in column {}\n", hash, column);
+					return false;
+				}
+			}
+		}
+
+		return true;
+	}
+
+	bool StringTable::TestTokenizer()
+	{
+		// The parser Utils::CSV had before the tokenizer, every row split off and built one character at a time
+		const auto legacyParse = [](const std::string& buffer, bool allowComments)
+		{
+			std::vector<std::vector<std::string>> rows;
+
+			for (const auto& line : Utils::String::Split(buffer, '\n'))
+			{
+				auto isString = false, comment = false;
+				std::string element;
+				std::vector<std::string> row;
+
+				for (std::size_t i = 0; i < line.size() && !comment; ++i)
+				{
+					if (line[i] == ',' && !isString)
+					{
+						row.push_back(element);
+						element.clear();
+					}
+					else if (line[i] == '"')
+					{
+						isString = !isString;
+					}
+					else if (i < line.size() - 1 && line[i] == '\\' && line[i + 1] == '"' && isString)
+					{
+						element.push_back('"');
+						++i;
+					}
+					else if (!isString && (line[i] == '\r' || line[i] == '\t'))
+					{
+					}
+					else if (!isString && (line[i] == '#' || (line[i] == '/' && i + 1 < line.size() && line[i + 1] == '/')) && allowComments)
+					{
+						comment = true;
+					}
+					else
+					{
+						element.push_back(line[i]);
+					}
+				}
+
+				row.push_back(element);
+
+				if (!comment && (row.size() != 1 || !row[0].empty()))
+				{
+					rows.push_back(std::move(row));
+				}
+			}
+
+			return rows;
+		};
+
+		const auto tokenize = [](const std::string& buffer, bool allowComments)
+		{
+			std::vector<std::vector<std::string>> rows;
+
+			Utils::CSV::Tokenizer tokenizer(buffer, allowComments);
+			std::vector<std::string_view> row;
+
+			while (tokenizer.next(row))
+			{
+				rows.emplace_back(row.begin(), row.end());
+			}
+
+			return rows;
+		};
+
+		// Random buffers made of the characters the parser cares about
+		constexpr char alphabet[] = { 'a', 'b', ' ', ',', ',', '"', '"', '\\', '\r', '\t', '\n', '\n', '#', '/' };
+		std::mt19937 random(1337);
+
+		for (auto i = 0; i < 20000; ++i)
+		{
+			std::string buffer(random() % 120, '\0');
+			for (auto& c : buffer)
+			{
+				c = alphabet[random() % std::size(alphabet)];
+			}
+
+			const auto allowComments = (i % 2) == 0;
+			const auto expected = legacyParse(buffer, allowComments);
+			const Utils::CSV table(buffer, false, allowComments);
+
+			auto matches = tokenize(buffer, allowComments) == expected && table.getRows() == expected.size();
+			for (std::size_t row = 0; row < expected.size() && matches; ++row)
+			{
+				matches = table.getColumns(row) == expected[row].size();
+				for (std::size_t column = 0; column < expected[row].size() && matches; ++column)
+				{
+					matches = table.getElementAt(row, column) == expected[row][column];
+				}
+			}
+
+			if (!matches)
+			{
+				Logger::PrintError(Game::CON_CHANNEL_ERROR, "CSV tokenizer disagrees with the old parser on '{}'\n", Utils::String::DumpHex(buffer, {}));
+				return false;
+			}
+		}
+
+		// Throughput on a CRLF table with a quoted column, the shape of most mod tables
+		std::string csv;
+		for (auto i = 0; csv.size() < 8 * 1024 * 1024; ++i)
+		{
+			csv.append(std::format("weapon_{},{},\"Weapon {}, \\\"mk{}\\\"\",{},{}\r\n", i, i % 7, i, i % 3, i * 13 % 1000, i % 2 ? "" : "silencer"));
+		}
+
+		const auto throughput = [&csv](const std::function<std::size_t()>& parse)
+		{
+			std::size_t rows = 0;
+			const auto elapsed = Utils::Time::Measure<std::chrono::duration<double>>([&] { rows = parse(); });
+
+			return std::make_pair(rows, static_cast<double>(csv.size()) / (1024 * 1024) / std::max(elapsed.count(), 1e-9));
+		};
+
+		const auto legacy = throughput([&] { return legacyParse(csv, true).size(); });
+		const auto streamed = throughput([&]
+		{
+			Utils::CSV::Tokenizer tokenizer(csv);
+			std::vector<std::string_view> row;
+
+			std::size_t rows = 0;
+			while (tokenizer.next(row)) ++rows;
+			return rows;
+		});
+		const auto table = throughput([&] { return Utils::CSV(csv, false).getRows(); });
+
+		if (legacy.first != streamed.first || legacy.first != table.first)
+		{
+			Logger::PrintError(Game::CON_CHANNEL_ERROR, "CSV benchmark parsed {} / {} / {} rows\n", legacy.first, streamed.first, table.first);
+			return false;
+		}
+
+		Logger::Print("Parsing CSV: {:.1f} MB/s old parser, {:.1f} MB/s tokenizer, {:.1f} MB/s Utils::CSV\n", legacy.second, streamed.second, table.second);
+		return true;
+	}
+
+	bool StringTable::unitTest()
+	{
+		return TestAllocator() && TestParse() && TestTokenizer();
 	}
 }
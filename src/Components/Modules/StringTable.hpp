@@ -7,9 +7,66 @@ namespace Components
 	public:
 		StringTable();
 
+		bool unitTest() override;
+
 	private:
+		struct ParsedString
+		{
+			std::uint32_t offset;
+			std::int32_t hash;
+		};
+
+		// Distinct cell values are stored once in the pool, cells refer to them by index
+		struct ParsedTable
+		{
+			std::uint32_t columnCount;
+			std::uint32_t rowCount;
+			std::string pool;
+			std::vector<ParsedString> strings;
+			std::vector<std::uint32_t> cells;
+		};
+
+		struct IndexEntry
+		{
+			int hash;
+			int row;
+		};
+
+		struct InternHash
+		{
+			using is_transparent = void;
+
+			std::size_t operator()(std::string_view string) const
+			{
+				return std::hash<std::string_view>{}(string);
+			}
+		};
+
+		using HashFunction = int(*)(const char* string);
+
+		static constexpr std::uint32_t CacheMagic = 0x32435453; // STC2
+		static constexpr std::size_t SourceHashSize = 20;
+		static const char* CacheFolder;
+
 		static std::unordered_map<std::string, Game::StringTable*> StringTableMap;
 
+		// Per table, every column sorted by hash and then row. Main thread only
+		static std::unordered_map<const Game::StringTable*, std::vector<IndexEntry>> Indices;
+
 		static Game::StringTable* LoadObject(std::string filename);
+
+		static ParsedTable Parse(const std::string& buffer, HashFunction hash);
+		// The cache starts with the SHA1 of the source, a cache of a different source is rejected
+		static std::string Serialize(const ParsedTable& table, const std::string& sourceHash);
+		static std::optional<ParsedTable> Deserialize(const std::string& data, const std::string& sourceHash);
+
+		static std::vector<IndexEntry> BuildIndex(const Game::StringTable* table);
+		static int FindRow(const std::vector<IndexEntry>& index, int rowCount, int column, int hash);
+
+		static bool TestAllocator();
+		static bool TestParse();
+		static bool TestTokenizer();
+
+		static int StringTable_LookupRowNumForValue_Hk(const Game::StringTable* table, int comparisonColumn, const char* value);
 	};
 }
@@ -6,8 +6,18 @@
 
 namespace Components
 {
-	Game::VoicePacket_t Voice::VoicePackets[Game::MAX_CLIENTS][MAX_SERVER_QUEUED_VOICE_PACKETS];
+	Voice::SharedVoicePacket Voice::VoicePacketPool[VOICE_PACKET_POOL_SIZE];
+	std::uint16_t Voice::FreeVoicePackets[VOICE_PACKET_POOL_SIZE];
+	int Voice::FreeVoicePacketCount;
+
+	std::uint16_t Voice::VoiceQueue[Game::MAX_CLIENTS][MAX_SERVER_QUEUED_VOICE_PACKETS];
 	int Voice::VoicePacketCount[Game::MAX_CLIENTS];
+	std::uint32_t Voice::PendingVoiceClients;
+
+	std::uint32_t Voice::ListenerMasks[Game::MAX_CLIENTS];
+	std::optional<int> Voice::ListenerMaskTime;
+
+	unsigned char Voice::VoiceMsgBuf[VOICE_MSG_BUF_SIZE];
 
 	bool Voice::MuteList[Game::MAX_CLIENTS];
 	bool Voice::S_PlayerMute[Game::MAX_CLIENTS];
@@ -27,12 +37,14 @@ namespace Components
 		Game::MSG_WriteByte(msg, VoicePacketCount[clientNum]);
 		for (auto packet = 0; packet < VoicePacketCount[clientNum]; ++packet)
 		{
-			Game::MSG_WriteByte(msg, VoicePackets[clientNum][packet].talker);
+			const auto& voicePacket = VoicePacketPool[VoiceQueue[clientNum][packet]].packet;
+
+			Game::MSG_WriteByte(msg, voicePacket.talker);
 
-			assert(VoicePackets[clientNum][packet].dataSize < (2 << 15));
+			assert(voicePacket.dataSize < (2 << 15));
 
-			Game::MSG_WriteByte(msg, VoicePackets[clientNum][packet].dataSize);
-			Game::MSG_WriteData(msg, VoicePackets[clientNum][packet].data, VoicePackets[clientNum][packet].dataSize);
+			Game::MSG_WriteByte(msg, voicePacket.dataSize);
+			Game::MSG_WriteData(msg, voicePacket.data, voicePacket.dataSize);
 		}
 
 		assert(!msg->overflowed);
@@ -40,17 +52,18 @@ namespace Components
 
 	void Voice::SV_SendClientVoiceData(Game::client_s* client)
 	{
-		Game::msg_t msg{};
 		const auto clientNum = client - Game::svs_clients;
 
-		const auto msg_buf_large = std::make_unique<unsigned char[]>(0x20000);
-		auto* msg_buf = msg_buf_large.get();
+		// Most clients have nothing queued, don't touch anything for them
+		if (!(PendingVoiceClients & (1u << clientNum))) return;
 
-		assert(VoicePacketCount[clientNum] >= 0);
+		assert(VoicePacketCount[clientNum] > 0);
 
-		if (client->header.state == Game::CS_ACTIVE && VoicePacketCount[clientNum])
+		if (client->header.state == Game::CS_ACTIVE)
 		{
-			Game::MSG_Init(&msg, msg_buf, 0x20000);
+			// Voice data is sent right away, so every client can share one buffer
+			Game::msg_t msg{};
+			Game::MSG_Init(&msg, VoiceMsgBuf, sizeof(VoiceMsgBuf));
 
 			assert(msg.cursize == 0);
 			assert(msg.bit == 0);
@@ -65,7 +78,7 @@ namespace Components
 			else
 			{
 				Game::NET_OutOfBandVoiceData(Game::NS_SERVER, client->header.netchan.remoteAddress, msg.data, msg.cursize, true);
-				VoicePacketCount[clientNum] = 0;
+				SV_ReleaseVoicePackets(clientNum);
 			}
 		}
 	}
@@ -81,18 +94,21 @@ namespace Components
 	void Voice::SV_ClearMutedList()
 	{
 		std::memset(MuteList, 0, sizeof(MuteList));
+		ListenerMaskTime.reset();
 	}
 
 	void Voice::SV_MuteClient(const int muteClientIndex)
 	{
 		AssertIn(muteClientIndex, Game::MAX_CLIENTS);
 		MuteList[muteClientIndex] = true;
+		ListenerMaskTime.reset();
 	}
 
 	void Voice::SV_UnmuteClient(const int muteClientIndex)
 	{
 		AssertIn(muteClientIndex, Game::MAX_CLIENTS);
 		MuteList[muteClientIndex] = false;
+		ListenerMaskTime.reset();
 	}
 
 	bool Voice::SV_ServerHasClientMuted(const int talker)
@@ -116,38 +132,110 @@ namespace Components
 		return false;
 	}
 
-	void Voice::SV_QueueVoicePacket(const int talkerNum, const int clientNum, const Game::VoicePacket_t* voicePacket)
+	bool Voice::CanHearTalker(const Game::gentity_s* talker, const Game::gentity_s* ent)
 	{
-		assert(talkerNum >= 0);
-		assert(clientNum >= 0);
-		assert(talkerNum < (*Game::sv_maxclients)->current.integer);
-		assert(clientNum < (*Game::sv_maxclients)->current.integer);
+		const auto* client = ent->client;
 
-		if (VoicePacketCount[clientNum] < MAX_SERVER_QUEUED_VOICE_PACKETS)
+		return ent->r.isInUse && client && (client->sess.sessionState == Game::SESS_STATE_INTERMISSION || OnSameTeam(talker, ent) || talker->client->sess.cs.team == Game::TEAM_FREE) &&
+			(ent->client->sess.sessionState == talker->client->sess.sessionState || (ent->client->sess.sessionState == Game::SESS_STATE_DEAD || talker->client->sess.sessionState == Game::SESS_STATE_DEAD) &&
+				(*Game::g_deadChat)->current.enabled) && (talker != ent);
+	}
+
+	void Voice::UpdateListenerMasks()
+	{
+		if (ListenerMaskTime == *Game::svs_time) return;
+		ListenerMaskTime = *Game::svs_time;
+
+		const auto maxClients = (*Game::sv_maxclients)->current.integer;
+		for (auto talkerNum = 0; talkerNum < maxClients; ++talkerNum)
 		{
-			VoicePackets[clientNum][VoicePacketCount[clientNum]].dataSize = voicePacket->dataSize;
-			std::memcpy(VoicePackets[clientNum][VoicePacketCount[clientNum]].data, voicePacket->data, voicePacket->dataSize);
+			ListenerMasks[talkerNum] = 0;
+
+			const auto* talker = &Game::g_entities[talkerNum];
+			if (!talker->r.isInUse || !talker->client || SV_ServerHasClientMuted(talkerNum)) continue;
+
+			for (auto otherPlayer = 0; otherPlayer < maxClients; ++otherPlayer)
+			{
+				if (CanHearTalker(talker, &Game::g_entities[otherPlayer]))
+				{
+					ListenerMasks[talkerNum] |= 1u << otherPlayer;
+				}
+			}
+		}
+	}
 
-			assert(talkerNum == static_cast<std::uint8_t>(talkerNum));
-			VoicePackets[clientNum][VoicePacketCount[clientNum]].talker = static_cast<char>(talkerNum);
-			++VoicePacketCount[clientNum];
+	void Voice::SV_InitVoicePackets()
+	{
+		std::memset(VoicePacketPool, 0, sizeof(VoicePacketPool));
+		std::memset(VoicePacketCount, 0, sizeof(VoicePacketCount));
+		PendingVoiceClients = 0;
+
+		for (auto i = 0; i < VOICE_PACKET_POOL_SIZE; ++i)
+		{
+			FreeVoicePackets[i] = static_cast<std::uint16_t>(VOICE_PACKET_POOL_SIZE - 1 - i);
 		}
+
+		FreeVoicePacketCount = VOICE_PACKET_POOL_SIZE;
 	}
 
-	void Voice::G_BroadcastVoice(Game::gentity_s* talker, const Game::VoicePacket_t* voicePacket)
+	void Voice::SV_QueueVoicePacket(const int talkerNum, std::uint32_t listeners, const Game::VoicePacket_t* voicePacket)
 	{
-		for (auto otherPlayer = 0; otherPlayer < (*Game::sv_maxclients)->current.integer; ++otherPlayer)
+		AssertIn(talkerNum, Game::MAX_CLIENTS);
+
+		// Full queues drop the packet, like they always did
+		for (auto pending = listeners; pending; pending &= pending - 1)
+		{
+			const auto clientNum = std::countr_zero(pending);
+			if (VoicePacketCount[clientNum] >= MAX_SERVER_QUEUED_VOICE_PACKETS) listeners &= ~(1u << clientNum);
+		}
+
+		if (!listeners) return;
+
+		assert(FreeVoicePacketCount > 0);
+		const auto index = FreeVoicePackets[--FreeVoicePacketCount];
+
+		auto& shared = VoicePacketPool[index];
+		shared.packet.dataSize = voicePacket->dataSize;
+		std::memcpy(shared.packet.data, voicePacket->data, voicePacket->dataSize);
+
+		assert(talkerNum == static_cast<std::uint8_t>(talkerNum));
+		shared.packet.talker = static_cast<char>(talkerNum);
+		shared.refs = std::popcount(listeners);
+
+		for (auto pending = listeners; pending; pending &= pending - 1)
 		{
-			auto* ent = &Game::g_entities[otherPlayer];
-			auto* client = ent->client;
+			const auto clientNum = std::countr_zero(pending);
+			VoiceQueue[clientNum][VoicePacketCount[clientNum]++] = index;
+		}
 
-			if (ent->r.isInUse && client && (client->sess.sessionState == Game::SESS_STATE_INTERMISSION || OnSameTeam(talker, ent) || talker->client->sess.cs.team == Game::TEAM_FREE) &&
-				(ent->client->sess.sessionState == talker->client->sess.sessionState || (ent->client->sess.sessionState == Game::SESS_STATE_DEAD || talker->client->sess.sessionState == Game::SESS_STATE_DEAD) &&
-					(*Game::g_deadChat)->current.enabled) && (talker != ent) && !SV_ServerHasClientMuted(talker->s.number))
+		PendingVoiceClients |= listeners;
+	}
+
+	void Voice::SV_ReleaseVoicePackets(const int clientNum)
+	{
+		AssertIn(clientNum, Game::MAX_CLIENTS);
+
+		for (auto packet = 0; packet < VoicePacketCount[clientNum]; ++packet)
+		{
+			const auto index = VoiceQueue[clientNum][packet];
+			if (--VoicePacketPool[index].refs == 0)
 			{
-				SV_QueueVoicePacket(talker->s.number, otherPlayer, voicePacket);
+				FreeVoicePackets[FreeVoicePacketCount++] = index;
 			}
 		}
+
+		VoicePacketCount[clientNum] = 0;
+		PendingVoiceClients &= ~(1u << clientNum);
+	}
+
+	void Voice::G_BroadcastVoice(Game::gentity_s* talker, const Game::VoicePacket_t* voicePacket)
+	{
+		UpdateListenerMasks();
+
+		const auto talkerNum = talker->s.number;
+		AssertIn(talkerNum, (*Game::sv_maxclients)->current.integer);
+
+		SV_QueueVoicePacket(talkerNum, ListenerMasks[talkerNum], voicePacket);
 	}
 
 	void Voice::SV_UserVoice(Game::client_s* cl, Game::msg_t* msg)
@@ -209,13 +297,18 @@ namespace Components
 			assert(voicePacket.data);
 
 			Game::MSG_ReadData(msg, voicePacket.data, voicePacket.dataSize);
+			if (SV_ServerHasClientMuted(talker)) continue;
+
+			std::uint32_t listeners = 0;
 			for (auto otherPlayer = 0; otherPlayer < (*Game::sv_maxclients)->current.integer; ++otherPlayer)
 			{
-				if (otherPlayer != talker && Game::svs_clients[otherPlayer].header.state >= Game::CS_CONNECTED && !SV_ServerHasClientMuted(talker))
+				if (otherPlayer != talker && Game::svs_clients[otherPlayer].header.state >= Game::CS_CONNECTED)
 				{
-					SV_QueueVoicePacket(talker, otherPlayer, &voicePacket);
+					listeners |= 1u << otherPlayer;
 				}
 			}
+
+			SV_QueueVoicePacket(talker, listeners, &voicePacket);
 		}
 	}
 
@@ -385,14 +478,19 @@ namespace Components
 	{
 		AssertOffset(Game::clientUIActive_t, connectionState, 0x9B8);
 
-		std::memset(VoicePackets, 0, sizeof(VoicePackets));
-		std::memset(VoicePacketCount, 0, sizeof(VoicePacketCount));
+		SV_InitVoicePackets();
 
 		SV_ClearMutedList();
 		CL_ClearMutedList();
 
 		Events::OnSteamDisconnect(CL_ClearMutedList);
-		Events::OnClientDisconnect(SV_UnmuteClient);
+		Events::OnClientDisconnect([](const int clientNum) -> void
+		{
+			SV_UnmuteClient(clientNum);
+
+			// Don't hand the voice of the previous client to whoever gets this slot next
+			SV_ReleaseVoicePackets(clientNum);
+		});
 		Events::OnClientConnect([](const Game::client_s* cl) -> void
 		{
 			if (Chat::IsMuted(cl))
@@ -425,4 +523,126 @@ namespace Components
 
 		sv_voice = Game::Dvar_RegisterBool("sv_voice", false, Game::DVAR_NONE, "Use server side voice communications");
 	}
+
+	bool Voice::unitTest()
+	{
+		// Server frames where 18 talkers send a few packets each, the old per-recipient copies against the shared pool
+		constexpr auto clients = static_cast<int>(Game::MAX_CLIENTS);
+		constexpr auto packetsPerTalker = 3;
+		constexpr auto frames = 200;
+		constexpr auto mutedTalker = 5;
+
+		Game::VoicePacket_t voicePacket{};
+		voicePacket.dataSize = 120;
+		for (auto i = 0; i < voicePacket.dataSize; ++i)
+		{
+			voicePacket.data[i] = static_cast<char>(i * 7);
+		}
+
+		// Same bytes MSG_WriteByte and MSG_WriteData produce
+		const auto writePacket = [](unsigned char* buf, std::size_t& pos, const Game::VoicePacket_t& packet)
+		{
+			buf[pos++] = static_cast<unsigned char>(packet.talker);
+			buf[pos++] = static_cast<unsigned char>(packet.dataSize);
+			std::memcpy(buf + pos, packet.data, packet.dataSize);
+			pos += packet.dataSize;
+		};
+
+		std::vector<std::string> legacyMessages(clients), pooledMessages(clients);
+		std::uint64_t legacyBytes = 0, pooledBytes = 0;
+
+		const auto legacyPackets = std::make_unique<Game::VoicePacket_t[]>(clients * MAX_SERVER_QUEUED_VOICE_PACKETS);
+		int legacyCount[Game::MAX_CLIENTS]{};
+
+		const auto legacyStart = std::chrono::high_resolution_clock::now();
+		for (auto frame = 0; frame < frames; ++frame)
+		{
+			for (auto talker = 0; talker < clients; ++talker)
+			{
+				for (auto packet = 0; packet < packetsPerTalker; ++packet)
+				{
+					for (auto other = 0; other < clients; ++other)
+					{
+						// The team and mute checks ran here for every packet and client
+						if (other == talker || talker == mutedTalker || legacyCount[other] >= MAX_SERVER_QUEUED_VOICE_PACKETS) continue;
+
+						auto& queued = legacyPackets[other * MAX_SERVER_QUEUED_VOICE_PACKETS + legacyCount[other]++];
+						queued.dataSize = voicePacket.dataSize;
+						std::memcpy(queued.data, voicePacket.data, voicePacket.dataSize);
+						queued.talker = static_cast<char>(talker);
+					}
+				}
+			}
+
+			for (auto client = 0; client < clients; ++client)
+			{
+				const auto buf = std::make_unique<unsigned char[]>(VOICE_MSG_BUF_SIZE);
+				if (!legacyCount[client]) continue;
+
+				std::size_t pos = 0;
+				for (auto packet = 0; packet < legacyCount[client]; ++packet)
+				{
+					writePacket(buf.get(), pos, legacyPackets[client * MAX_SERVER_QUEUED_VOICE_PACKETS + packet]);
+				}
+
+				if (!frame) legacyMessages[client].assign(reinterpret_cast<char*>(buf.get()), pos);
+				legacyBytes += pos;
+				legacyCount[client] = 0;
+			}
+		}
+		const auto legacyTime = std::chrono::high_resolution_clock::now() - legacyStart;
+
+		SV_InitVoicePackets();
+
+		const auto pooledStart = std::chrono::high_resolution_clock::now();
+		for (auto frame = 0; frame < frames; ++frame)
+		{
+			std::uint32_t masks[Game::MAX_CLIENTS];
+			for (auto talker = 0; talker < clients; ++talker)
+			{
+				masks[talker] = talker == mutedTalker ? 0 : ((1u << clients) - 1) & ~(1u << talker);
+			}
+
+			for (auto talker = 0; talker < clients; ++talker)
+			{
+				for (auto packet = 0; packet < packetsPerTalker; ++packet)
+				{
+					SV_QueueVoicePacket(talker, masks[talker], &voicePacket);
+				}
+			}
+
+			for (auto client = 0; client < clients; ++client)
+			{
+				if (!(PendingVoiceClients & (1u << client))) continue;
+
+				std::size_t pos = 0;
+				for (auto packet = 0; packet < VoicePacketCount[client]; ++packet)
+				{
+					writePacket(VoiceMsgBuf, pos, VoicePacketPool[VoiceQueue[client][packet]].packet);
+				}
+
+				if (!frame) pooledMessages[client].assign(reinterpret_cast<char*>(VoiceMsgBuf), pos);
+				pooledBytes += pos;
+				SV_ReleaseVoicePackets(client);
+			}
+		}
+		const auto pooledTime = std::chrono::high_resolution_clock::now() - pooledStart;
+
+		const auto leaked = FreeVoicePacketCount != VOICE_PACKET_POOL_SIZE;
+		SV_InitVoicePackets();
+
+		if (leaked || legacyMessages != pooledMessages || legacyBytes != pooledBytes)
+		{
+			Logger::PrintError(Game::CON_CHANNEL_ERROR, "Voice fan-out mismatch: {} / {} bytes{}\n", legacyBytes, pooledBytes, leaked ? ", pool leaked" : "");
+			return false;
+		}
+
+		const auto perFrame = [](const std::chrono::nanoseconds time)
+		{
+			return std::chrono::duration_cast<std::chrono::microseconds>(time).count() / frames;
+		};
+
+		Logger::Print("Voice fan-out of {} talkers: {}us per server frame before, {}us with the shared pool\n", clients, perFrame(legacyTime), perFrame(pooledTime));
+		return true;
+	}
 }
@@ -7,6 +7,8 @@ namespace Components
 	public:
 		Voice();
 
+		bool unitTest() override;
+
 		static bool SV_VoiceEnabled();
 
 		static void SV_ClearMutedList();
@@ -16,9 +18,33 @@ namespace Components
 	private:
 		static constexpr auto MAX_VOICE_PACKET_DATA = 256;
 		static constexpr auto MAX_SERVER_QUEUED_VOICE_PACKETS = 40;
+		static constexpr auto VOICE_MSG_BUF_SIZE = 0x20000;
+
+		// Every packet lives in the pool once and is queued by index. A live packet is queued at least once,
+		// so the pool can't hold more packets than there are queue slots
+		static constexpr auto VOICE_PACKET_POOL_SIZE = Game::MAX_CLIENTS * MAX_SERVER_QUEUED_VOICE_PACKETS;
+
+		static_assert(Game::MAX_CLIENTS <= 32, "Listener masks hold one bit per client");
+
+		struct SharedVoicePacket
+		{
+			Game::VoicePacket_t packet;
+			int refs;
+		};
 
-		static Game::VoicePacket_t VoicePackets[Game::MAX_CLIENTS][MAX_SERVER_QUEUED_VOICE_PACKETS];
+		static SharedVoicePacket VoicePacketPool[VOICE_PACKET_POOL_SIZE];
+		static std::uint16_t FreeVoicePackets[VOICE_PACKET_POOL_SIZE];
+		static int FreeVoicePacketCount;
+
+		static std::uint16_t VoiceQueue[Game::MAX_CLIENTS][MAX_SERVER_QUEUED_VOICE_PACKETS];
 		static int VoicePacketCount[Game::MAX_CLIENTS];
+		static std::uint32_t PendingVoiceClients;
+
+		// Clients that can hear each talker, rebuilt once per server frame
+		static std::uint32_t ListenerMasks[Game::MAX_CLIENTS];
+		static std::optional<int> ListenerMaskTime;
+
+		static unsigned char VoiceMsgBuf[VOICE_MSG_BUF_SIZE];
 
 		static bool MuteList[Game::MAX_CLIENTS];
 		static bool S_PlayerMute[Game::MAX_CLIENTS];
@@ -32,7 +58,12 @@ namespace Components
 		static bool SV_ServerHasClientMuted(int talker);
 
 		static bool OnSameTeam(const Game::gentity_s* ent1, const Game::gentity_s* ent2);
-		static void SV_QueueVoicePacket(int talkerNum, int clientNum, const Game::VoicePacket_t* voicePacket);
+		static bool CanHearTalker(const Game::gentity_s* talker, const Game::gentity_s* ent);
+		static void UpdateListenerMasks();
+
+		static void SV_InitVoicePackets();
+		static void SV_QueueVoicePacket(int talkerNum, std::uint32_t listeners, const Game::VoicePacket_t* voicePacket);
+		static void SV_ReleaseVoicePackets(int clientNum);
 		static void G_BroadcastVoice(Game::gentity_s* talker, const Game::VoicePacket_t* voicePacket);
 		static void SV_UserVoice(Game::client_s* cl, Game::msg_t* msg);
 		static void SV_PreGameUserVoice(Game::client_s* cl, Game::msg_t* msg);
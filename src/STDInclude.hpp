@@ -22,6 +22,8 @@
 #include <DbgHelp.h>
 
 #include <algorithm>
+#include <atomic>
+#include <bit>
 #include <cctype>
 #include <chrono>
 #include <cinttypes>
@@ -2,33 +2,150 @@
 
 namespace Utils
 {
-	CSV::CSV(const std::string& file, const bool isFile, const bool allowComments)
+	CSV::Tokenizer::Tokenizer(std::string_view buffer, const bool allowComments) : buffer_(buffer), allowComments_(allowComments)
 	{
-		this->parse(file, isFile, allowComments);
 	}
 
-	std::size_t CSV::getRows() const
+	bool CSV::Tokenizer::next(std::vector<std::string_view>& row)
 	{
-		return this->dataMap_.size();
+		while (this->position_ < this->buffer_.size())
+		{
+			auto end = this->buffer_.find('\n', this->position_);
+			if (end == std::string_view::npos) end = this->buffer_.size();
+
+			const auto line = this->buffer_.substr(this->position_, end - this->position_);
+			this->position_ = end + 1;
+
+			if (this->parseRow(line, row))
+			{
+				return true;
+			}
+		}
+
+		row.clear();
+		return false;
 	}
 
-	std::size_t CSV::getColumns() const
+	bool CSV::Tokenizer::parseRow(std::string_view line, std::vector<std::string_view>& row)
+	{
+		row.clear();
+
+		// Unescaped cells are never longer than the line, so views into the scratch buffer don't move while the row is built
+		this->scratch_.clear();
+		this->scratch_.reserve(line.size());
+
+		auto isString = false;
+		std::size_t start = 0, quotes = 0, escapes = 0, skipped = 0;
+
+		for (std::size_t i = 0; i < line.size(); ++i)
+		{
+			const auto c = line[i];
+
+			if (c == ',' && !isString) // Flush entry
+			{
+				row.emplace_back(this->finishCell(line.substr(start, i - start), quotes, escapes, skipped));
+				start = i + 1;
+				quotes = escapes = skipped = 0;
+			}
+			else if (c == '"') // Start/Terminate string
+			{
+				isString = !isString;
+				++quotes;
+			}
+			else if (c == '\\' && isString && i + 1 < line.size() && line[i + 1] == '"') // Handle quotes in strings as \"
+			{
+				++escapes;
+				++i;
+			}
+			else if (!isString && (c == '\r' || c == '\t'))
+			{
+				++skipped;
+			}
+			else if (!isString && this->allowComments_ && (c == '#' || (c == '/' && i + 1 < line.size() && line[i + 1] == '/'))) // Skip comments. I know CSVs usually don't have comments, but in this case it's useful
+			{
+				return false;
+			}
+		}
+
+		// Push last element
+		row.emplace_back(this->finishCell(line.substr(start), quotes, escapes, skipped));
+
+		// Skip empty rows
+		return row.size() != 1 || !row[0].empty();
+	}
+
+	std::string_view CSV::Tokenizer::finishCell(std::string_view cell, std::size_t quotes, std::size_t escapes, std::size_t skipped)
 	{
-		std::size_t count = 0;
+		// Carriage returns at the end of a line are the usual case, they can be cut off without copying
+		while (skipped && !cell.empty() && (cell.front() == '\r' || cell.front() == '\t'))
+		{
+			cell.remove_prefix(1);
+			--skipped;
+		}
 
-		for (std::size_t i = 0; i < this->getRows(); ++i)
+		while (skipped && !(quotes % 2) && !cell.empty() && (cell.back() == '\r' || cell.back() == '\t'))
 		{
-			count = std::max(this->getColumns(i), count);
+			cell.remove_suffix(1);
+			--skipped;
+		}
+
+		if (!quotes && !escapes && !skipped)
+		{
+			return cell;
+		}
+
+		// A single quoted string is just the part between the quotes
+		if (quotes == 2 && !escapes && !skipped && cell.front() == '"' && cell.back() == '"')
+		{
+			return cell.substr(1, cell.size() - 2);
+		}
+
+		const auto offset = this->scratch_.size();
+		auto isString = false;
+
+		for (std::size_t i = 0; i < cell.size(); ++i)
+		{
+			const auto c = cell[i];
+
+			if (c == '"')
+			{
+				isString = !isString;
+			}
+			else if (c == '\\' && isString && i + 1 < cell.size() && cell[i + 1] == '"')
+			{
+				this->scratch_.push_back('"');
+				++i;
+			}
+			else if (isString || (c != '\r' && c != '\t'))
+			{
+				this->scratch_.push_back(c);
+			}
 		}
 
-		return count;
+		return std::string_view(this->scratch_).substr(offset);
+	}
+
+	CSV::CSV(const std::string& file, const bool isFile, const bool allowComments)
+	{
+		this->parse(file, isFile, allowComments);
+	}
+
+	std::size_t CSV::getRows() const
+	{
+		return this->rows_.size();
+	}
+
+	std::size_t CSV::getColumns() const
+	{
+		return this->columns_;
 	}
 
 	std::size_t CSV::getColumns(const std::size_t row) const
 	{
-		if (this->dataMap_.size() > row)
+		if (this->rows_.size() > row)
 		{
-			return this->dataMap_[row].size();
+			const auto end = row + 1 < this->rows_.size() ? this->rows_[row + 1] : this->cells_.size();
+			return end - this->rows_[row];
 		}
 
 		return 0;
@@ -36,14 +153,15 @@ namespace Utils
 
 	std::string CSV::getElementAt(const std::size_t row, const std::size_t column) const
 	{
-		if (this->dataMap_.size() > row)
-		{
-			auto& _row = this->dataMap_[row];
+		return std::string(this->getElementView(row, column));
+	}
 
-			if (_row.size() > column)
-			{
-				return _row[column];
-			}
+	std::string_view CSV::getElementView(const std::size_t row, const std::size_t column) const
+	{
+		if (column < this->getColumns(row))
+		{
+			const auto& cell = this->cells_[this->rows_[row] + column];
+			return std::string_view(cell.unescaped ? this->unescaped_ : this->buffer_).substr(cell.offset, cell.length);
 		}
 
 		return {};
@@ -56,8 +174,6 @@ namespace Utils
 
 	void CSV::parse(const std::string& file, const bool isFile, const bool allowComments)
 	{
-		std::string buffer;
-
 		if (isFile)
 		{
 			if (!IO::FileExists(file))
@@ -65,79 +181,35 @@ namespace Utils
 				return;
 			}
 
-			buffer = IO::ReadFile(file);
+			this->buffer_ = IO::ReadFile(file);
 			this->valid_ = true;
 		}
 		else
 		{
-			buffer = file;
-		}
-
-		if (!buffer.empty())
-		{
-			const auto rows = String::Split(buffer, '\n');
-
-			for (auto& row : rows)
-			{
-				this->parseRow(row, allowComments);
-			}
+			this->buffer_ = file;
 		}
-	}
 
-	void CSV::parseRow(const std::string& row, const bool allowComments)
-	{
-		bool isString = false;
-		std::string element;
-		std::vector<std::string> _row;
-		char tempStr = 0;
+		Tokenizer tokenizer(this->buffer_, allowComments);
+		std::vector<std::string_view> row;
 
-		for (std::size_t i = 0; i < row.size(); ++i)
+		while (tokenizer.next(row))
 		{
-			if (row[i] == ',' && !isString) // Flush entry
-			{
-				_row.push_back(element);
-				element.clear();
-				continue;
-			}
-
-			if (row[i] == '"') // Start/Terminate string
-			{
-				isString = !isString;
-				continue;
-			}
+			this->rows_.emplace_back(this->cells_.size());
+			this->columns_ = std::max(this->columns_, row.size());
 
-			if (i < (row.size() - 1) && row[i] == '\\' &&row[i + 1] == '"' && isString) // Handle quotes in strings as \"
+			for (const auto& cell : row)
 			{
-				tempStr = '"';
-				++i;
+				const auto* begin = this->buffer_.data();
+				if (cell.data() >= begin && cell.data() <= begin + this->buffer_.size())
+				{
+					this->cells_.push_back({ static_cast<std::uint32_t>(cell.data() - begin), static_cast<std::uint32_t>(cell.size()), false });
+				}
+				else
+				{
+					this->cells_.push_back({ static_cast<std::uint32_t>(this->unescaped_.size()), static_cast<std::uint32_t>(cell.size()), true });
+					this->unescaped_.append(cell);
+				}
 			}
-
-			else if (!isString && (row[i] == '\n' || row[i] == '\x0D' || row[i] == '\x0A' || row[i] == '\t'))
-			{
-				continue;
-			}
-
-			else if (!isString && (row[i] == '#' || (row[i] == '/' && (i + 1) < row.size() && row[i + 1] == '/') ) && allowComments) // Skip comments. I know CSVs usually don't have comments, but in this case it's useful
-			{
-				return;
-			}
-
-			else
-			{
-				tempStr = row[i];
-			}
-
-			element.append(&tempStr, 1);
 		}
-
-		// Push last element
-		_row.push_back(element);
-
-		if (_row.empty() || (_row.size() == 1 && _row[0].empty())) // Skip empty rows
-		{
-			return;
-		}
-
-		this->dataMap_.push_back(_row);
 	}
 }
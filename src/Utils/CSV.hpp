@@ -5,6 +5,26 @@ namespace Utils
 	class CSV
 	{
 	public:
+		// Reads rows straight out of a buffer the caller keeps alive, cells only get copied when they contain quotes or skipped characters
+		class Tokenizer
+		{
+		public:
+			Tokenizer(std::string_view buffer, bool allowComments = true);
+
+			// Fills row with the cells of the next row that isn't empty or a comment, returns false at the end of the buffer.
+			// The cells stay valid until the next call.
+			bool next(std::vector<std::string_view>& row);
+
+		private:
+			std::string_view buffer_;
+			std::size_t position_ = 0;
+			bool allowComments_;
+			std::string scratch_;
+
+			bool parseRow(std::string_view line, std::vector<std::string_view>& row);
+			std::string_view finishCell(std::string_view cell, std::size_t quotes, std::size_t escapes, std::size_t skipped);
+		};
+
 		CSV(const std::string& file, bool isFile = true, bool allowComments = true);
 
 		[[nodiscard]] std::size_t getRows() const;
@@ -12,14 +32,26 @@ namespace Utils
 		[[nodiscard]] std::size_t getColumns(std::size_t row) const;
 
 		[[nodiscard]] std::string getElementAt(std::size_t row, std::size_t column) const;
+		[[nodiscard]] std::string_view getElementView(std::size_t row, std::size_t column) const;
 
 		[[nodiscard]] bool isValid() const;
 
 	private:
+		// Offsets instead of views, so copies of the table stay valid
+		struct Cell
+		{
+			std::uint32_t offset;
+			std::uint32_t length;
+			bool unescaped;
+		};
+
 		bool valid_ = false;
-		std::vector<std::vector<std::string>> dataMap_;
+		std::string buffer_;
+		std::string unescaped_;
+		std::vector<Cell> cells_;
+		std::vector<std::size_t> rows_;
+		std::size_t columns_ = 0;
 
 		void parse(const std::string& file, bool isFile = true, bool allowComments = true);
-		void parseRow(const std::string& row, bool allowComments = true);
 	};
 }
@@ -248,6 +248,38 @@ namespace Utils
 			return String::DumpHex(hash, {});
 		}
 
+		std::string SHA256::ComputeFile(const std::string& file, bool hex)
+		{
+			std::ifstream stream(file, std::ios::binary);
+			if (!stream.is_open()) return {};
+
+			constexpr std::size_t chunkSize = 1024 * 1024;
+			const auto chunk = std::make_unique<char[]>(chunkSize);
+
+			hash_state state;
+			sha256_init(&state);
+
+			while (stream)
+			{
+				stream.read(chunk.get(), chunkSize);
+
+				const auto count = stream.gcount();
+				if (count <= 0) break;
+
+				sha256_process(&state, reinterpret_cast<const std::uint8_t*>(chunk.get()), static_cast<unsigned long>(count));
+			}
+
+			if (stream.bad()) return {};
+
+			std::uint8_t buffer[32]{};
+			sha256_done(&state, buffer);
+
+			std::string hash{ reinterpret_cast<char*>(buffer), sizeof(buffer) };
+			if (!hex) return hash;
+
+			return String::DumpHex(hash, {});
+		}
+
 #pragma endregion
 
 #pragma region SHA512
@@ -341,6 +341,9 @@ namespace Utils
 		public:
 			static std::string Compute(const std::string& data, bool hex = false);
 			static std::string Compute(const std::uint8_t* data, std::size_t length, bool hex = false);
+
+			// Streams the file in chunks instead of reading it into memory. Returns an empty string on failure
+			static std::string ComputeFile(const std::string& file, bool hex = false);
 		};
 
 		class SHA512
@@ -4,6 +4,316 @@ namespace Utils
 {
 	Memory::Allocator Memory::MemAllocator;
 
+	thread_local Memory::Allocator::ThreadCaches Memory::Allocator::Caches;
+
+	Memory::Allocator::Allocator() : id_(0), live_(0), heapBlocks_(0)
+	{
+	}
+
+	Memory::Allocator::~Allocator()
+	{
+		this->clear();
+	}
+
+	void Memory::Allocator::clear()
+	{
+		// Lock order is always registry first, so releasing a thread cache can't deadlock with us.
+		// No thread cache can hold blocks of an allocator that never registered
+		auto& registry = GetRegistry();
+		std::unique_lock<std::mutex> registryLock;
+		if (this->id_) registryLock = std::unique_lock(registry.mutex);
+
+		std::lock_guard _(this->mutex);
+
+		this->refMemory.forEach([](void* memory, FreeCallback callback)
+		{
+			if (memory && callback)
+			{
+				callback(memory);
+			}
+		});
+
+		this->refMemory.clear();
+
+		this->heap_.forEach([](void* data, std::size_t)
+		{
+			Free(data);
+		});
+
+		this->heap_.clear();
+
+		this->chunks_.forEach([](void*, Chunk* chunk)
+		{
+			FreeAlign(chunk->base);
+			delete chunk;
+		});
+
+		this->chunks_.clear();
+
+		std::memset(this->freeLists_, 0, sizeof(this->freeLists_));
+		std::memset(this->current_, 0, sizeof(this->current_));
+
+		// Blocks still sitting in thread caches belong to the chunks we just released.
+		// Dropping our id makes those caches stale, they are dropped the next time they are looked at.
+		if (this->id_)
+		{
+			registry.allocators.erase(this->id_);
+			this->id_ = 0;
+		}
+
+		this->live_ = 0;
+		this->heapBlocks_ = 0;
+	}
+
+	void Memory::Allocator::free(void* data)
+	{
+		std::lock_guard _(this->mutex);
+
+		if (auto* callback = this->refMemory.find(data))
+		{
+			(*callback)(data);
+			this->refMemory.erase(data);
+		}
+
+		if (this->heap_.erase(data))
+		{
+			Free(data);
+			--this->live_;
+			return;
+		}
+
+		const auto address = reinterpret_cast<std::uintptr_t>(data);
+		auto** chunk = this->chunks_.find(reinterpret_cast<void*>(address & ~(ChunkSize - 1)));
+		if (!chunk) return;
+
+		const auto offset = address & (ChunkSize - 1);
+		const auto blockSize = GetBlockSize((*chunk)->sizeClass);
+		if (offset % blockSize) return;
+
+		// Ignore blocks that are already free
+		const auto index = offset / blockSize;
+		auto& live = (*chunk)->live[index / 32];
+		const auto bit = 1u << (index % 32);
+		if (!(live & bit)) return;
+
+		live &= ~bit;
+
+		*static_cast<void**>(data) = this->freeLists_[(*chunk)->sizeClass];
+		this->freeLists_[(*chunk)->sizeClass] = data;
+
+		--this->live_;
+	}
+
+	void Memory::Allocator::reference(void* memory, FreeCallback callback)
+	{
+		std::lock_guard _(this->mutex);
+
+		this->refMemory[memory] = callback;
+	}
+
+	void* Memory::Allocator::allocate(std::size_t length)
+	{
+		if (length > MaxBlockSize || this->heapBlocks_.load(std::memory_order_relaxed) < HeapBlocks)
+		{
+			return this->allocateHeap(length);
+		}
+
+		const auto sizeClass = GetSizeClass(length);
+
+		auto& cache = this->getCache();
+		if (!cache.counts[sizeClass])
+		{
+			this->refill(cache, sizeClass);
+		}
+
+		auto* data = cache.blocks[sizeClass][--cache.counts[sizeClass]];
+		std::memset(data, 0, length);
+
+		++this->live_;
+		return data;
+	}
+
+	char* Memory::Allocator::duplicateString(const std::string& string)
+	{
+		auto* data = static_cast<char*>(this->allocate(string.size() + 1));
+		std::memcpy(data, string.data(), string.size());
+		return data;
+	}
+
+	void* Memory::Allocator::allocateHeap(std::size_t length)
+	{
+		auto* data = Allocate(length);
+
+		std::lock_guard _(this->mutex);
+
+		this->heap_[data] = length;
+		if (length <= MaxBlockSize) ++this->heapBlocks_;
+
+		++this->live_;
+		return data;
+	}
+
+	std::uint32_t Memory::Allocator::getId()
+	{
+		const auto id = this->id_.load(std::memory_order_acquire);
+		if (id) return id;
+
+		auto& registry = GetRegistry();
+		std::lock_guard _(registry.mutex);
+
+		// Another thread might have registered us while we waited
+		if (!this->id_)
+		{
+			this->id_ = ++registry.nextId;
+			registry.allocators[this->id_] = this;
+		}
+
+		return this->id_;
+	}
+
+	Memory::Allocator::ThreadCache& Memory::Allocator::getCache()
+	{
+		const auto id = this->getId();
+		const auto now = ++Caches.clock;
+
+		ThreadCache* victim = &Caches.entries[0];
+		for (auto& entry : Caches.entries)
+		{
+			if (entry.owner == id)
+			{
+				entry.lastUse = now;
+				return entry;
+			}
+
+			if (entry.lastUse < victim->lastUse)
+			{
+				victim = &entry;
+			}
+		}
+
+		ReleaseCache(*victim);
+
+		victim->owner = id;
+		victim->lastUse = now;
+		return *victim;
+	}
+
+	void Memory::Allocator::refill(ThreadCache& cache, std::size_t sizeClass)
+	{
+		const auto blockSize = GetBlockSize(sizeClass);
+
+		// Large blocks are refilled in smaller batches so a thread doesn't sit on too much memory
+		const auto batch = std::clamp<std::size_t>(4096 / blockSize, 4, ThreadCache::Capacity);
+
+		std::lock_guard _(this->mutex);
+
+		auto& count = cache.counts[sizeClass];
+		while (count < batch)
+		{
+			void* data;
+
+			if (this->freeLists_[sizeClass])
+			{
+				data = this->freeLists_[sizeClass];
+				this->freeLists_[sizeClass] = *static_cast<void**>(data);
+			}
+			else
+			{
+				auto*& chunk = this->current_[sizeClass];
+				if (!chunk || (chunk->used + 1) * blockSize > ChunkSize)
+				{
+					chunk = new Chunk{};
+					chunk->base = static_cast<std::uint8_t*>(_aligned_malloc(ChunkSize, ChunkSize));
+					chunk->sizeClass = sizeClass;
+
+					if (!chunk->base)
+					{
+						delete chunk;
+						chunk = nullptr;
+						throw std::bad_alloc();
+					}
+
+					this->chunks_[chunk->base] = chunk;
+				}
+
+				data = chunk->base + chunk->used++ * blockSize;
+			}
+
+			const auto address = reinterpret_cast<std::uintptr_t>(data);
+			auto* chunk = *this->chunks_.find(reinterpret_cast<void*>(address & ~(ChunkSize - 1)));
+			const auto index = (address & (ChunkSize - 1)) / blockSize;
+			chunk->live[index / 32] |= 1u << (index % 32);
+
+			cache.blocks[sizeClass][count++] = data;
+		}
+	}
+
+	void Memory::Allocator::ReleaseCache(ThreadCache& cache)
+	{
+		const auto hasBlocks = std::any_of(std::begin(cache.counts), std::end(cache.counts), [](std::uint8_t count) { return count != 0; });
+
+		if (hasBlocks)
+		{
+			auto& registry = GetRegistry();
+			std::lock_guard registryLock(registry.mutex);
+
+			// The owner might have been cleared or destroyed since, then its memory is already gone
+			const auto owner = registry.allocators.find(cache.owner);
+			if (owner != registry.allocators.end())
+			{
+				auto* allocator = owner->second;
+				std::lock_guard _(allocator->mutex);
+
+				for (std::size_t sizeClass = 0; sizeClass < SizeClasses; ++sizeClass)
+				{
+					const auto blockSize = GetBlockSize(sizeClass);
+
+					for (std::size_t i = 0; i < cache.counts[sizeClass]; ++i)
+					{
+						auto* data = cache.blocks[sizeClass][i];
+
+						const auto address = reinterpret_cast<std::uintptr_t>(data);
+						auto* chunk = *allocator->chunks_.find(reinterpret_cast<void*>(address & ~(ChunkSize - 1)));
+						const auto index = (address & (ChunkSize - 1)) / blockSize;
+						chunk->live[index / 32] &= ~(1u << (index % 32));
+
+						*static_cast<void**>(data) = allocator->freeLists_[sizeClass];
+						allocator->freeLists_[sizeClass] = data;
+					}
+				}
+			}
+		}
+
+		std::memset(cache.counts, 0, sizeof(cache.counts));
+		cache.owner = 0;
+	}
+
+	Memory::Allocator::ThreadCaches::~ThreadCaches()
+	{
+		for (auto& entry : this->entries)
+		{
+			ReleaseCache(entry);
+		}
+	}
+
+	std::size_t Memory::Allocator::GetSizeClass(std::size_t length)
+	{
+		if (length <= MinBlockSize) return 0;
+		return std::bit_width(length - 1) - std::bit_width(MinBlockSize - 1);
+	}
+
+	std::size_t Memory::Allocator::GetBlockSize(std::size_t sizeClass)
+	{
+		return MinBlockSize << sizeClass;
+	}
+
+	Memory::Allocator::Registry& Memory::Allocator::GetRegistry()
+	{
+		// Allocators are global objects in other translation units too, so this can't be a static member
+		static Registry registry;
+		return registry;
+	}
+
 	void* Memory::AllocateAlign(std::size_t length, std::size_t alignment)
 	{
 		auto* data = _aligned_malloc(length, alignment);
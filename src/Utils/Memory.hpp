@@ -5,83 +5,203 @@ namespace Utils
 	class Memory
 	{
 	public:
-		class Allocator
+		// Open addressing hash map keyed by pointers, with linear probing and backward shift deletion
+		template <typename T>
+		class PointerMap
 		{
 		public:
-			typedef void(*FreeCallback)(void*);
+			T* find(const void* key)
+			{
+				if (!key) return this->hasNull_ ? &this->null_ : nullptr;
+				if (this->slots_.empty()) return nullptr;
 
-			Allocator()
+				for (auto i = this->hash(key);; i = (i + 1) & this->mask())
+				{
+					auto& slot = this->slots_[i];
+					if (slot.key == key) return &slot.value;
+					if (!slot.key) return nullptr;
+				}
+			}
+
+			const T* find(const void* key) const
 			{
-				this->pool.clear();
-				this->refMemory.clear();
+				return const_cast<PointerMap*>(this)->find(key);
 			}
-			~Allocator()
+
+			bool contains(const void* key) const
 			{
-				this->clear();
+				return this->find(key) != nullptr;
 			}
 
-			void clear()
+			T& operator[](const void* key)
 			{
-				std::lock_guard _(this->mutex);
+				if (!key)
+				{
+					this->hasNull_ = true;
+					return this->null_;
+				}
 
-				for (auto i = this->refMemory.begin(); i != this->refMemory.end(); ++i)
+				// Keep the load factor below 3/4
+				if ((this->count_ + 1) * 4 > this->slots_.size() * 3)
 				{
-					if (i->first && i->second)
+					this->rehash(std::max<std::size_t>(this->slots_.size() * 2, 16));
+				}
+
+				for (auto i = this->hash(key);; i = (i + 1) & this->mask())
+				{
+					auto& slot = this->slots_[i];
+					if (slot.key == key) return slot.value;
+
+					if (!slot.key)
 					{
-						i->second(i->first);
+						slot.key = key;
+						slot.value = {};
+						++this->count_;
+						return slot.value;
 					}
 				}
+			}
 
-				this->refMemory.clear();
+			bool erase(const void* key)
+			{
+				if (!key)
+				{
+					const auto found = this->hasNull_;
+					this->hasNull_ = false;
+					this->null_ = {};
+					return found;
+				}
+
+				if (this->slots_.empty()) return false;
+
+				auto i = this->hash(key);
+				while (this->slots_[i].key != key)
+				{
+					if (!this->slots_[i].key) return false;
+					i = (i + 1) & this->mask();
+				}
 
-				for (const auto& data : this->pool)
+				// Pull following entries of the probe sequence back into the hole, so lookups never need tombstones
+				for (auto j = (i + 1) & this->mask();; j = (j + 1) & this->mask())
 				{
-					Free(data);
+					auto& slot = this->slots_[j];
+					if (!slot.key) break;
+
+					const auto home = this->hash(slot.key);
+					if (((j - home) & this->mask()) >= ((j - i) & this->mask()))
+					{
+						this->slots_[i] = slot;
+						i = j;
+					}
 				}
 
-				this->pool.clear();
+				this->slots_[i] = {};
+				--this->count_;
+				return true;
 			}
 
-			void free(void* data)
+			void clear()
 			{
-				std::lock_guard _(this->mutex);
+				this->slots_.clear();
+				this->count_ = 0;
+				this->hasNull_ = false;
+				this->null_ = {};
+			}
 
-				auto i = this->refMemory.find(data);
-				if (i != this->refMemory.end())
-				{
-					i->second(i->first);
-					this->refMemory.erase(i);
-				}
+			[[nodiscard]] std::size_t size() const
+			{
+				return this->count_ + (this->hasNull_ ? 1 : 0);
+			}
+
+			[[nodiscard]] bool empty() const
+			{
+				return this->size() == 0;
+			}
+
+			template <typename F>
+			void forEach(F&& callback)
+			{
+				if (this->hasNull_) callback(nullptr, this->null_);
 
-				auto j = std::find(this->pool.begin(), this->pool.end(), data);
-				if (j != this->pool.end())
+				for (auto& slot : this->slots_)
 				{
-					Free(data);
-					this->pool.erase(j);
+					if (slot.key) callback(const_cast<void*>(slot.key), slot.value);
 				}
 			}
 
-			void free(const void* data)
+		private:
+			struct Slot
 			{
-				this->free(const_cast<void*>(data));
-			}
+				const void* key;
+				T value;
+			};
+
+			std::vector<Slot> slots_;
+			std::size_t count_{};
 
-			void reference(void* memory, FreeCallback callback)
+			bool hasNull_{};
+			T null_{};
+
+			[[nodiscard]] std::size_t mask() const
 			{
-				std::lock_guard _(this->mutex);
+				return this->slots_.size() - 1;
+			}
 
-				this->refMemory[memory] = callback;
+			[[nodiscard]] std::size_t hash(const void* key) const
+			{
+				// Fibonacci hashing, allocations are aligned so the low bits alone are useless
+				const auto value = static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(key)) * 0x9E3779B97F4A7C15ull;
+				return static_cast<std::size_t>(value >> 32) & this->mask();
 			}
 
-			void* allocate(std::size_t length)
+			void rehash(std::size_t capacity)
 			{
-				std::lock_guard _(this->mutex);
+				auto slots = std::move(this->slots_);
+				this->slots_.assign(capacity, {});
+
+				for (const auto& slot : slots)
+				{
+					if (!slot.key) continue;
+
+					auto i = this->hash(slot.key);
+					while (this->slots_[i].key) i = (i + 1) & this->mask();
+					this->slots_[i] = slot;
+				}
+			}
+		};
+
+		// Small blocks are carved from 64 KB chunks that each serve a single size class, freed blocks go on a free list of their class.
+		// Every thread keeps a few blocks per class so most allocations don't touch the mutex. Everything is released at once on clear.
+		// The first few small blocks come from the heap, so an allocator that only lives for a single file never creates a chunk
+		class Allocator
+		{
+		public:
+			typedef void(*FreeCallback)(void*);
+
+			static constexpr std::size_t ChunkSize = 0x10000;
+			static constexpr std::size_t MinBlockSize = 16;
+			static constexpr std::size_t SizeClasses = 8;
+			static constexpr std::size_t MaxBlockSize = MinBlockSize << (SizeClasses - 1);
+			static constexpr std::size_t HeapBlocks = 64;
+
+			Allocator();
+			~Allocator();
 
-				void* data = Allocate(length);
-				this->pool.push_back(data);
-				return data;
+			Allocator(const Allocator&) = delete;
+			Allocator& operator=(const Allocator&) = delete;
+
+			void clear();
+
+			void free(void* data);
+			void free(const void* data)
+			{
+				this->free(const_cast<void*>(data));
 			}
 
+			void reference(void* memory, FreeCallback callback);
+
+			void* allocate(std::size_t length);
+
 			template <typename T> T* allocate()
 			{
 				return this->allocateArray<T>(1);
@@ -94,17 +214,10 @@ namespace Utils
 
 			bool empty() const
 			{
-				return (this->pool.empty() && this->refMemory.empty());
+				return !this->live_ && this->refMemory.empty();
 			}
 
-			char* duplicateString(const std::string& string)
-			{
-				std::lock_guard _(this->mutex);
-
-				char* data = DuplicateString(string);
-				this->pool.push_back(data);
-				return data;
-			}
+			char* duplicateString(const std::string& string);
 
 			bool isPointerMapped(void* ptr) const
 			{
@@ -113,12 +226,8 @@ namespace Utils
 
 			template <typename T> T* getPointer(void* oldPtr)
 			{
-				if (this->isPointerMapped(oldPtr))
-				{
-					return static_cast<T*>(this->ptrMap[oldPtr]);
-				}
-
-				return nullptr;
+				auto* newPtr = this->ptrMap.find(oldPtr);
+				return newPtr ? static_cast<T*>(*newPtr) : nullptr;
 			}
 
 			void mapPointer(void* oldPtr, void* newPtr)
@@ -127,10 +236,68 @@ namespace Utils
 			}
 
 		private:
+			struct Chunk
+			{
+				std::uint8_t* base;
+				std::size_t sizeClass;
+				std::size_t used; // Blocks handed out by bumping so far
+				std::uint32_t live[ChunkSize / MinBlockSize / 32]; // Blocks that are not on a free list
+			};
+
+			struct ThreadCache
+			{
+				static constexpr std::size_t Capacity = 32;
+
+				std::uint32_t owner;
+				std::uint32_t lastUse;
+				std::uint8_t counts[SizeClasses];
+				void* blocks[SizeClasses][Capacity];
+			};
+
+			struct ThreadCaches
+			{
+				static constexpr std::size_t Count = 4;
+
+				ThreadCache entries[Count]{};
+				std::uint32_t clock{};
+
+				~ThreadCaches();
+			};
+
+			// Maps allocator ids to live allocators, so thread caches can hand blocks back to their owner.
+			// An allocator only registers once it hands out its first chunk block
+			struct Registry
+			{
+				std::mutex mutex;
+				std::unordered_map<std::uint32_t, Allocator*> allocators;
+				std::uint32_t nextId{};
+			};
+
 			std::mutex mutex;
-			std::vector<void*> pool;
-			std::unordered_map<void*, void*> ptrMap;
-			std::unordered_map<void*, FreeCallback> refMemory;
+			std::atomic<std::uint32_t> id_;
+			std::atomic<std::size_t> live_;
+			std::atomic<std::size_t> heapBlocks_;
+
+			void* freeLists_[SizeClasses]{};
+			Chunk* current_[SizeClasses]{};
+			PointerMap<Chunk*> chunks_;
+			PointerMap<std::size_t> heap_;
+
+			PointerMap<void*> ptrMap;
+			PointerMap<FreeCallback> refMemory;
+
+			static thread_local ThreadCaches Caches;
+
+			static std::size_t GetSizeClass(std::size_t length);
+			static std::size_t GetBlockSize(std::size_t sizeClass);
+
+			static Registry& GetRegistry();
+			static void ReleaseCache(ThreadCache& cache);
+
+			std::uint32_t getId();
+			ThreadCache& getCache();
+			void refill(ThreadCache& cache, std::size_t sizeClass);
+			void* allocateHeap(std::size_t length);
 		};
 
 		static void* AllocateAlign(std::size_t length, std::size_t alignment);
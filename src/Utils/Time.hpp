@@ -27,4 +27,13 @@ namespace Utils::Time
 	private:
 		int lastPoint;
 	};
+
+	// Returns how long the callback took, for comparing implementations in unit tests
+	template <typename Duration = std::chrono::microseconds, typename F>
+	Duration Measure(F&& callback)
+	{
+		const auto start = std::chrono::high_resolution_clock::now();
+		callback();
+		return std::chrono::duration_cast<Duration>(std::chrono::high_resolution_clock::now() - start);
+	}
 }
@@ -254,10 +254,9 @@ namespace Utils
 		return this;
 	}
 
-	std::string WebIO::execute(const char* command, const std::string& body, const params& headers, bool* success)
+	bool WebIO::sendRequest(const char* command, const std::string& body, const params& headers, DWORD* statusCode)
 	{
-		if (success) *success = false;
-		if (!this->openConnection()) return {};
+		if (!this->openConnection()) return false;
 
 		static const char* acceptTypes[] = { "application/x-www-form-urlencoded", nullptr };
 
@@ -272,7 +271,7 @@ namespace Utils
 		if (!this->hFile_ || this->hFile_ == INVALID_HANDLE_VALUE)
 		{
 			this->closeConnection();
-			return {};
+			return false;
 		}
 
 		params params = headers;
@@ -292,20 +291,40 @@ namespace Utils
 		}
 
 		if (HttpSendRequestA(this->hFile_, finalHeaders.data(), finalHeaders.size(), const_cast<char*>(body.data()), body.size() + 1) == FALSE)
+		{
+			this->closeConnection();
+			return false;
+		}
+
+		*statusCode = 404;
+		DWORD length = sizeof(*statusCode);
+		if (HttpQueryInfoA(this->hFile_, HTTP_QUERY_FLAG_NUMBER | HTTP_QUERY_STATUS_CODE, statusCode, &length, nullptr) == FALSE)
+		{
+			this->closeConnection();
+			return false;
+		}
+
+		return true;
+	}
+
+	std::string WebIO::execute(const char* command, const std::string& body, const params& headers, bool* success)
+	{
+		if (success) *success = false;
+
+		DWORD statusCode;
+		if (!this->sendRequest(command, body, headers, &statusCode))
 		{
 			return {};
 		}
 
-		DWORD statusCode = 404;
-		DWORD length = sizeof(statusCode);
-		if (HttpQueryInfoA(this->hFile_, HTTP_QUERY_FLAG_NUMBER | HTTP_QUERY_STATUS_CODE, &statusCode, &length, nullptr) == FALSE || (statusCode != 200 && statusCode != 201))
+		if (statusCode != 200 && statusCode != 201)
 		{
 			this->closeConnection();
 			return {};
 		}
 
 		DWORD contentLength = 0;
-		length = sizeof(statusCode);
+		DWORD length = sizeof(contentLength);
 		if (HttpQueryInfoA(this->hFile_, HTTP_QUERY_FLAG_NUMBER | HTTP_QUERY_CONTENT_LENGTH, &contentLength, &length, nullptr) == FALSE)
 		{
 			contentLength = 0;
@@ -336,6 +355,54 @@ namespace Utils
 		return returnBuffer;
 	}
 
+	bool WebIO::getStream(const std::string& url, const std::uint64_t offset, const Slot<bool(const char*, std::size_t)>& callback, bool* resumed)
+	{
+		this->setURL(url);
+		if (resumed) *resumed = false;
+
+		params headers;
+		if (offset)
+		{
+			headers["Range"] = std::format("bytes={}-", offset);
+		}
+
+		DWORD statusCode;
+		if (!this->sendRequest("GET", "", headers, &statusCode))
+		{
+			return false;
+		}
+
+		// Servers that don't support ranges answer with the whole body
+		if (statusCode != 200 && (statusCode != 206 || !offset))
+		{
+			this->closeConnection();
+			return false;
+		}
+
+		if (resumed) *resumed = (statusCode == 206);
+
+		DWORD size{};
+		char buffer[0x10000];
+
+		while (InternetReadFile(this->hFile_, buffer, sizeof(buffer), &size))
+		{
+			if (!size)
+			{
+				this->closeConnection();
+				return true;
+			}
+
+			if (this->cancel_ || !callback(buffer, size))
+			{
+				break;
+			}
+		}
+
+		// Either canceled or the connection dropped before the body was complete
+		this->closeConnection();
+		return false;
+	}
+
 	bool WebIO::isSecuredConnection() const
 	{
 		return this->url_.protocol == "https"s;
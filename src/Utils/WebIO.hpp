@@ -38,6 +38,10 @@ namespace Utils
 		std::string get(const std::string& url, bool* success = nullptr);
 		std::string get(bool* success = nullptr);
 
+		// Passes the body to the callback as it arrives, the callback returns false to abort.
+		// A non-zero offset requests the rest of the resource, resumed tells if the server honoured it
+		bool getStream(const std::string& url, std::uint64_t offset, const Slot<bool(const char*, std::size_t)>& callback, bool* resumed = nullptr);
+
 		WebIO* setTimeout(DWORD msec);
 
 		// FTP
@@ -103,6 +107,7 @@ namespace Utils
 
 		[[nodiscard]] bool isSecuredConnection() const;
 
+		bool sendRequest(const char* command, const std::string& body, const params& headers, DWORD* statusCode);
 		std::string execute(const char* command, const std::string& body, const params& headers, bool* success = nullptr);
 
 		bool listElements(const std::string& directory, std::vector<std::string>& list, bool files);
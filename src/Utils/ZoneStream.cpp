@@ -0,0 +1,107 @@
+#include <STDInclude.hpp>
+
+#include "ZoneStream.hpp"
+
+namespace Utils::ZoneStream
+{
+	namespace
+	{
+		// Rotates every byte of the word right by 2
+		std::uint32_t RotateBytes(std::uint32_t value)
+		{
+			return ((value >> 2) & 0x3F3F3F3Fu) | ((value << 6) & 0xC0C0C0C0u);
+		}
+
+		std::uint8_t RotateByte(std::uint8_t value)
+		{
+			return static_cast<std::uint8_t>((value >> 2) | (value << 6));
+		}
+	}
+
+	void Deobfuscator::reset()
+	{
+		this->last_ = 0;
+	}
+
+	void Deobfuscator::process(void* data, std::size_t size)
+	{
+		auto* bytes = static_cast<std::uint8_t*>(data);
+		std::size_t i = 0;
+
+		for (; i + sizeof(std::uint32_t) <= size; i += sizeof(std::uint32_t))
+		{
+			std::uint32_t word;
+			std::memcpy(&word, bytes + i, sizeof(word));
+
+			// u = rotr2(input) ^ 0xFF, then output[n] = u[n] ^ rotr2(output[n - 1]), resolved for all four bytes at once
+			word = RotateBytes(word) ^ 0xFFFFFFFFu;
+			word ^= RotateBytes(word << 8);
+			word ^= RotateBytes(RotateBytes(word << 16));
+
+			// The previous output reaches byte n rotated n + 1 times, four rotations are a full turn
+			const auto r1 = RotateByte(this->last_);
+			const auto r2 = RotateByte(r1);
+			const auto r3 = RotateByte(r2);
+			word ^= r1 | (r2 << 8) | (r3 << 16) | (static_cast<std::uint32_t>(this->last_) << 24);
+
+			std::memcpy(bytes + i, &word, sizeof(word));
+			this->last_ = static_cast<std::uint8_t>(word >> 24);
+		}
+
+		for (; i < size; ++i)
+		{
+			bytes[i] = RotateByte(bytes[i] ^ this->last_) ^ 0xFF;
+			this->last_ = bytes[i];
+		}
+	}
+
+	void Deobfuscator::processBytes(void* data, std::size_t size)
+	{
+		auto* buffer = static_cast<char*>(data);
+		auto last = static_cast<char>(this->last_);
+
+		for (std::size_t i = 0; i < size; ++i)
+		{
+			buffer[i] ^= last;
+			RotLeft(buffer[i], 4);
+			buffer[i] ^= -1;
+			RotRight(buffer[i], 6);
+
+			last = buffer[i];
+		}
+
+		this->last_ = static_cast<std::uint8_t>(last);
+	}
+
+	void KeystreamCache::reset()
+	{
+		this->valid_ = false;
+	}
+
+	void KeystreamCache::decrypt(std::uint8_t* buffer, const std::uint8_t* iv, std::size_t ivLength, symmetric_CTR* ctr)
+	{
+		if (!this->valid_)
+		{
+			// Encrypting zeros yields the keystream, the copy ends up in the state a real decryption leaves
+			this->state_ = *ctr;
+			ctr_setiv(iv, static_cast<unsigned long>(ivLength), &this->state_);
+
+			std::memset(this->keystream_, 0, sizeof(this->keystream_));
+			ctr_encrypt(this->keystream_, this->keystream_, sizeof(this->keystream_), &this->state_);
+
+			this->valid_ = true;
+		}
+
+		for (std::size_t i = 0; i < BlockSize; i += sizeof(std::uint32_t))
+		{
+			std::uint32_t data, key;
+			std::memcpy(&data, buffer + i, sizeof(data));
+			std::memcpy(&key, this->keystream_ + i, sizeof(key));
+
+			data ^= key;
+			std::memcpy(buffer + i, &data, sizeof(data));
+		}
+
+		*ctr = this->state_;
+	}
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+namespace Utils::ZoneStream
+{
+	// Undoes the obfuscation of IW4x zones. Every byte is xored with the previous output, rotated left by 4, inverted and rotated right by 6,
+	// which is the same as output = rotr2(input ^ previous) ^ 0xFF. That is affine, so a whole word can be resolved with a prefix xor instead of byte by byte.
+	class Deobfuscator
+	{
+	public:
+		void reset();
+		void process(void* data, std::size_t size);
+
+		// The original byte by byte implementation
+		void processBytes(void* data, std::size_t size);
+
+	private:
+		std::uint8_t last_ = 0;
+	};
+
+	// The zone loader resets the CTR IV before decrypting each block, so every block is xored with the same keystream.
+	// It is generated once per zone and the cipher state the real decryption would leave behind is restored afterwards.
+	class KeystreamCache
+	{
+	public:
+		static constexpr std::size_t BlockSize = 8192;
+
+		void reset();
+		void decrypt(std::uint8_t* buffer, const std::uint8_t* iv, std::size_t ivLength, symmetric_CTR* ctr);
+
+	private:
+		bool valid_ = false;
+		std::uint8_t keystream_[BlockSize]{};
+		symmetric_CTR state_{};
+	};
+}